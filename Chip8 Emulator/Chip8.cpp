@@ -1,36 +1,65 @@
 #include "Chip8.h"
 
 #include <cstdio>
-#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
 
 #include "misc/Log.h"
+#include "debug/Profiler.h"
+#include "debug/TraceBuffer.h"
+#include "debug/FuzzFeedback.h"
+#include "misc/EventTrace.h"
+#include "misc/Hash.h"
+#include "misc/Kernels.h"
+#include "misc/Utility.h"
+#include "rom/RomCache.h"
+#include "rom/RomLibrary.h"
+#include "aot/AotModule.h"
+#include "FrameMemo.h"
 
 const int Chip8::WIDTH;
 const int Chip8::HEIGHT;
 const int Chip8::MEMORY_SIZE;
 
-unsigned char chip8FontSet[80] =
-{
-	0xF0, 0x90, 0x90, 0x90, 0xF0, //0
-	0x20, 0x60, 0x20, 0x20, 0x70, //1
-	0xF0, 0x10, 0xF0, 0x80, 0xF0, //2
-	0xF0, 0x10, 0xF0, 0x10, 0xF0, //3
-	0x90, 0x90, 0xF0, 0x10, 0x10, //4
-	0xF0, 0x80, 0xF0, 0x10, 0xF0, //5
-	0xF0, 0x80, 0xF0, 0x90, 0xF0, //6
-	0xF0, 0x10, 0x20, 0x40, 0x40, //7
-	0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
-	0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
-	0xF0, 0x90, 0xF0, 0x90, 0x90, //A
-	0xE0, 0x90, 0xE0, 0x90, 0xE0, //B
-	0xF0, 0x80, 0x80, 0x80, 0xF0, //C
-	0xE0, 0x90, 0x90, 0x90, 0xE0, //D
-	0xF0, 0x80, 0xF0, 0x80, 0xF0, //E
-	0xF0, 0x80, 0xF0, 0x80, 0x80  //F
-};
+static_assert(PagedMemory<Chip8::WIDTH * Chip8::HEIGHT>::PAGE_SIZE % Chip8::WIDTH == 0, "DXYN expects framebuffer rows to never span two pages");
+static_assert((Chip8::WIDTH & (Chip8::WIDTH - 1)) == 0 && (Chip8::HEIGHT & (Chip8::HEIGHT - 1)) == 0, "DXYN wraps coordinates with masks");
+
+namespace
+{
+	//Seed used until setRandomSeed is called, xorshift32 needs a non zero state
+	const uint32_t DEFAULT_RANDOM_SEED = 0x2545F491;
+
+	//The change in a Zobrist hash when a location goes from one value to another
+	inline uint64_t hashChange(uint32_t location, uint32_t before, uint32_t after)
+	{
+		return (before == after ? 0 : Hash::zobrist(location, before) ^ Hash::zobrist(location, after));
+	}
+}
 
 Chip8::Chip8()
+	: profiler(nullptr), traceBuffer(nullptr), eventTracing(false), stateHashing(false), fuzzFeedback(nullptr), stateHash(0), screenHash(0),
+	aotModule(nullptr), aotActive(false), frameMemo(nullptr), randomSeed(DEFAULT_RANDOM_SEED), randomState(DEFAULT_RANDOM_SEED)
 {
+	aotMachine.pages = memory.getPages();
+	aotMachine.writablePage = &Chip8::writablePage;
+	aotMachine.V = V;
+	aotMachine.stack = stack;
+	aotMachine.keypad = &keypad;
+	aotMachine.screenPages = screen.getPages();
+	aotMachine.writableScreenPage = &Chip8::writableScreenPage;
+	aotMachine.clearScreen = &Chip8::clearScreen;
+	aotMachine.pc = &pc;
+	aotMachine.I = &I;
+	aotMachine.sp = &sp;
+	aotMachine.delayTimer = &delayTimer;
+	aotMachine.soundTimer = &soundTimer;
+	aotMachine.drawFlag = &drawFlag;
+	aotMachine.cycles = &cycles;
+	aotMachine.randomByte = &Chip8::randomByte;
+	aotMachine.context = this;
+
+	selectCycleFunction();
 	reset();
 }
 
@@ -40,21 +69,18 @@ void Chip8::reset()
 	opcode = 0;
 	I = 0;
 	sp = 0;
+	cycles = 0;
 
 	//Clear Screen
 	clearScreen();
 	drawFlag = true;
 
-	//Clear Memory
-	for (int i = 0; i < MEMORY_SIZE; i++)
-	{
-		memory[i] = 0;
-	}
-
 	//Clear Stack/Keys/Registers
+	keypad = 0;
+
 	for (int i = 0; i < 16; i++)
 	{
-		V[i] = keys[i] = 0;
+		V[i] = 0;
 		// Needs to be seperate as diff type, don't really want to add casts for a one time op.
 		stack[i] = 0; 
 	}
@@ -62,18 +88,429 @@ void Chip8::reset()
 	//Reset Timers
 	delayTimer = soundTimer = 0;
 
+	randomState = randomSeed;
+
+	//Every page goes back to reading the shared font and ROM image, loadROM has already checked it fits
+	std::shared_ptr<const MemoryImage> image = (rom != nullptr ? rom->memory : MemoryImage::getEmpty());
+	memory.reset(std::shared_ptr<const unsigned char>(image, image->bytes));
+
+	if (stateHashing)
+		computeStateHash();
+}
+
+std::unique_ptr<Chip8> Chip8::fork() const
+{
+	std::unique_ptr<Chip8> child(new Chip8());
+	child->stateHashing = stateHashing;
+	child->shareState(*this);
+
+	return child;
+}
+
+void Chip8::shareState(const Chip8& source)
+{
+	if (&source == this)
+		return;
 
-	//Load Fontset
-	for (int i = 0; i < 80; i++)
+	rom = source.rom;
+	quirks = source.quirks;
+	aotModule = source.aotModule;
+
+	opcode = source.opcode;
+	I = source.I;
+	pc = source.pc;
+	sp = source.sp;
+	delayTimer = source.delayTimer;
+	soundTimer = source.soundTimer;
+	keypad = source.keypad;
+	drawFlag = source.drawFlag;
+	cycles = source.cycles;
+
+	memcpy(V, source.V, sizeof(V));
+	memcpy(stack, source.stack, sizeof(stack));
+
+	randomSeed = source.randomSeed;
+	randomState = source.randomState;
+
+	memory.shareFrom(source.memory);
+	screen.shareFrom(source.screen);
+
+	//The source's hash is only current while it is hashing
+	stateHash = source.stateHash;
+	screenHash = source.screenHash;
+
+	if (stateHashing && !source.stateHashing)
+		computeStateHash();
+
+	selectCycleFunction();
+}
+
+void Chip8::emulateCycle()
+{
+	(this->*cycleFunction)();
+}
+
+void Chip8::runCycles(unsigned long long count)
+{
+	const unsigned long long target = cycles + count;
+
+	while (cycles < target)
 	{
-		memory[i] = chip8FontSet[i];
+		//The module stops wherever it has no valid block, the interpreter steps past it
+		if (aotActive && aotModule->run(&aotMachine, target - cycles) > 0)
+			continue;
+
+		(this->*cycleFunction)();
 	}
 }
 
-void Chip8::emulateCycle()
+void Chip8::runFrame(unsigned long long cycleBudget, const KeypadEvent* events, size_t eventCount)
+{
+	//Replayed frames would be missing from the profile, trace and coverage
+	if (frameMemo != nullptr && eventCount == 0 && cycleBudget >= FrameMemo::MIN_CYCLE_BUDGET && profiler == nullptr && traceBuffer == nullptr && !eventTracing
+		&& fuzzFeedback == nullptr)
+	{
+		runMemoisedFrame(cycleBudget);
+		return;
+	}
+
+	unsigned long long frameCycle = 0;
+
+	for (size_t i = 0; i < eventCount; i++)
+	{
+		unsigned long long eventCycle = (events[i].cycle < cycleBudget ? events[i].cycle : cycleBudget);
+
+		if (eventCycle > frameCycle)
+		{
+			runCycles(eventCycle - frameCycle);
+			frameCycle = eventCycle;
+		}
+
+		keypad = events[i].keypad;
+	}
+
+	runCycles(cycleBudget - frameCycle);
+}
+
+void Chip8::setFrameMemo(FrameMemo* newFrameMemo)
+{
+	frameMemo = newFrameMemo;
+
+	if (frameMemo != nullptr && !stateHashing)
+		setStateHashing(true);
+}
+
+void Chip8::runMemoisedFrame(unsigned long long cycleBudget)
+{
+	const FrameMemo::Key key = { getStateHash(), cycleBudget, keypad, getQuirkFlags(), aotModule };
+	const bool drawnBefore = drawFlag;
+
+	const FrameMemo::Entry* entry = frameMemo->find(key);
+
+	if (entry != nullptr)
+	{
+		const unsigned long long frameStart = cycles;
+
+		shareState(*entry->result);
+
+		//Neither is part of the key, so they carry on from this machine rather than the one that ran the frame
+		cycles = frameStart + cycleBudget;
+		drawFlag = drawnBefore || entry->drew;
+		return;
+	}
+
+	drawFlag = false;
+	runCycles(cycleBudget);
+
+	const bool drew = drawFlag;
+	drawFlag = drawnBefore || drew;
+
+	frameMemo->insert(key, fork(), drew);
+}
+
+Chip8::IdleState Chip8::getIdleState()
+{
+	//Skipped cycles would be missing from the profile, trace and coverage
+	if (profiler != nullptr || traceBuffer != nullptr || eventTracing || fuzzFeedback != nullptr || pc > MEMORY_SIZE - 2)
+		return NotIdle;
+
+	unsigned short current = memory.read(pc) << 8 | memory.read(pc + 1);
+
+	if ((current & 0xF0FF) == 0xF00A && keypad == 0)
+		return WaitingForKey;
+
+	if (current == (0x1000 | pc))
+		return Halted;
+
+	unsigned short loopStart;
+
+	if (findTimerLoop(loopStart))
+		return WaitingForTimer;
+
+	return NotIdle;
+}
+
+unsigned long long Chip8::getSkippableCycles()
+{
+	switch (getIdleState())
+	{
+	case WaitingForKey:
+	case Halted:
+		return ULLONG_MAX;
+
+	case WaitingForTimer:
+		//Whole passes of the loop that leave the timer above 0, plus the steps back round to its start
+	{
+		unsigned short loopStart;
+		findTimerLoop(loopStart);
+
+		unsigned long long alignment = (pc == loopStart ? 0 : (loopStart + 6 - pc) / 2);
+		return alignment + (delayTimer > alignment ? (delayTimer - alignment) / 3 * 3 : 0);
+	}
+
+	default:
+		return 0;
+	}
+}
+
+unsigned long long Chip8::skipIdle(unsigned long long maxCycles)
+{
+	switch (getIdleState())
+	{
+	case WaitingForKey:
+		//FX0A returns before the timers tick while it waits
+		opcode = memory.read(pc) << 8 | memory.read(pc + 1);
+		cycles += maxCycles;
+		return maxCycles;
+
+	case Halted:
+	{
+		HashedRegisters hashedRegisters;
+		saveHashedRegisters(hashedRegisters);
+
+		opcode = 0x1000 | pc;
+		cycles += maxCycles;
+		delayTimer = (unsigned char)(delayTimer > maxCycles ? delayTimer - maxCycles : 0);
+		soundTimer = (unsigned char)(soundTimer > maxCycles ? soundTimer - maxCycles : 0);
+
+		if (stateHashing)
+			updateRegisterHash(hashedRegisters);
+
+		return maxCycles;
+	}
+
+	case WaitingForTimer:
+	{
+		unsigned short loopStart;
+		findTimerLoop(loopStart);
+
+		//Step the rest of the current pass normally so every skipped pass starts at the FX07
+		unsigned long long advanced = 0;
+
+		while (pc != loopStart && advanced < maxCycles)
+		{
+			runCycles(1);
+			advanced++;
+		}
+
+		if (pc != loopStart || !findTimerLoop(loopStart))
+			return advanced;
+
+		//Each pass reads the timer into Vx, doesn't skip as it isn't 0, and jumps back, ticking 3 times.
+		//Only passes that leave the timer at or above 0 are skipped, so none of them can exit the loop.
+		unsigned long long passes = delayTimer / 3;
+		if (passes > (maxCycles - advanced) / 3)
+			passes = (maxCycles - advanced) / 3;
+
+		if (passes == 0)
+			return advanced;
+
+		HashedRegisters hashedRegisters;
+		saveHashedRegisters(hashedRegisters);
+
+		V[memory.read(loopStart) & 0x0F] = (unsigned char)(delayTimer - 3 * (passes - 1));
+		delayTimer = (unsigned char)(delayTimer - 3 * passes);
+		soundTimer = (unsigned char)(soundTimer > 3 * passes ? soundTimer - 3 * passes : 0);
+		opcode = 0x1000 | loopStart;
+		cycles += 3 * passes;
+
+		if (stateHashing)
+			updateRegisterHash(hashedRegisters);
+
+		return advanced + 3 * passes;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+bool Chip8::findTimerLoop(unsigned short& loopStart)
+{
+	//pc can be on any of the loop's three instructions
+	for (unsigned short offset = 0; offset <= 4; offset += 2)
+	{
+		if (pc < offset || pc - offset > MEMORY_SIZE - 6)
+			continue;
+
+		unsigned short start = pc - offset;
+		unsigned short readTimer = memory.read(start) << 8 | memory.read(start + 1);
+		unsigned short skipIfZero = memory.read(start + 2) << 8 | memory.read(start + 3);
+		unsigned short jumpBack = memory.read(start + 4) << 8 | memory.read(start + 5);
+		unsigned short x = (readTimer & 0x0F00) >> 8;
+
+		if ((readTimer & 0xF0FF) == 0xF007 && skipIfZero == (0x3000 | (x << 8)) && jumpBack == (0x1000 | start))
+		{
+			//On the 3X00 with Vx at 0 the loop is about to exit
+			if (offset == 2 && V[x] == 0)
+				return false;
+
+			loopStart = start;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+unsigned char* Chip8::writablePage(void* context, unsigned short address)
+{
+	return static_cast<Chip8*>(context)->memory.getWritablePage(address);
+}
+
+unsigned char* Chip8::writableScreenPage(void* context, unsigned short offset)
+{
+	return static_cast<Chip8*>(context)->screen.getWritablePage(offset);
+}
+
+void Chip8::clearScreen(void* context)
+{
+	static_cast<Chip8*>(context)->clearScreen();
+}
+
+void Chip8::warnUnknownOpcode(unsigned short opcode)
+{
+	LOG_W_LIMITED("Unknown opcode: ", opcode, true);
+}
+
+unsigned char Chip8::randomByte(void* context)
+{
+	uint32_t& state = static_cast<Chip8*>(context)->randomState;
+
+	//xorshift32, the top byte has the best distribution
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return (unsigned char)(state >> 24);
+}
+
+void Chip8::setRandomSeed(uint32_t seed)
+{
+	randomSeed = (seed != 0 ? seed : DEFAULT_RANDOM_SEED);
+	randomState = randomSeed;
+
+	if (stateHashing)
+		computeStateHash();
+}
+
+void Chip8::setStateHashing(bool enabled)
+{
+	stateHashing = enabled;
+
+	if (stateHashing)
+		computeStateHash();
+
+	selectCycleFunction();
+}
+
+uint64_t Chip8::getStateHash()
+{
+	if (!stateHashing)
+		computeStateHash();
+
+	return stateHash ^ screenHash;
+}
+
+void Chip8::saveHashedRegisters(HashedRegisters& registers) const
+{
+	memcpy(registers.V, V, sizeof(V));
+	memcpy(registers.stack, stack, sizeof(stack));
+	registers.I = I;
+	registers.pc = pc;
+	registers.sp = sp;
+	registers.delayTimer = delayTimer;
+	registers.soundTimer = soundTimer;
+	registers.randomState = randomState;
+}
+
+void Chip8::updateRegisterHash(const HashedRegisters& before)
 {
+	for (int i = 0; i < 16; i++)
+	{
+		stateHash ^= hashChange(RegisterHashLocation + i, before.V[i], V[i]);
+		stateHash ^= hashChange(StackHashLocation + i, before.stack[i], stack[i]);
+	}
+
+	stateHash ^= hashChange(IndexHashLocation, before.I, I);
+	stateHash ^= hashChange(PcHashLocation, before.pc, pc);
+	stateHash ^= hashChange(SpHashLocation, before.sp, sp);
+	stateHash ^= hashChange(DelayTimerHashLocation, before.delayTimer, delayTimer);
+	stateHash ^= hashChange(SoundTimerHashLocation, before.soundTimer, soundTimer);
+	stateHash ^= hashChange(RandomHashLocation, before.randomState, randomState);
+}
+
+void Chip8::computeStateHash()
+{
+	stateHash = 0;
+	screenHash = 0;
+
+	for (int address = 0; address < MEMORY_SIZE; address++)
+	{
+		stateHash ^= Hash::zobrist(MemoryHashLocation + address, memory.read(address));
+	}
+
+	for (int offset = 0; offset < WIDTH * HEIGHT; offset++)
+	{
+		screenHash ^= Hash::zobrist(ScreenHashLocation + offset, screen.read(offset));
+	}
+
+	//Zero has no key, so the registers hash as a change from all zeros
+	HashedRegisters zero = {};
+	updateRegisterHash(zero);
+}
+
+template <int InstrumentationFlags>
+void Chip8::checkMemoryRange(unsigned short lastOffset)
+{
+	if ((InstrumentationFlags & FuzzInstrumentation) && I + lastOffset > MEMORY_SIZE - 1)
+		fuzzFeedback->recordFault(FuzzFeedback::MemoryRangeFault, pc);
+}
+
+template <int InstrumentationFlags>
+void Chip8::storeByte(unsigned short address, unsigned char value)
+{
+	if (InstrumentationFlags & StateHashInstrumentation)
+		stateHash ^= hashChange(MemoryHashLocation + (address & (MEMORY_SIZE - 1)), memory.read(address), value);
+
+	memory.write(address, value);
+}
+
+template <int InstrumentationFlags, int QuirkFlags>
+void Chip8::executeCycle()
+{
+	const unsigned short previousPc = pc;
+	cycles++;
+
+	HashedRegisters hashedRegisters;
+	if (InstrumentationFlags & StateHashInstrumentation)
+		saveHashedRegisters(hashedRegisters);
+
+	if ((InstrumentationFlags & FuzzInstrumentation) && pc > MEMORY_SIZE - 2)
+		fuzzFeedback->recordFault(FuzzFeedback::PcRangeFault, pc);
+
 	// Fetch Opcode (Opcodes are 2 bytes so merge both)
-	opcode = memory[pc] << 8 | memory[pc + 1];
+	opcode = memory.read(pc) << 8 | memory.read(pc + 1);
 
 	//Compare first 4 bits
 	switch (opcode & 0xF000)
@@ -88,13 +525,18 @@ void Chip8::emulateCycle()
 			pc += 2;
 			break;
 		case 0x00EE: // 00EE - Return from Subroutine
+			if ((InstrumentationFlags & FuzzInstrumentation) && sp == 0)
+				fuzzFeedback->recordFault(FuzzFeedback::StackUnderflowFault, pc);
+
 			sp--; //Switch pointer to most recent location in the stack
-			pc = stack[sp]; // Reset Program Counter to its original location
+			pc = stack[sp & 0xF]; // Reset Program Counter to its original location, the stack wraps rather than overflowing
 			pc += 2;
 			break;
 
 		default: //0x0NNN - Calls RCA 1802 program at address NNN. Not necessary for emulators according to a few sources.
-			Log::logW("Unimplemented or Unknown opcode: " + convertOpcodeToPrintableHex(opcode));
+			//Mutated ROMs are full of unknown opcodes, fuzzing would spend most of its time rate limiting these
+			if (!(InstrumentationFlags & FuzzInstrumentation))
+				warnUnknownOpcode(opcode);
 			pc += 2;
 			break;
 		}
@@ -107,7 +549,10 @@ void Chip8::emulateCycle()
 
 	//0x2
 	case 0x2000: //2NNN - Call Subroutine at NNN
-		stack[sp] = pc;
+		if ((InstrumentationFlags & FuzzInstrumentation) && sp >= 16)
+			fuzzFeedback->recordFault(FuzzFeedback::StackOverflowFault, pc);
+
+		stack[sp & 0xF] = pc;
 		sp++;
 		pc = (opcode & 0x0FFF);
 		break;
@@ -177,10 +622,13 @@ void Chip8::emulateCycle()
 
 			pc += 2;
 			break;
-		case 0x0006: //8XY6 - If the least significant bit of Vx is 1, then VF is set to 1. Then Vx is shifted right one.
-			V[0xF] = (V[(opcode & 0x0F00) >> 8]) >> 7;
-			V[(opcode & 0x0F00) >> 8] <<= 1;
+		case 0x0006: //8XY6 - Shift Vy (or Vx, see Quirks) right one and store in Vx. VF is set to the bit shifted out.
+		{
+			unsigned char source = (QuirkFlags & ShiftVxInPlaceQuirk) ? V[(opcode & 0x0F00) >> 8] : V[(opcode & 0x00F0) >> 4];
+			V[(opcode & 0x0F00) >> 8] = source >> 1;
+			V[0xF] = source & 0x01; //Set last so the flag wins when X is F
 			pc += 2;
+		}
 			break;
 		case 0x0007: //8XY7 - Subtract Vx from Vy and store in Vx (Vx = Vy - Vx). If Vy > Vx set VF to 1
 			//Set borrow flag if subtraction will cause a borrow
@@ -191,14 +639,18 @@ void Chip8::emulateCycle()
 
 			pc += 2;
 			break;
-		case 0x000E: //8XYE - If the most significant bit of Vx is 1, then VF is set to 1. Then Vx is multiplied by 2.
-			V[0xF] = (V[(opcode & 0x0F00) >> 8]) & 0x01;
-			V[(opcode & 0x0F00) >> 8] >>= 1;
+		case 0x000E: //8XYE - Shift Vy (or Vx, see Quirks) left one and store in Vx. VF is set to the bit shifted out.
+		{
+			unsigned char source = (QuirkFlags & ShiftVxInPlaceQuirk) ? V[(opcode & 0x0F00) >> 8] : V[(opcode & 0x00F0) >> 4];
+			V[(opcode & 0x0F00) >> 8] = source << 1;
+			V[0xF] = source >> 7;
 			pc += 2;
+		}
 			break;
 
 		default:
-			Log::logW("Unknown opcode: " + convertOpcodeToPrintableHex(opcode));
+			if (!(InstrumentationFlags & FuzzInstrumentation))
+				warnUnknownOpcode(opcode);
 			break;
 		}
 		break;
@@ -222,8 +674,7 @@ void Chip8::emulateCycle()
 	//0xC
 	case 0xC000: //CXNN - Generate Random Number Between 0-255, then AND with NN and store in Vx. (Vx = (rand(0-255) & NN)
 		
-		//TODO: Add better random number generation. Pretty Rubbish Distribution but fine for now 
-		(V[(opcode & 0x0F00) >> 8]) = (rand() % 256) & (opcode & 0x00FF);
+		(V[(opcode & 0x0F00) >> 8]) = randomByte(this) & (opcode & 0x00FF);
 		
 		pc += 2;
 		break;
@@ -231,31 +682,76 @@ void Chip8::emulateCycle()
 	//0xD
 	case 0xD000: //DXYN - Draw sprite of N bytes starting at I in memory at pos (Vx, Vy). Set VF for collision event.
 	{
-		//Implementation Borrowed from http://www.multigesture.net/articles/how-to-write-an-emulator-chip-8-interpreter/
-		//Will Reimplement as it doesn't wrap around sprites (maybe unless the ROMS im using don't support that)
-		unsigned short x = V[(opcode & 0x0F00) >> 8];
-		unsigned short y = V[(opcode & 0x00F0) >> 4];
-		unsigned short height = opcode & 0x000F;
+		//Originally borrowed from http://www.multigesture.net/articles/how-to-write-an-emulator-chip-8-interpreter/
+		//The start position always wraps, pixels past the edge are wrapped or clipped depending on Quirks.
+		//Clipping only shortens the loops, every row and column is masked onto the screen so none can go past it.
+		const int x = V[(opcode & 0x0F00) >> 8] & (WIDTH - 1);
+		const int y = V[(opcode & 0x00F0) >> 4] & (HEIGHT - 1);
+		const int height = opcode & 0x000F;
+		const int rows = ((QuirkFlags & WrapSpritesQuirk) || height <= HEIGHT - y) ? height : HEIGHT - y;
+		const int columns = ((QuirkFlags & WrapSpritesQuirk) || x + 8 <= WIDTH) ? 8 : WIDTH - x;
 		unsigned short pixel;
 
+		if (height > 0)
+			checkMemoryRange<InstrumentationFlags>(height - 1);
+
 		V[0xF] = 0;
-		for (int yline = 0; yline < height; yline++)
+		for (int yline = 0; yline < rows; yline++)
 		{
-			pixel = memory[I + yline];
-			for (int xline = 0; xline < 8; xline++)
+			const int row = (y + yline) & (HEIGHT - 1);
+
+			pixel = memory.read(I + yline);
+
+			//Empty rows change nothing, skipping them also keeps their framebuffer page shared
+			if (pixel == 0)
+				continue;
+
+			//Rows that don't reach the edge take the vectorised kernel, a row never spans two pages
+			if (x + 8 <= WIDTH)
 			{
+				const unsigned int offset = x + (row * WIDTH);
+
+				if (Kernels::xorSpriteRow(screen.getWritablePage(offset) + (offset & (screen.PAGE_SIZE - 1)), (uint8_t)pixel))
+					V[0xF] = 1;
+
+				//Every set bit flips its pixel
+				if (InstrumentationFlags & StateHashInstrumentation)
+				{
+					for (int xline = 0; xline < 8; xline++)
+					{
+						if ((pixel & (0x80 >> xline)) != 0)
+							screenHash ^= Hash::zobrist(ScreenHashLocation + offset + xline, 1);
+					}
+				}
+
+				continue;
+			}
+
+			for (int xline = 0; xline < columns; xline++)
+			{
+				const int column = (x + xline) & (WIDTH - 1);
+
 				if ((pixel & (0x80 >> xline)) != 0)
 				{
-					if (gameScreen[(x + xline + ((y + yline) * 64))] == 1)
+					const unsigned int offset = column + (row * WIDTH);
+
+					if (screen.read(offset) == 1)
 						V[0xF] = 1;
 
-					gameScreen[x + xline + ((y + yline) * 64)] ^= 1;
+					screen.write(offset, screen.read(offset) ^ 1);
+
+					if (InstrumentationFlags & StateHashInstrumentation)
+						screenHash ^= Hash::zobrist(ScreenHashLocation + offset, 1);
 				}
 			}
 		}
 
 		drawFlag = true;
 		pc += 2;
+
+		//Checked at run time rather than compiled in, it only touches DXYN and recording an event costs far more
+		if (eventTracing)
+			EventTrace::instant("DXYN", "chip8", "rows", height);
 	}
 	break;
 
@@ -264,14 +760,15 @@ void Chip8::emulateCycle()
 		switch (opcode & 0x00FF)
 		{
 		case 0x009E: //EX9E - Skip Next Instruction if key[Vx] is Pressed
-			pc += (keys[(V[(opcode & 0x0F00) >> 8])] ? 4 : 2);
+			pc += ((keypad >> (V[(opcode & 0x0F00) >> 8] & 0xF)) & 1) ? 4 : 2;
 			break;
 		case 0x00A1: //EXA1 - Skip Next Instruction if key[Vx] is not Pressed
-			pc += (keys[(V[(opcode & 0x0F00) >> 8])] ? 2 : 4);
+			pc += ((keypad >> (V[(opcode & 0x0F00) >> 8] & 0xF)) & 1) ? 2 : 4;
 			break;
 
 		default:
-			Log::logW("Unknown opcode: " + convertOpcodeToPrintableHex(opcode));
+			if (!(InstrumentationFlags & FuzzInstrumentation))
+				warnUnknownOpcode(opcode);
 			break;
 		}
 		break;
@@ -286,21 +783,15 @@ void Chip8::emulateCycle()
 			break;
 		case 0x000A: //FX0A - Wait for key press, value of key stored in Vx. This Blocks All Execution Until Key Press.
 		{
-			bool keyPressed = false;
-
-			//This will fetch the highest value key that is pressed (Not sure if I should accept the first I see or last).
-			for (int i = 0; i < 16; i++)
+			if (keypad == 0)
 			{
-				if (keys[i])
-				{
-					V[(opcode & 0x0F00) >> 8] = i;
-					keyPressed = true;
-				}
+				recordInstrumentation<InstrumentationFlags>(previousPc);
+				return;
 			}
 
-			if (!keyPressed)
-				return;
-				
+			//Takes the highest value key that is pressed (Not sure if I should accept the first I see or last).
+			V[(opcode & 0x0F00) >> 8] = (unsigned char)Utility::highestSetBit(keypad);
+
 			pc += 2;
 		}
 			break;
@@ -315,13 +806,9 @@ void Chip8::emulateCycle()
 		case 0x001E: //FX1E - Add Vx to I and store result in I
 			I += (V[(opcode & 0x0F00) >> 8]);
 
-			//Undocumented requirement for some specific games
-			//Check for overflow, if so set VF to 1
-			if (((V[(opcode & 0x0F00) >> 8]) + I) > USHRT_MAX)
-			{
-				Log::logD("Overflow on 0xFX1E instruction, should check logic");
-				V[0xF] = 1;
-			}
+			//Undocumented behaviour some games (e.g. Spacefight 2091!) rely on, set VF when I leaves addressable memory
+			if (QuirkFlags & AddIndexSetsOverflowQuirk)
+				V[0xF] = (I > 0x0FFF) ? 1 : 0;
 
 			pc += 2;
 			break;
@@ -330,49 +817,55 @@ void Chip8::emulateCycle()
 			pc += 2;
 			break;
 		case 0x0033: //FX33 - Store the Binary-Coded Decimal representation of Vx in memory at locations I, I+1, I+2
-			memory[I] = V[(opcode & 0x0F00) >> 8] / 100;
-			memory[I + 1] = (V[(opcode & 0x0F00) >> 8] / 10) % 10;
-			memory[I + 2] = (V[(opcode & 0x0F00) >> 8] % 100) % 10;
+			checkMemoryRange<InstrumentationFlags>(2);
+			storeByte<InstrumentationFlags>(I, V[(opcode & 0x0F00) >> 8] / 100);
+			storeByte<InstrumentationFlags>(I + 1, (V[(opcode & 0x0F00) >> 8] / 10) % 10);
+			storeByte<InstrumentationFlags>(I + 2, (V[(opcode & 0x0F00) >> 8] % 100) % 10);
 			//Implementation by TJA 
 			pc += 2;
 			break;
-		case 0x0055: //FX55 - Dump values from registry (V0 - Vx) to memory at address I and onwards. 'I' should not be modified
+		case 0x0055: //FX55 - Dump values from registry (V0 - Vx) to memory at address I and onwards. 'I' is only modified with the loadStoreIncrementsI quirk
+			checkMemoryRange<InstrumentationFlags>((opcode & 0x0F00) >> 8);
+
 			for (int i = 0; i <= ((opcode & 0x0F00) >> 8); i++)
 			{
-				memory[I + i] = V[i];
+				storeByte<InstrumentationFlags>(I + i, V[i]);
 			}
 
-			/*
-			// On the original interpreter, when the operation is done, I = I + X + 1.
-			I += ((opcode & 0x0F00) >> 8) + 1;
-			pc += 2;
-			*/
+			//On the original interpreter, when the operation is done, I = I + X + 1.
+			if (QuirkFlags & LoadStoreIncrementsIQuirk)
+				I += ((opcode & 0x0F00) >> 8) + 1;
+
 			pc += 2;
 			break;
-		case 0x0065: //FX65 - Load values to registry (V0 - Vx) from memory at address I and onwards. 'I' should not be modified
+		case 0x0065: //FX65 - Load values to registry (V0 - Vx) from memory at address I and onwards. 'I' is only modified with the loadStoreIncrementsI quirk
+			checkMemoryRange<InstrumentationFlags>((opcode & 0x0F00) >> 8);
+
 			for (int i = 0; i <= ((opcode & 0x0F00) >> 8); i++)
 			{
-				V[i] = memory[I + i];
+				V[i] = memory.read(I + i);
 			}
 
-			/*
-			// On the original interpreter, when the operation is done, I = I + X + 1.
-			I += ((opcode & 0x0F00) >> 8) + 1;
-			pc += 2;
-			*/
+			//On the original interpreter, when the operation is done, I = I + X + 1.
+			if (QuirkFlags & LoadStoreIncrementsIQuirk)
+				I += ((opcode & 0x0F00) >> 8) + 1;
+
 			pc += 2;
 			break;
 
 		default:
-			Log::logW("Unknown opcode: " + convertOpcodeToPrintableHex(opcode));
+			if (!(InstrumentationFlags & FuzzInstrumentation))
+				warnUnknownOpcode(opcode);
 			break;
 		}
 		break;
 	default:
-		Log::logW("Unknown opcode: " + convertOpcodeToPrintableHex(opcode));
+		if (!(InstrumentationFlags & FuzzInstrumentation))
+			warnUnknownOpcode(opcode);
 		break;
 	}
 	
+	recordInstrumentation<InstrumentationFlags>(previousPc);
 
 	// Update timers
 	if (delayTimer > 0)
@@ -380,76 +873,185 @@ void Chip8::emulateCycle()
 
 	if (soundTimer > 0)
 		soundTimer--;
+
+	if (InstrumentationFlags & StateHashInstrumentation)
+		updateRegisterHash(hashedRegisters);
 }
 
-bool Chip8::loadROM(std::string path)
+template <int InstrumentationFlags>
+void Chip8::recordInstrumentation(unsigned short previousPc)
 {
-	FILE* programRaw = fopen(path.c_str(), "rb");
+	//Flags are compile time constants so the uninstrumented instantiation compiles this away
+	if (InstrumentationFlags & ProfilerInstrumentation)
+		profiler->recordInstruction(previousPc, opcode, pc);
 
-	if (programRaw == nullptr)
-	{
-		//fclose(programRaw);
+	if (InstrumentationFlags & FuzzInstrumentation)
+		fuzzFeedback->recordEdge(previousPc, pc);
 
-		Log::logE("Could not load requested ROM, likely a invalid path. Provided Path: " + path);
-		return false;
+	if (InstrumentationFlags & TraceInstrumentation)
+	{
+		unsigned char changedRegister = TraceBuffer::getChangedRegister(opcode);
+		traceBuffer->record(cycles, previousPc, opcode, I, changedRegister,
+			changedRegister == TraceBuffer::NO_REGISTER ? 0 : V[changedRegister]);
 	}
+}
+
+template <std::size_t... Combinations>
+Chip8::CycleFunction Chip8::getCycleFunction(int combination, std::index_sequence<Combinations...>)
+{
+	static const CycleFunction cycleFunctions[] =
+	{
+		&Chip8::executeCycle<(int)(Combinations % InstrumentationCombinations), (int)(Combinations / InstrumentationCombinations)>...
+	};
 
-	Log::logI("Loading ROM: " + path);
+	return cycleFunctions[combination];
+}
+
+void Chip8::selectCycleFunction()
+{
+	int flags = NoInstrumentation;
+
+	if (profiler != nullptr)
+		flags |= ProfilerInstrumentation;
+
+	if (traceBuffer != nullptr)
+		flags |= TraceInstrumentation;
+
+	if (stateHashing)
+		flags |= StateHashInstrumentation;
+
+	if (fuzzFeedback != nullptr)
+		flags |= FuzzInstrumentation;
+
+	cycleFunction = getCycleFunction(getQuirkFlags() * InstrumentationCombinations + flags,
+		std::make_index_sequence<InstrumentationCombinations * QuirkCombinations>());
+
+	//Compiled code has no per instruction hooks, so any instrumentation needs the interpreter
+	aotActive = (aotModule != nullptr && flags == NoInstrumentation && !eventTracing && rom != nullptr
+		&& aotModule->isCompatible(rom->hash, quirks));
+}
+
+int Chip8::getQuirkFlags() const
+{
+	int quirkFlags = NoQuirks;
+
+	if (quirks.shiftVxInPlace)
+		quirkFlags |= ShiftVxInPlaceQuirk;
+
+	if (quirks.loadStoreIncrementsI)
+		quirkFlags |= LoadStoreIncrementsIQuirk;
+
+	if (quirks.wrapSprites)
+		quirkFlags |= WrapSpritesQuirk;
+
+	if (quirks.addIndexSetsOverflow)
+		quirkFlags |= AddIndexSetsOverflowQuirk;
+
+	return quirkFlags;
+}
+
+void Chip8::setAotModule(const AotModule* newAotModule)
+{
+	aotModule = newAotModule;
+	selectCycleFunction();
+
+	if (aotModule != nullptr && !aotActive)
+		LOG_W("AOT module doesn't match the loaded ROM, quirks or instrumentation, using the interpreter");
+}
+
+void Chip8::setQuirks(const Quirks& newQuirks)
+{
+	quirks = newQuirks;
+	selectCycleFunction();
+}
+
+void Chip8::setProfiler(Profiler* newProfiler)
+{
+	profiler = newProfiler;
+	selectCycleFunction();
+}
+
+void Chip8::setTraceBuffer(TraceBuffer* newTraceBuffer)
+{
+	traceBuffer = newTraceBuffer;
+	selectCycleFunction();
+}
 
-	//Modified From: http://www.multigesture.net/articles/how-to-write-an-emulator-chip-8-interpreter/comment-page-1/#comments
+void Chip8::setEventTracing(bool enabled)
+{
+	eventTracing = enabled;
+	selectCycleFunction();
+}
 
-	// Check file size
-	fseek(programRaw, 0, SEEK_END);
-	long lSize = ftell(programRaw);
-	rewind(programRaw);
-	Log::logI("ROM Filesize: " + std::to_string(lSize));
+void Chip8::setFuzzFeedback(FuzzFeedback* newFuzzFeedback)
+{
+	fuzzFeedback = newFuzzFeedback;
+	selectCycleFunction();
+}
 
-	// Allocate memory to contain the whole file
-	char * buffer = (char*)malloc(sizeof(char) * lSize);
-	if (buffer == NULL)
+void Chip8::writeMemory(unsigned short address, const unsigned char* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
 	{
-		Log::logE("Could not allocate memory to load ROM");
-		fclose(programRaw);
-		//free(buffer);
-		return false;
+		const unsigned short target = (unsigned short)((address + i) & (MEMORY_SIZE - 1));
+
+		if (stateHashing)
+			stateHash ^= hashChange(MemoryHashLocation + target, memory.read(target), data[i]);
+
+		memory.write(target, data[i]);
 	}
+}
 
-	// Copy the file into the buffer
-	size_t result = fread(buffer, 1, lSize, programRaw);
-	if (result != (unsigned long)lSize)
+bool Chip8::loadROM(const std::string& path)
+{
+	LOG_I("Loading ROM: " + path);
+
+	std::shared_ptr<const RomImage> image = RomCache::load(path);
+
+	if (image == nullptr)
 	{
-		Log::logE("Could not read ROM into buffer");
-		fclose(programRaw);
-		free(buffer);
+		LOG_E("Could not load requested ROM, likely a invalid path. Provided Path: " + path);
 		return false;
 	}
 
-	// Copy buffer to Chip8 memory
-	if ((MEMORY_SIZE - 512) > lSize)
+	return loadROM(image);
+}
+
+bool Chip8::loadROM(const unsigned char* data, size_t size)
+{
+	return loadROM(RomCache::insert(data, size));
+}
+
+bool Chip8::loadROM(std::shared_ptr<const RomImage> image)
+{
+	LOG_I("ROM Filesize: " + std::to_string(image->data.size()));
+
+	if (image->data.size() > MEMORY_SIZE - 0x200)
 	{
-		for (int i = 0; i < lSize; ++i)
-			memory[i + 512] = buffer[i];
+		LOG_E("ROM too big for memory");
+		return false;
 	}
-	else
+
+	//Indexed ROMs carry their quirk profile, anything else keeps the current quirks
+	Quirks romQuirks;
+	if (RomLibrary::findQuirks(image->hash, romQuirks))
 	{
-		Log::logE("ROM too big for memory");
-		fclose(programRaw);
-		free(buffer);
-		return false;
+		setQuirks(romQuirks);
+		LOG_I("Applied ROM library quirk profile");
 	}
 
-	// Close file, free buffer
-	fclose(programRaw);
-	free(buffer);
-	
-	//END of copy
+	rom = std::move(image);
+	selectCycleFunction();
+
+	//Memory is pointed at the ROM image as part of the reset
+	reset();
 
 	return true;
 }
 
-unsigned char* Chip8::getScreenArray()
+void Chip8::copyScreen(unsigned char* out) const
 {
-	return gameScreen;
+	screen.copyTo(out);
 }
 
 bool Chip8::beepThisCycle()
@@ -467,32 +1069,14 @@ void Chip8::acknowledgeDrawFlag()
 	drawFlag = false;
 }
 
-void Chip8::setKeyDown(char keyIndex)
-{
-	keys[keyIndex] = true;
-}
-
-void Chip8::setKeyUp(char keyIndex)
+void Chip8::setKeypad(uint16_t newKeypad)
 {
-	keys[keyIndex] = false;
-}
-
-void Chip8::setKeyState(char keyIndex, bool state)
-{
-	keys[keyIndex] = state;
-}
-
-std::string Chip8::convertOpcodeToPrintableHex(unsigned short op)
-{
-	std::stringstream ss;
-	ss << std::hex << std::showbase << op;
-	return std::string(ss.str());
+	keypad = newKeypad;
 }
 
 void Chip8::clearScreen()
 {
-	for (int i = 0; i < WIDTH * HEIGHT; i++)
-	{
-		gameScreen[i] = 0;
-	}
+	//Back to the shared blank screen rather than writing every pixel, which hashes to 0
+	screen.reset();
+	screenHash = 0;
 }
@@ -1,19 +1,103 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+
+#include "PagedMemory.h"
+#include "Quirks.h"
+#include "aot/AotMachine.h"
+
+class Profiler;
+class TraceBuffer;
+class AotModule;
+class FrameMemo;
+struct FuzzFeedback;
+struct RomImage;
 
 class Chip8
 {
 public:
 	Chip8();
 
+	//Not copyable, the AOT machine points into the instance. fork() and shareState() copy the emulated state.
+	Chip8(const Chip8&) = delete;
+	Chip8& operator=(const Chip8&) = delete;
+
+	//An independent machine in the same state, in constant time. Memory and framebuffer pages are shared
+	//until either machine writes to them. The child keeps state hashing if it's on, but has no profiler,
+	//trace buffer or event tracing attached.
+	std::unique_ptr<Chip8> fork() const;
+
+	//Take the exact state of another machine in constant time, sharing its pages the same way as fork().
+	//Attached instrumentation stays with this machine, the ROM, quirks and AOT module come from the source.
+	void shareState(const Chip8& source);
+
 	void reset();
 
 	void emulateCycle();
 
-	bool loadROM(std::string path);
+	//Emulate a number of cycles, through the attached AOT module wherever it has compiled code
+	void runCycles(unsigned long long count);
+
+	//A keypad change partway through a frame
+	struct KeypadEvent
+	{
+		//Cycles into the frame the change lands on
+		unsigned long long cycle;
+		uint16_t keypad;
+	};
+
+	//Emulate a frame's cycle budget, applying each keypad change when the frame reaches its cycle.
+	//Events must be in cycle order, ones at or past the budget are applied at the end of the frame.
+	//Frames without events are replayed from the attached FrameMemo when it has seen them before,
+	//if the budget is at least FrameMemo::MIN_CYCLE_BUDGET.
+	void runFrame(unsigned long long cycleBudget, const KeypadEvent* events, size_t eventCount);
+
+	//Attach a memo of frame results, nullptr detaches it. The memo is keyed on the state hash so this turns
+	//state hashing on. Not used while instrumentation needs every instruction.
+	void setFrameMemo(FrameMemo* newFrameMemo);
+
+	//What a machine sitting in an idle loop is waiting on
+	enum IdleState
+	{
+		NotIdle,
+		WaitingForKey,   //FX0A with no key held, only cycles advance
+		WaitingForTimer, //FX07 / 3X00 / 1NNN polling the delay timer until it reaches 0
+		Halted           //1NNN jumping to itself, only cycles and timers advance
+	};
+
+	//The idle loop the machine is in, if any. Always NotIdle while instrumentation needs every instruction.
+	IdleState getIdleState();
+
+	//Cycles skipIdle could advance from here before the idle loop can end, 0 if not idle
+	unsigned long long getSkippableCycles();
+
+	//Advance up to maxCycles through the idle loop the machine is in, in constant time, leaving the state
+	//exactly as running them would. Returns the cycles advanced, 0 if the machine isn't idle.
+	unsigned long long skipIdle(unsigned long long maxCycles);
+
+	//Load a ROM file, through RomCache so only the first load of a path reads the file
+	bool loadROM(const std::string& path);
+
+	//Load a ROM that is already in memory
+	bool loadROM(const unsigned char* data, size_t size);
+
+	//Load a cached ROM image, reset() restores it so resetting never reloads the ROM.
+	//ROMs in the RomLibrary index have their quirk profile applied automatically.
+	bool loadROM(std::shared_ptr<const RomImage> image);
+
+	//Switches to the executeCycle instantiation compiled for these quirks
+	void setQuirks(const Quirks& newQuirks);
+
+	const Quirks& getQuirks() { return quirks; }
 
-	unsigned char* getScreenArray();
+	//Copy the WIDTH * HEIGHT framebuffer out, a byte per pixel
+	void copyScreen(unsigned char* out) const;
+
+	//Read a single framebuffer pixel
+	unsigned char getPixel(int x, int y) const { return screen.read(x + y * WIDTH); }
 
 	static const int WIDTH = 64;
 	static const int HEIGHT = 32;
@@ -29,16 +113,192 @@ public:
 	//Confirm that the draw call has been performed so the draw flag can be unset
 	void acknowledgeDrawFlag();
 
-	void setKeyDown(char keyIndex);
+	//Set which keypad keys are held, bit N for key N
+	void setKeypad(uint16_t newKeypad);
+
+	uint16_t getKeypad() { return keypad; }
+
+	//Attach a profiler that records every executed instruction, nullptr detaches it
+	void setProfiler(Profiler* newProfiler);
+
+	//Attach a trace buffer that keeps a binary record of recent instructions, nullptr detaches it
+	void setTraceBuffer(TraceBuffer* newTraceBuffer);
+
+	//Attach a module recompiled from the ROM, only used while it matches the ROM and quirks and nothing
+	//needs per instruction instrumentation. nullptr detaches it.
+	void setAotModule(const AotModule* newAotModule);
+
+	//Record DXYN draws as instant events when EventTrace is enabled
+	void setEventTracing(bool enabled);
+
+	//Attach feedback that records edge coverage and out of bounds accesses for fuzzing, nullptr detaches it
+	void setFuzzFeedback(FuzzFeedback* newFuzzFeedback);
+
+	//Write bytes straight into memory, wrapping at the end, for tools that patch a machine such as the fuzzer
+	void writeMemory(unsigned short address, const unsigned char* data, size_t size);
 
-	void setKeyUp(char keyIndex);
+	//Number of cycles emulated since the last reset
+	unsigned long long getCycleCount() { return cycles; }
 
-	void setKeyState(char keyIndex, bool state);
+	//Seed the CXNN random source, reset() goes back to the start of the seed's sequence
+	void setRandomSeed(uint32_t seed);
+
+	//Keep a Zobrist hash of the machine state up to date as instructions run. Like the other
+	//instrumentation it needs the interpreter, so AOT modules aren't used while it's on.
+	void setStateHashing(bool enabled);
+
+	//64 bit hash of the registers, I, pc, stack, timers, random source, memory and framebuffer. Cycles and
+	//the keypad aren't part of it. O(1) while state hashing is on, worked out from scratch otherwise.
+	uint64_t getStateHash();
 
 private:
+	//Bit flags selecting which hooks are compiled into an instantiation of executeCycle
+	enum Instrumentation
+	{
+		NoInstrumentation = 0,
+		ProfilerInstrumentation = 1,
+		TraceInstrumentation = 2,
+		StateHashInstrumentation = 4,
+		FuzzInstrumentation = 8,
+
+		InstrumentationCombinations = 16
+	};
+
+	//Bit flags selecting which quirk behaviours are compiled into an instantiation of executeCycle
+	enum QuirkPolicy
+	{
+		NoQuirks = 0,
+		ShiftVxInPlaceQuirk = 1,
+		LoadStoreIncrementsIQuirk = 2,
+		WrapSpritesQuirk = 4,
+		AddIndexSetsOverflowQuirk = 8,
+
+		QuirkCombinations = 16
+	};
+
+	typedef void (Chip8::*CycleFunction)();
+
+	//The executeCycle instantiation matching the attached instrumentation and quirks, picked once when they change
+	CycleFunction cycleFunction;
+
+	template <int InstrumentationFlags, int QuirkFlags>
+	void executeCycle();
+
+	template <int InstrumentationFlags>
+	void recordInstrumentation(unsigned short previousPc);
+
+	//Memory stores from executeCycle, updating the state hash when it's compiled in
+	template <int InstrumentationFlags>
+	void storeByte(unsigned short address, unsigned char value);
+
+	//Records a MemoryRangeFault when fuzzing if the bytes from I to I + lastOffset run past the end of memory
+	template <int InstrumentationFlags>
+	void checkMemoryRange(unsigned short lastOffset);
+
+	//Rate limited warning for opcodes executeCycle can't run. Kept out of the template so every
+	//instantiation shares one limiter.
+	static void warnUnknownOpcode(unsigned short opcode);
+
+	void selectCycleFunction();
+
+	//The QuirkPolicy flags matching quirks
+	int getQuirkFlags() const;
+
+	//Looks up the instantiation for a combination of flags (quirk flags * InstrumentationCombinations + instrumentation flags),
+	//from a table holding one for every combination
+	template <std::size_t... Combinations>
+	static CycleFunction getCycleFunction(int combination, std::index_sequence<Combinations...>);
+
+	Profiler* profiler;
+
+	TraceBuffer* traceBuffer;
+
+	bool eventTracing;
+
+	bool stateHashing;
+
+	FuzzFeedback* fuzzFeedback;
+
+	//Zobrist locations of each part of the state, memory and the framebuffer take a location per byte
+	enum HashLocation
+	{
+		MemoryHashLocation = 0x0000,
+		ScreenHashLocation = 0x1000,
+		RegisterHashLocation = 0x1800,
+		StackHashLocation = 0x1810,
+		IndexHashLocation = 0x1820,
+		PcHashLocation,
+		SpHashLocation,
+		DelayTimerHashLocation,
+		SoundTimerHashLocation,
+		RandomHashLocation
+	};
+
+	//Hash of everything but the framebuffer, and of the framebuffer which 00E0 zeroes in one go
+	uint64_t stateHash;
+	uint64_t screenHash;
+
+	//The registers an instruction can change, copied before it runs so only the ones that changed are rehashed
+	struct HashedRegisters
+	{
+		unsigned char V[16];
+		unsigned short stack[16];
+		unsigned short I;
+		unsigned short pc;
+		unsigned short sp;
+		unsigned char delayTimer;
+		unsigned char soundTimer;
+		uint32_t randomState;
+	};
+
+	void saveHashedRegisters(HashedRegisters& registers) const;
+
+	void updateRegisterHash(const HashedRegisters& before);
+
+	//Hash every location from scratch
+	void computeStateHash();
+
+	const AotModule* aotModule;
+
+	//Pointers into this instance for the AOT module
+	AotMachine aotMachine;
+
+	//Can runCycles use the AOT module, worked out with the cycle function
+	bool aotActive;
+
+	FrameMemo* frameMemo;
+
+	//Run a frame without keypad changes through the frame memo, replaying it if it has been run before
+	void runMemoisedFrame(unsigned long long cycleBudget);
+
+	//Finds the FX07 at the start of a delay timer polling loop that pc is part of
+	bool findTimerLoop(unsigned short& loopStart);
+
+	//Random source for CXNN, shared with AOT modules so both give the same sequence
+	static unsigned char randomByte(void* context);
+
+	//Per machine xorshift32 state, so a machine's future only depends on its own state
+	uint32_t randomSeed;
+	uint32_t randomState;
+
+	//Lets AOT modules store through the same copy on write as the interpreter
+	static unsigned char* writablePage(void* context, unsigned short address);
+
+	//The framebuffer equivalents for AOT modules
+	static unsigned char* writableScreenPage(void* context, unsigned short offset);
+	static void clearScreen(void* context);
+
+	unsigned long long cycles;
+
+	//The loaded ROM, memory goes back to its image on every reset
+	std::shared_ptr<const RomImage> rom;
+
+	Quirks quirks;
+
 	unsigned short opcode;
 
-	unsigned char memory[MEMORY_SIZE];
+	//Pages of the shared ROM image, copied on first write
+	PagedMemory<MEMORY_SIZE> memory;
 
 	//Registers
 	unsigned char V[16];
@@ -46,7 +306,8 @@ private:
 	unsigned short I; //Index Register
 	unsigned short pc; //Program Counter
 
-	unsigned char gameScreen[WIDTH * HEIGHT];
+	//A byte per pixel, 4 rows to a page, pages read a shared blank screen until drawn to
+	PagedMemory<WIDTH * HEIGHT> screen;
 
 	unsigned char delayTimer;
 	unsigned char soundTimer;
@@ -54,11 +315,10 @@ private:
 	unsigned short stack[16];
 	unsigned short sp; // Stack Pointer
 
-	bool keys[16];
+	//Held keys, bit N for key N
+	uint16_t keypad;
 
 	bool drawFlag;
 
-	std::string convertOpcodeToPrintableHex(unsigned short op);
-
 	void clearScreen();
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "FrameMemo.h"
+
+FrameMemo::FrameMemo(size_t capacity)
+	: capacity(capacity > 0 ? capacity : 1), stats()
+{
+	index.reserve(this->capacity);
+}
+
+const FrameMemo::Entry* FrameMemo::find(const Key& key)
+{
+	auto found = index.find(key);
+
+	if (found == index.end())
+	{
+		stats.misses++;
+		return nullptr;
+	}
+
+	stats.hits++;
+
+	entries.splice(entries.begin(), entries, found->second);
+	return &found->second->second;
+}
+
+void FrameMemo::insert(const Key& key, std::unique_ptr<Chip8> result, bool drew)
+{
+	auto found = index.find(key);
+
+	if (found != index.end())
+	{
+		found->second->second.result = std::move(result);
+		found->second->second.drew = drew;
+		entries.splice(entries.begin(), entries, found->second);
+		return;
+	}
+
+	if (entries.size() >= capacity)
+	{
+		index.erase(entries.back().first);
+		entries.pop_back();
+		stats.evictions++;
+	}
+
+	Entry entry;
+	entry.result = std::move(result);
+	entry.drew = drew;
+
+	entries.emplace_front(key, std::move(entry));
+	index[key] = entries.begin();
+}
+
+void FrameMemo::clear()
+{
+	index.clear();
+	entries.clear();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "Chip8.h"
+
+/**
+@brief Bounded LRU cache of whole frame results, keyed on the state a frame started from.
+
+A frame is deterministic given the machine state, keypad and cycle budget, so a frame that starts
+from a state and keypad seen before ends where it did last time. Each entry keeps a fork of the
+machine as the frame left it, which shares every page the frame didn't write with the machine it
+came from, so an entry only costs the pages the frame changed plus its registers. Replaying one is
+Chip8::shareState(), constant time however many cycles the frame ran.
+
+Attract mode loops and menus sitting still repeat the same frames, so they end up costing a lookup.
+The key takes in the quirks and AOT module a replay copies over along with the state, so machines
+running with different ones can share a memo. Not thread safe.
+
+It only pays off when most frames repeat. Keying needs the incremental state hash, which made an
+interpreted cycle around 4x slower in a register heavy loop and rules out AOT, and each miss forks
+the machine, around half a microsecond, while a hit is around 50ns. A hit only beats running a frame
+of a few cycles, so frames under MIN_CYCLE_BUDGET cycles always run normally.
+*/
+class FrameMemo
+{
+public:
+	/** @brief Smallest cycle budget worth memoising, below it a miss costs more than most hits save. */
+	static const unsigned long long MIN_CYCLE_BUDGET = 64;
+
+	/** @brief What a frame started from. */
+	struct Key
+	{
+		uint64_t stateHash;
+		unsigned long long cycleBudget;
+		uint16_t keypad;
+
+		///Chip8::QuirkPolicy flags
+		int quirkFlags;
+
+		///Only compared, never dereferenced
+		const AotModule* aotModule;
+
+		bool operator==(const Key& other) const
+		{
+			return stateHash == other.stateHash && cycleBudget == other.cycleBudget && keypad == other.keypad
+				&& quirkFlags == other.quirkFlags && aotModule == other.aotModule;
+		}
+	};
+
+	/** @brief Where a frame ended up. */
+	struct Entry
+	{
+		std::unique_ptr<Chip8> result;
+
+		///Did the frame draw, the result's draw flag also carries whatever was set before the frame
+		bool drew;
+	};
+
+	struct Stats
+	{
+		unsigned long long hits;
+		unsigned long long misses;
+		unsigned long long evictions;
+	};
+
+	/**
+	@brief Constructor
+
+	@param capacity Frames kept before the least recently used is dropped.
+	*/
+	explicit FrameMemo(size_t capacity);
+
+	/**
+	@brief Look up a frame, making it the most recently used.
+
+	@return The entry, nullptr if the frame hasn't been run. Valid until the next insert() or clear().
+	*/
+	const Entry* find(const Key& key);
+
+	/** @brief Store the result of a frame, dropping the least recently used frame if full. */
+	void insert(const Key& key, std::unique_ptr<Chip8> result, bool drew);
+
+	/** @brief Drop every frame. */
+	void clear();
+
+	size_t getSize() const { return entries.size(); }
+
+	size_t getCapacity() const { return capacity; }
+
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			//Already a good hash, mixing in the rest is enough
+			return (size_t)(key.stateHash ^ (key.cycleBudget * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)key.keypad << 48)
+				^ ((uint64_t)key.quirkFlags << 40) ^ (uint64_t)(uintptr_t)key.aotModule);
+		}
+	};
+
+	typedef std::list<std::pair<Key, Entry>> EntryList;
+
+	size_t capacity;
+
+	///Most recently used first
+	EntryList entries;
+
+	std::unordered_map<Key, EntryList::iterator, KeyHash> index;
+
+	Stats stats;
+};
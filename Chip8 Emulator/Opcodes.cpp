@@ -0,0 +1,163 @@
+#include "Opcodes.h"
+
+#include <cstdio>
+
+namespace
+{
+	const char* patterns[Opcodes::ClassCount] =
+	{
+		"00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0",
+		"6XNN", "7XNN", "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5",
+		"8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN",
+		"EX9E", "EXA1", "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29",
+		"FX33", "FX55", "FX65", "????"
+	};
+}
+
+Opcodes::Class Opcodes::classify(unsigned short opcode)
+{
+	//Mirrors the decoding done in Chip8::emulateCycle
+	switch (opcode & 0xF000)
+	{
+	case 0x0000:
+		switch (opcode & 0x0FFF)
+		{
+		case 0x00E0: return ClearScreen;
+		case 0x00EE: return Return;
+		default: return SysCall;
+		}
+
+	case 0x1000: return Jump;
+	case 0x2000: return Call;
+	case 0x3000: return SkipEqualImm;
+	case 0x4000: return SkipNotEqualImm;
+	case 0x5000: return SkipEqualReg;
+	case 0x6000: return LoadImm;
+	case 0x7000: return AddImm;
+
+	case 0x8000:
+		switch (opcode & 0x000F)
+		{
+		case 0x0000: return Move;
+		case 0x0001: return Or;
+		case 0x0002: return And;
+		case 0x0003: return Xor;
+		case 0x0004: return Add;
+		case 0x0005: return Sub;
+		case 0x0006: return ShiftRight;
+		case 0x0007: return SubReverse;
+		case 0x000E: return ShiftLeft;
+		default: return Unknown;
+		}
+
+	case 0x9000: return SkipNotEqualReg;
+	case 0xA000: return LoadI;
+	case 0xB000: return JumpV0;
+	case 0xC000: return Random;
+	case 0xD000: return Draw;
+
+	case 0xE000:
+		switch (opcode & 0x00FF)
+		{
+		case 0x009E: return SkipKey;
+		case 0x00A1: return SkipNotKey;
+		default: return Unknown;
+		}
+
+	case 0xF000:
+		switch (opcode & 0x00FF)
+		{
+		case 0x0007: return GetDelay;
+		case 0x000A: return WaitKey;
+		case 0x0015: return SetDelay;
+		case 0x0018: return SetSound;
+		case 0x001E: return AddI;
+		case 0x0029: return FontCharacter;
+		case 0x0033: return StoreBCD;
+		case 0x0055: return StoreRegisters;
+		case 0x0065: return LoadRegisters;
+		default: return Unknown;
+		}
+
+	default:
+		return Unknown;
+	}
+}
+
+const char* Opcodes::getPattern(Class opClass)
+{
+	if (opClass < 0 || opClass >= ClassCount)
+		return patterns[Unknown];
+
+	return patterns[opClass];
+}
+
+bool Opcodes::isSkip(Class opClass)
+{
+	switch (opClass)
+	{
+	case SkipEqualImm:
+	case SkipNotEqualImm:
+	case SkipEqualReg:
+	case SkipNotEqualReg:
+	case SkipKey:
+	case SkipNotKey:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+std::string Opcodes::disassemble(unsigned short opcode)
+{
+	const unsigned int x = (opcode & 0x0F00) >> 8;
+	const unsigned int y = (opcode & 0x00F0) >> 4;
+	const unsigned int n = opcode & 0x000F;
+	const unsigned int nn = opcode & 0x00FF;
+	const unsigned int nnn = opcode & 0x0FFF;
+
+	char text[32];
+
+	switch (classify(opcode))
+	{
+	case ClearScreen:     return "CLS";
+	case Return:          return "RET";
+	case SysCall:         snprintf(text, sizeof(text), "SYS 0x%03X", nnn); break;
+	case Jump:            snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+	case Call:            snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+	case SkipEqualImm:    snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, nn); break;
+	case SkipNotEqualImm: snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, nn); break;
+	case SkipEqualReg:    snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+	case LoadImm:         snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, nn); break;
+	case AddImm:          snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, nn); break;
+	case Move:            snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+	case Or:              snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+	case And:             snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+	case Xor:             snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+	case Add:             snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+	case Sub:             snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+	case ShiftRight:      snprintf(text, sizeof(text), "SHR V%X, V%X", x, y); break;
+	case SubReverse:      snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+	case ShiftLeft:       snprintf(text, sizeof(text), "SHL V%X, V%X", x, y); break;
+	case SkipNotEqualReg: snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+	case LoadI:           snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+	case JumpV0:          snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+	case Random:          snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, nn); break;
+	case Draw:            snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+	case SkipKey:         snprintf(text, sizeof(text), "SKP V%X", x); break;
+	case SkipNotKey:      snprintf(text, sizeof(text), "SKNP V%X", x); break;
+	case GetDelay:        snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+	case WaitKey:         snprintf(text, sizeof(text), "LD V%X, K", x); break;
+	case SetDelay:        snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+	case SetSound:        snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+	case AddI:            snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+	case FontCharacter:   snprintf(text, sizeof(text), "LD F, V%X", x); break;
+	case StoreBCD:        snprintf(text, sizeof(text), "LD B, V%X", x); break;
+	case StoreRegisters:  snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+	case LoadRegisters:   snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+	default:              snprintf(text, sizeof(text), "DW 0x%04X", opcode); break;
+	}
+
+	return text;
+}
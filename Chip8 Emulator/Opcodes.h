@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+
+/**
+@brief Helpers for identifying Chip8 instructions outside of the interpreter.
+
+Shared by the debugging and analysis tools so they all agree on how an opcode is classified.
+*/
+namespace Opcodes
+{
+	/** @brief Every instruction the interpreter understands, plus Unknown for anything else. */
+	enum Class
+	{
+		ClearScreen,     ///< 00E0
+		Return,          ///< 00EE
+		SysCall,         ///< 0NNN
+		Jump,            ///< 1NNN
+		Call,            ///< 2NNN
+		SkipEqualImm,    ///< 3XNN
+		SkipNotEqualImm, ///< 4XNN
+		SkipEqualReg,    ///< 5XY0
+		LoadImm,         ///< 6XNN
+		AddImm,          ///< 7XNN
+		Move,            ///< 8XY0
+		Or,              ///< 8XY1
+		And,             ///< 8XY2
+		Xor,             ///< 8XY3
+		Add,             ///< 8XY4
+		Sub,             ///< 8XY5
+		ShiftRight,      ///< 8XY6
+		SubReverse,      ///< 8XY7
+		ShiftLeft,       ///< 8XYE
+		SkipNotEqualReg, ///< 9XY0
+		LoadI,           ///< ANNN
+		JumpV0,          ///< BNNN
+		Random,          ///< CXNN
+		Draw,            ///< DXYN
+		SkipKey,         ///< EX9E
+		SkipNotKey,      ///< EXA1
+		GetDelay,        ///< FX07
+		WaitKey,         ///< FX0A
+		SetDelay,        ///< FX15
+		SetSound,        ///< FX18
+		AddI,            ///< FX1E
+		FontCharacter,   ///< FX29
+		StoreBCD,        ///< FX33
+		StoreRegisters,  ///< FX55
+		LoadRegisters,   ///< FX65
+		Unknown,         ///< Anything the interpreter logs as unknown
+
+		ClassCount
+	};
+
+	/**
+	@brief Works out which instruction an opcode is.
+
+	@param opcode The full 2 byte opcode.
+
+	@return The instruction class, Unknown if the interpreter doesn't support it.
+	*/
+	Class classify(unsigned short opcode);
+
+	/**
+	@brief Gets the opcode pattern for a class, in the usual XNNN style notation (e.g. "8XY4").
+
+	@param opClass The instruction class.
+
+	@return Null terminated pattern string.
+	*/
+	const char* getPattern(Class opClass);
+
+	///Is the instruction one of the conditional skips (3XNN, 4XNN, 5XY0, 9XY0, EX9E, EXA1)
+	bool isSkip(Class opClass);
+
+	/**
+	@brief Gets the assembly for an opcode, in the common Cowgod mnemonics (e.g. "ADD V1, V2").
+
+	@param opcode The full 2 byte opcode.
+
+	@return The instruction text, "DW 0xNNNN" if the interpreter doesn't support it.
+	*/
+	std::string disassemble(unsigned short opcode);
+}
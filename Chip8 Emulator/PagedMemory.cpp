@@ -0,0 +1,91 @@
+#include "PagedMemory.h"
+
+#include <cstring>
+
+#include "Chip8.h"
+
+template <int Size>
+const int PagedMemory<Size>::SIZE;
+
+template <int Size>
+const int PagedMemory<Size>::PAGE_BITS;
+
+template <int Size>
+const int PagedMemory<Size>::PAGE_SIZE;
+
+template <int Size>
+const int PagedMemory<Size>::PAGE_COUNT;
+
+template <int Size>
+PagedMemory<Size>::PagedMemory()
+{
+	reset(nullptr);
+}
+
+template <int Size>
+void PagedMemory<Size>::reset(std::shared_ptr<const unsigned char> newImage)
+{
+	image = (newImage != nullptr ? std::move(newImage) : getZeroImage());
+
+	for (int page = 0; page < PAGE_COUNT; page++)
+	{
+		pages[page] = image.get() + page * PAGE_SIZE;
+		ownedPages[page].reset();
+	}
+}
+
+template <int Size>
+void PagedMemory<Size>::shareFrom(const PagedMemory& other)
+{
+	image = other.image;
+
+	for (int page = 0; page < PAGE_COUNT; page++)
+	{
+		pages[page] = other.pages[page];
+		ownedPages[page] = other.ownedPages[page];
+	}
+}
+
+template <int Size>
+int PagedMemory<Size>::getOwnedPageCount() const
+{
+	int count = 0;
+
+	for (int page = 0; page < PAGE_COUNT; page++)
+	{
+		if (ownedPages[page] != nullptr)
+			count++;
+	}
+
+	return count;
+}
+
+template <int Size>
+void PagedMemory<Size>::copyTo(unsigned char* out) const
+{
+	for (int page = 0; page < PAGE_COUNT; page++)
+	{
+		memcpy(out + page * PAGE_SIZE, pages[page], PAGE_SIZE);
+	}
+}
+
+template <int Size>
+void PagedMemory<Size>::copyPage(int page)
+{
+	std::shared_ptr<unsigned char> copy(new unsigned char[PAGE_SIZE], std::default_delete<unsigned char[]>());
+	memcpy(copy.get(), pages[page], PAGE_SIZE);
+
+	pages[page] = copy.get();
+	ownedPages[page] = std::move(copy);
+}
+
+template <int Size>
+std::shared_ptr<const unsigned char> PagedMemory<Size>::getZeroImage()
+{
+	static const std::shared_ptr<const unsigned char> zeros(new unsigned char[SIZE](), std::default_delete<unsigned char[]>());
+	return zeros;
+}
+
+//The only sizes Chip8 uses, the address space and the framebuffer
+template class PagedMemory<Chip8::MEMORY_SIZE>;
+template class PagedMemory<Chip8::WIDTH * Chip8::HEIGHT>;
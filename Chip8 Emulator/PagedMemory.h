@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+/**
+@brief A block of machine state split into pages that are shared until written.
+
+Every page starts out reading straight from a shared, read only image. The first write to a
+page that anything else can see copies it into a page of its own, so a machine only holds the
+pages it has written, resetting is just pointing every page back at the image, and shareFrom()
+hands a copy every page in constant time. Addresses wrap at Size, which must be a power of 2.
+
+Used for both the 4KB address space, whose image is the font and ROM, and the framebuffer,
+whose image is a blank screen.
+*/
+template <int Size>
+class PagedMemory
+{
+public:
+	static const int SIZE = Size;
+	static const int PAGE_BITS = 8;
+	static const int PAGE_SIZE = 1 << PAGE_BITS;
+	static const int PAGE_COUNT = SIZE / PAGE_SIZE;
+
+	static_assert((SIZE & (SIZE - 1)) == 0 && SIZE >= PAGE_SIZE, "PagedMemory needs a power of 2 number of whole pages");
+
+	/** @brief Starts out reading an all zero image. */
+	PagedMemory();
+
+	//Sharing pages is explicit through shareFrom
+	PagedMemory(const PagedMemory&) = delete;
+	PagedMemory& operator=(const PagedMemory&) = delete;
+
+	/**
+	@brief Point every page at an image, dropping any written pages.
+
+	@param newImage SIZE bytes, nullptr for all zeros.
+	*/
+	void reset(std::shared_ptr<const unsigned char> newImage);
+
+	/** @brief Point every page back at the current image. */
+	void reset() { reset(image); }
+
+	/** @brief Take the same contents as another instance in constant time, sharing all of its pages. */
+	void shareFrom(const PagedMemory& other);
+
+	unsigned char read(unsigned int address) const
+	{
+		return pages[(address >> PAGE_BITS) & (PAGE_COUNT - 1)][address & (PAGE_SIZE - 1)];
+	}
+
+	void write(unsigned int address, unsigned char value)
+	{
+		getWritablePage(address)[address & (PAGE_SIZE - 1)] = value;
+	}
+
+	/** @brief The page holding an address, copied first if the image or another instance can still see it. */
+	unsigned char* getWritablePage(unsigned int address)
+	{
+		int page = (address >> PAGE_BITS) & (PAGE_COUNT - 1);
+
+		if (ownedPages[page] == nullptr || ownedPages[page].use_count() > 1)
+			copyPage(page);
+
+		return ownedPages[page].get();
+	}
+
+	/** @brief The read pointer of every page, which stays at the same address for AOT modules to index. */
+	const unsigned char* const* getPages() const { return pages; }
+
+	/** @brief Number of pages that no longer read from the image. */
+	int getOwnedPageCount() const;
+
+	/** @brief Copy everything out, for code that wants it flat. */
+	void copyTo(unsigned char* out) const;
+
+private:
+	std::shared_ptr<const unsigned char> image;
+
+	///Where each page is read from, the image or a written copy
+	const unsigned char* pages[PAGE_COUNT];
+
+	///Written pages, nullptr while a page still reads from the image. Shared after shareFrom until one side writes
+	std::shared_ptr<unsigned char> ownedPages[PAGE_COUNT];
+
+	void copyPage(int page);
+
+	/** @brief SIZE bytes of zeros, shared by every instance without an image. */
+	static std::shared_ptr<const unsigned char> getZeroImage();
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+@brief Behaviours that differ between Chip8 interpreters, which ROMs written for one rely on.
+
+The defaults match how this interpreter has always behaved, so ROMs without a profile run
+exactly as before.
+*/
+struct Quirks
+{
+	/** @brief The interpreter families ROMs are written for. */
+	enum Platform
+	{
+		Chip8Platform,     ///< Original COSMAC VIP interpreter
+		SuperChipPlatform, ///< SCHIP on the HP48
+		XOChipPlatform,    ///< Octo's XO-CHIP extensions
+
+		PlatformCount
+	};
+
+	///8XY6/8XYE shift Vx in place, rather than storing Vy shifted into Vx
+	bool shiftVxInPlace = true;
+
+	///FX55/FX65 leave I pointing past the last register transferred (I += X + 1)
+	bool loadStoreIncrementsI = false;
+
+	///DXYN wraps pixels that go off the edge of the screen to the other side, rather than clipping them
+	bool wrapSprites = false;
+
+	///FX1E sets VF to 1 when I goes past 0xFFF, and to 0 otherwise
+	bool addIndexSetsOverflow = false;
+
+	/** @brief The profile most ROMs written for a platform expect. */
+	static Quirks forPlatform(Platform platform)
+	{
+		Quirks quirks;
+		quirks.shiftVxInPlace = (platform == SuperChipPlatform);
+		quirks.loadStoreIncrementsI = (platform != SuperChipPlatform);
+		quirks.wrapSprites = (platform == XOChipPlatform);
+		quirks.addIndexSetsOverflow = false;
+		return quirks;
+	}
+
+	static const char* getPlatformName(Platform platform)
+	{
+		static const char* names[PlatformCount] = { "CHIP-8", "SCHIP", "XO-CHIP" };
+		return names[platform];
+	}
+};
@@ -0,0 +1,408 @@
+#include "AotCompiler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "AotMachine.h"
+#include "AotModule.h"
+#include "../Opcodes.h"
+#include "../misc/Log.h"
+#include "../rom/RomCache.h"
+
+namespace
+{
+	std::string toHex(unsigned int value, int width)
+	{
+		std::stringstream ss;
+		ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+		return ss.str();
+	}
+
+	//Helpers every generated module starts with. Registers the interpreter keeps in Chip8 are
+	//copied into locals for the length of a block and written back by leave().
+	const char* PRELUDE = R"(
+namespace
+{
+	struct Registers
+	{
+		unsigned short I;
+		unsigned char delayTimer;
+		unsigned char soundTimer;
+	};
+
+	inline void tick(Registers& r)
+	{
+		if (r.delayTimer > 0)
+			r.delayTimer--;
+
+		if (r.soundTimer > 0)
+			r.soundTimer--;
+	}
+
+	inline unsigned int leave(AotMachine* m, const Registers& r, unsigned short pc, unsigned int executed)
+	{
+		*m->I = r.I;
+		*m->delayTimer = r.delayTimer;
+		*m->soundTimer = r.soundTimer;
+		*m->pc = pc;
+		*m->cycles += executed;
+		return executed;
+	}
+
+	inline unsigned char load(AotMachine* m, unsigned int address)
+	{
+		return m->pages[(address >> 8) & 0xF][address & 0xFF];
+	}
+
+	inline void store(AotMachine* m, unsigned int address, unsigned char value)
+	{
+		m->writablePage(m->context, (unsigned short)(address & 0xFFF))[address & 0xFF] = value;
+	}
+
+	//Compares memory against the original ROM a page at a time
+	inline bool matches(AotMachine* m, unsigned int address, const unsigned char* expected, unsigned int length)
+	{
+		while (length > 0)
+		{
+			unsigned int chunk = 0x100 - (address & 0xFF);
+			if (chunk > length)
+				chunk = length;
+
+			if (memcmp(m->pages[(address >> 8) & 0xF] + (address & 0xFF), expected, chunk) != 0)
+				return false;
+
+			address += chunk;
+			expected += chunk;
+			length -= chunk;
+		}
+
+		return true;
+	}
+
+	inline void draw(AotMachine* m, unsigned short I, unsigned char vx, unsigned char vy, unsigned int height)
+	{
+		unsigned char* V = m->V;
+		unsigned int x = vx & 63;
+		unsigned int y = vy & 31;
+		unsigned int rows = (WRAP_SPRITES || height <= 32 - y) ? height : 32 - y;
+		unsigned int columns = (WRAP_SPRITES || x + 8 <= 64) ? 8 : 64 - x;
+
+		//Clipping only shortens the loops, every row and column is masked onto the screen
+		V[0xF] = 0;
+		for (unsigned int yline = 0; yline < rows; yline++)
+		{
+			unsigned int row = (y + yline) & 31;
+
+			unsigned char pixel = load(m, I + yline);
+			for (unsigned int xline = 0; xline < columns; xline++)
+			{
+				unsigned int column = (x + xline) & 63;
+
+				if ((pixel & (0x80 >> xline)) != 0)
+				{
+					unsigned int offset = column + row * 64;
+
+					if (m->screenPages[(offset >> 8) & 7][offset & 0xFF] == 1)
+						V[0xF] = 1;
+
+					m->writableScreenPage(m->context, (unsigned short)offset)[offset & 0xFF] ^= 1;
+				}
+			}
+		}
+	}
+)";
+}
+
+std::string AotCompiler::generateSource(const RomAnalyser::Analysis& analysis, const RomImage& image, const Quirks& quirks)
+{
+	std::stringstream ss;
+
+	char hashText[17];
+	snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)image.hash);
+
+	ss << "//Generated by the Chip8 Emulator AOT recompiler from ROM " << hashText << ", do not edit" << std::endl;
+	ss << std::endl << "#include <cstring>" << std::endl << std::endl;
+	ss << AOT_MACHINE_SOURCE << std::endl << std::endl;
+
+	ss << "#ifdef _WIN32" << std::endl << "#define AOT_EXPORT extern \"C\" __declspec(dllexport)" << std::endl
+		<< "#else" << std::endl << "#define AOT_EXPORT extern \"C\" __attribute__((visibility(\"default\")))" << std::endl
+		<< "#endif" << std::endl << std::endl;
+
+	ss << "#define WRAP_SPRITES " << (quirks.wrapSprites ? "true" : "false") << std::endl;
+	ss << PRELUDE << std::endl;
+
+	//The original ROM, each block checks its bytes still match before it runs
+	ss << "\tconst unsigned char rom[] =" << std::endl << "\t{";
+	for (size_t i = 0; i < image.data.size(); i++)
+		ss << (i % 16 == 0 ? "\n\t\t" : " ") << toHex(image.data[i], 2) << ",";
+
+	ss << (image.data.empty() ? "0" : "") << std::endl << "\t};" << std::endl;
+
+	for (auto& entry : analysis.blocks)
+	{
+		const RomAnalyser::BasicBlock& block = entry.second;
+
+		ss << std::endl << "\t//Block " << toHex(block.start, 3) << " - " << toHex(block.end - 2, 3) << std::endl;
+		ss << "\tunsigned int block" << std::hex << block.start << std::dec << "(AotMachine* m)" << std::endl << "\t{" << std::endl;
+		ss << "\t\tunsigned char* V = m->V;" << std::endl;
+		ss << "\t\tRegisters r = { *m->I, *m->delayTimer, *m->soundTimer };" << std::endl;
+		ss << "\t\t(void)V;" << std::endl;
+
+		bool endsBlock = false;
+		unsigned int executed = 0;
+
+		for (unsigned short address = block.start; address < block.end && !endsBlock; address += 2)
+		{
+			unsigned short opcode = (unsigned short)(image.data[address - RomAnalyser::LOAD_ADDRESS] << 8
+				| image.data[address + 1 - RomAnalyser::LOAD_ADDRESS]);
+
+			executed++;
+
+			ss << std::endl << "\t\t//" << toHex(address, 3) << ": " << Opcodes::disassemble(opcode) << std::endl;
+			ss << generateInstruction(address, opcode, block.end, quirks, executed, endsBlock);
+		}
+
+		if (!endsBlock)
+			ss << std::endl << "\t\treturn leave(m, r, " << toHex(block.end, 3) << ", " << executed << ");" << std::endl;
+
+		ss << "\t}" << std::endl;
+	}
+
+	ss << "}" << std::endl << std::endl;
+
+	ss << "AOT_EXPORT int chip8AotAbiVersion() { return " << AOT_ABI_VERSION << "; }" << std::endl;
+	ss << "AOT_EXPORT unsigned long long chip8AotRomHash() { return 0x" << hashText << "ULL; }" << std::endl;
+	ss << "AOT_EXPORT int chip8AotQuirks() { return " << AotModule::getQuirkFlags(quirks) << "; }" << std::endl << std::endl;
+
+	//Dispatch on pc, so returns and BNNN jumps find their block the same way as everything else
+	ss << "AOT_EXPORT unsigned long long chip8AotRun(AotMachine* m, unsigned long long budget)" << std::endl << "{" << std::endl;
+	ss << "\tunsigned long long executed = 0;" << std::endl << std::endl;
+	ss << "\tfor (;;)" << std::endl << "\t{" << std::endl;
+	ss << "\t\tswitch (*m->pc)" << std::endl << "\t\t{" << std::endl;
+
+	for (auto& entry : analysis.blocks)
+	{
+		const RomAnalyser::BasicBlock& block = entry.second;
+		unsigned int length = block.end - block.start;
+
+		ss << "\t\tcase " << toHex(block.start, 3) << ":" << std::endl;
+		ss << "\t\t\tif (budget - executed < " << length / 2 << " || !matches(m, " << toHex(block.start, 3)
+			<< ", rom + " << toHex(block.start - RomAnalyser::LOAD_ADDRESS, 3) << ", " << length << "))" << std::endl;
+		ss << "\t\t\t\treturn executed;" << std::endl;
+		ss << "\t\t\texecuted += block" << std::hex << block.start << std::dec << "(m);" << std::endl;
+		ss << "\t\t\tbreak;" << std::endl;
+	}
+
+	ss << "\t\tdefault:" << std::endl << "\t\t\treturn executed;" << std::endl;
+	ss << "\t\t}" << std::endl << "\t}" << std::endl << "}" << std::endl;
+
+	return ss.str();
+}
+
+std::string AotCompiler::generateInstruction(unsigned short address, unsigned short opcode, unsigned short blockEnd,
+	const Quirks& quirks, unsigned int executed, bool& endsBlock)
+{
+	const std::string x = std::to_string((opcode & 0x0F00) >> 8);
+	const std::string y = std::to_string((opcode & 0x00F0) >> 4);
+	const std::string n = std::to_string(opcode & 0x000F);
+	const std::string nn = toHex(opcode & 0x00FF, 2);
+	const std::string nnn = toHex(opcode & 0x0FFF, 3);
+	const std::string next = toHex(address + 2, 3);
+	const std::string skip = toHex(address + 4, 3);
+	const std::string count = std::to_string(executed);
+
+	//The interpreter ticks the timers after every instruction it completes
+	const std::string tick = "\t\ttick(r);\n";
+
+	auto leaveTo = [&](const std::string& pc)
+	{
+		endsBlock = true;
+		return tick + "\t\treturn leave(m, r, " + pc + ", " + count + ");\n";
+	};
+
+	auto skipIf = [&](const std::string& condition)
+	{
+		return leaveTo("(" + condition + ") ? " + skip + " : " + next);
+	};
+
+	const std::string shiftSource = (quirks.shiftVxInPlace ? "V[" + x + "]" : "V[" + y + "]");
+
+	std::string code;
+
+	switch (Opcodes::classify(opcode))
+	{
+	case Opcodes::ClearScreen:
+		return "\t\tm->clearScreen(m->context);\n\t\t*m->drawFlag = true;\n" + tick;
+
+	case Opcodes::Return:
+		return "\t\t(*m->sp)--;\n" + leaveTo("m->stack[*m->sp & 0xF] + 2");
+
+	case Opcodes::Jump:
+		return leaveTo(nnn);
+
+	case Opcodes::Call:
+		return "\t\tm->stack[*m->sp & 0xF] = " + toHex(address, 3) + ";\n\t\t(*m->sp)++;\n" + leaveTo(nnn);
+
+	case Opcodes::SkipEqualImm:    return skipIf("V[" + x + "] == " + nn);
+	case Opcodes::SkipNotEqualImm: return skipIf("V[" + x + "] != " + nn);
+	case Opcodes::SkipEqualReg:    return skipIf("V[" + x + "] == V[" + y + "]");
+	case Opcodes::SkipNotEqualReg: return skipIf("V[" + x + "] != V[" + y + "]");
+	case Opcodes::SkipKey:         return skipIf("(*m->keypad >> (V[" + x + "] & 0xF)) & 1");
+	case Opcodes::SkipNotKey:      return skipIf("((*m->keypad >> (V[" + x + "] & 0xF)) & 1) == 0");
+
+	case Opcodes::LoadImm: return "\t\tV[" + x + "] = " + nn + ";\n" + tick;
+	case Opcodes::AddImm:  return "\t\tV[" + x + "] += " + nn + ";\n" + tick;
+	case Opcodes::Move:    return "\t\tV[" + x + "] = V[" + y + "];\n" + tick;
+	case Opcodes::Or:      return "\t\tV[" + x + "] |= V[" + y + "];\n" + tick;
+	case Opcodes::And:     return "\t\tV[" + x + "] &= V[" + y + "];\n" + tick;
+	case Opcodes::Xor:     return "\t\tV[" + x + "] ^= V[" + y + "];\n" + tick;
+
+	case Opcodes::Add:
+		return "\t\tV[15] = (V[" + x + "] > 255 - V[" + y + "]) ? 1 : 0;\n\t\tV[" + x + "] += V[" + y + "];\n" + tick;
+
+	case Opcodes::Sub:
+		return "\t\tV[15] = (V[" + x + "] > V[" + y + "]) ? 1 : 0;\n\t\tV[" + x + "] -= V[" + y + "];\n" + tick;
+
+	case Opcodes::SubReverse:
+		return "\t\tV[15] = (V[" + y + "] > V[" + x + "]) ? 1 : 0;\n\t\tV[" + x + "] = V[" + y + "] - V[" + x + "];\n" + tick;
+
+	case Opcodes::ShiftRight:
+		return "\t\t{\n\t\t\tunsigned char source = " + shiftSource + ";\n\t\t\tV[" + x + "] = source >> 1;\n\t\t\tV[15] = source & 0x01;\n\t\t}\n" + tick;
+
+	case Opcodes::ShiftLeft:
+		return "\t\t{\n\t\t\tunsigned char source = " + shiftSource + ";\n\t\t\tV[" + x + "] = source << 1;\n\t\t\tV[15] = source >> 7;\n\t\t}\n" + tick;
+
+	case Opcodes::LoadI:
+		return "\t\tr.I = " + nnn + ";\n" + tick;
+
+	case Opcodes::JumpV0:
+		return leaveTo("V[0] + " + nnn);
+
+	case Opcodes::Random:
+		return "\t\tV[" + x + "] = m->randomByte(m->context) & " + nn + ";\n" + tick;
+
+	case Opcodes::Draw:
+		return "\t\tdraw(m, r.I, V[" + x + "], V[" + y + "], " + n + ");\n\t\t*m->drawFlag = true;\n" + tick;
+
+	case Opcodes::GetDelay:
+		return "\t\tV[" + x + "] = r.delayTimer;\n" + tick;
+
+	case Opcodes::WaitKey:
+		//No key: the cycle still counts, but pc stays put and the timers don't tick
+		return "\t\tif (*m->keypad == 0)\n\t\t\treturn leave(m, r, " + toHex(address, 3) + ", " + count + ");\n\n"
+			"\t\t{\n\t\t\tunsigned char key = 15;\n\t\t\twhile (((*m->keypad >> key) & 1) == 0)\n\t\t\t\tkey--;\n\n"
+			"\t\t\tV[" + x + "] = key;\n\t\t}\n" + tick;
+
+	case Opcodes::SetDelay:
+		return "\t\tr.delayTimer = V[" + x + "];\n" + tick;
+
+	case Opcodes::SetSound:
+		return "\t\tr.soundTimer = V[" + x + "];\n" + tick;
+
+	case Opcodes::AddI:
+		code = "\t\tr.I += V[" + x + "];\n";
+		if (quirks.addIndexSetsOverflow)
+			code += "\t\tV[15] = (r.I > 0x0FFF) ? 1 : 0;\n";
+		return code + tick;
+
+	case Opcodes::FontCharacter:
+		return "\t\tr.I = V[" + x + "] * 5;\n" + tick;
+
+	case Opcodes::StoreBCD:
+	case Opcodes::StoreRegisters:
+	{
+		std::string length;
+
+		if (Opcodes::classify(opcode) == Opcodes::StoreBCD)
+		{
+			length = "3";
+			code = "\t\t{\n\t\t\tunsigned short start = r.I;\n"
+				"\t\t\tstore(m, start, V[" + x + "] / 100);\n"
+				"\t\t\tstore(m, start + 1, (V[" + x + "] / 10) % 10);\n"
+				"\t\t\tstore(m, start + 2, V[" + x + "] % 10);\n";
+		}
+		else
+		{
+			length = std::to_string(((opcode & 0x0F00) >> 8) + 1);
+			code = "\t\t{\n\t\t\tunsigned short start = r.I;\n"
+				"\t\t\tfor (int i = 0; i <= " + x + "; i++)\n\t\t\t\tstore(m, start + i, V[i]);\n";
+
+			if (quirks.loadStoreIncrementsI)
+				code += "\t\t\tr.I += " + length + ";\n";
+		}
+
+		//Stop if the store rewrote the rest of this block, dispatch then rechecks the bytes
+		code += "\t" + tick;
+		if (address + 2 < blockEnd)
+		{
+			code += "\t\t\tif (start < " + toHex(blockEnd, 3) + " && start + " + length + " > " + next + ")\n"
+				"\t\t\t\treturn leave(m, r, " + next + ", " + count + ");\n";
+		}
+
+		return code + "\t\t}\n";
+	}
+
+	case Opcodes::LoadRegisters:
+		code = "\t\tfor (int i = 0; i <= " + x + "; i++)\n\t\t\tV[i] = load(m, r.I + i);\n";
+		if (quirks.loadStoreIncrementsI)
+			code += "\t\tr.I += " + std::to_string(((opcode & 0x0F00) >> 8) + 1) + ";\n";
+		return code + tick;
+
+	default:
+		//RomAnalyser never puts anything the interpreter doesn't run in a block
+		return leaveTo(toHex(address, 3));
+	}
+}
+
+bool AotCompiler::build(const std::string& romPath, const std::string& modulePath, const Quirks& quirks)
+{
+	std::shared_ptr<const RomImage> image = RomCache::load(romPath);
+	if (image == nullptr)
+		return false;
+
+	std::shared_ptr<const RomAnalyser::Analysis> analysis = RomAnalyser::analyse(image);
+	if (analysis == nullptr)
+	{
+		LOG_E("ROM too big to recompile: " + romPath);
+		return false;
+	}
+
+	if (analysis->mayModifyCode())
+		LOG_W("ROM may modify its own code, blocks it rewrites will run in the interpreter");
+
+	std::string sourcePath = modulePath + ".cpp";
+	{
+		std::ofstream source(sourcePath);
+		if (!source.is_open())
+		{
+			LOG_E("Could not write AOT source: " + sourcePath);
+			return false;
+		}
+
+		source << generateSource(*analysis, *image, quirks);
+	}
+
+	const char* compiler = getenv("CHIP8_AOT_CXX");
+
+#ifdef _WIN32
+	std::string command = std::string(compiler != nullptr ? compiler : "cl")
+		+ " /nologo /O2 /EHsc /LD \"" + sourcePath + "\" /Fe\"" + modulePath + "\"";
+#else
+	std::string command = std::string(compiler != nullptr ? compiler : "c++")
+		+ " -std=c++11 -O2 -shared -fPIC -o \"" + modulePath + "\" \"" + sourcePath + "\"";
+#endif
+
+	LOG_I("Building AOT module: " + command);
+
+	if (system(command.c_str()) != 0)
+	{
+		LOG_E("AOT module build failed, the generated source is in: " + sourcePath);
+		return false;
+	}
+
+	LOG_I("AOT module built with " + std::to_string(analysis->blocks.size()) + " blocks: " + modulePath);
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+
+#include "../Quirks.h"
+#include "../debug/RomAnalyser.h"
+
+struct RomImage;
+
+/**
+@brief Recompiles a ROM ahead of time into C++, and builds that into a module AotModule can load.
+
+Every basic block RomAnalyser recovers becomes one C++ function with its opcodes already
+decoded and its quirks fixed, so running it costs no fetch or decode. A generated dispatch
+loop switches on pc to pick the next block, which also covers the jumps that can't be
+resolved statically (BNNN, 00EE). Blocks compare their original bytes against memory before
+running and hand back to the interpreter if the ROM has rewritten them.
+
+Timers tick after every instruction and cycles are counted exactly as the interpreter does,
+so a module gives identical results to the interpreter for the same ROM and quirks.
+*/
+class AotCompiler
+{
+public:
+	/**
+	@brief Generate the C++ source for a ROM.
+
+	@param analysis The ROM's recovered control flow.
+	@param image    The ROM.
+	@param quirks   The quirks to compile in, the module only runs with the same ones.
+
+	@return The source of a complete translation unit.
+	*/
+	static std::string generateSource(const RomAnalyser::Analysis& analysis, const RomImage& image, const Quirks& quirks);
+
+	/**
+	@brief Recompile a ROM file and build it into a module with the system C++ compiler.
+
+	The source is kept next to the module, as modulePath + ".cpp". The compiler is "c++"
+	("cl" on Windows) unless the CHIP8_AOT_CXX environment variable names another.
+
+	@param romPath    The ROM to recompile.
+	@param modulePath The shared library to build.
+	@param quirks     The quirks to compile in.
+
+	@return bool - Was successful.
+	*/
+	static bool build(const std::string& romPath, const std::string& modulePath, const Quirks& quirks);
+
+private:
+	/** @brief The C++ for a single instruction, with its operands and quirks baked in. */
+	static std::string generateInstruction(unsigned short address, unsigned short opcode, unsigned short blockEnd,
+		const Quirks& quirks, unsigned int executed, bool& endsBlock);
+};
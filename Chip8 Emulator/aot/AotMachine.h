@@ -0,0 +1,50 @@
+#pragma once
+
+/*
+The interface between the emulator and the native modules the AOT recompiler builds.
+
+Modules are compiled separately from the emulator, so everything they touch goes through this
+plain struct of pointers into a Chip8 instance. It is defined through a macro so AotCompiler can
+paste the exact same definition into the source it generates. Bump AOT_ABI_VERSION whenever it
+changes, or the generated code's behaviour changes, so stale modules are refused rather than run
+against the wrong layout or with different results from the interpreter.
+
+Memory and the framebuffer are reached through the same 256 byte pages the interpreter uses, and
+writes go through writablePage and writableScreenPage so they copy a shared page first, exactly as
+they do in the interpreter.
+*/
+#define AOT_MACHINE_DEFINITION \
+struct AotMachine \
+{ \
+	const unsigned char* const* pages; \
+	unsigned char* V; \
+	unsigned short* stack; \
+	unsigned short* keypad; \
+	const unsigned char* const* screenPages; \
+	unsigned short* pc; \
+	unsigned short* I; \
+	unsigned short* sp; \
+	unsigned char* delayTimer; \
+	unsigned char* soundTimer; \
+	bool* drawFlag; \
+	unsigned long long* cycles; \
+	unsigned char* (*writablePage)(void* context, unsigned short address); \
+	unsigned char* (*writableScreenPage)(void* context, unsigned short offset); \
+	void (*clearScreen)(void* context); \
+	unsigned char (*randomByte)(void* context); \
+	void* context; \
+};
+
+AOT_MACHINE_DEFINITION
+
+#define AOT_STRINGIFY_INNER(...) #__VA_ARGS__
+#define AOT_STRINGIFY(...) AOT_STRINGIFY_INNER(__VA_ARGS__)
+
+///Source text of the AotMachine definition, for AotCompiler's output
+#define AOT_MACHINE_SOURCE AOT_STRINGIFY(AOT_MACHINE_DEFINITION)
+
+//5: the stack is indexed with *sp & 0xF, so an overflow wraps like the interpreter
+const int AOT_ABI_VERSION = 5;
+
+///Runs compiled blocks from *pc until the budget runs out or it reaches code it has no block for, returns cycles executed
+typedef unsigned long long (*AotRunFunction)(AotMachine* machine, unsigned long long budget);
@@ -0,0 +1,104 @@
+#include "AotModule.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "../misc/Log.h"
+
+AotModule::AotModule()
+	: library(nullptr), runFunction(nullptr), romHash(0), quirkFlags(0)
+{
+}
+
+AotModule::~AotModule()
+{
+	unload();
+}
+
+bool AotModule::load(const std::string& path)
+{
+	unload();
+
+#ifdef _WIN32
+	library = (void*)LoadLibraryA(path.c_str());
+#else
+	library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+
+	if (library == nullptr)
+	{
+		LOG_E("Could not load AOT module: " + path);
+		return false;
+	}
+
+	typedef int (*VersionFunction)();
+	typedef unsigned long long (*HashFunction)();
+	typedef int (*QuirksFunction)();
+
+	VersionFunction version = (VersionFunction)findSymbol("chip8AotAbiVersion");
+	HashFunction hash = (HashFunction)findSymbol("chip8AotRomHash");
+	QuirksFunction quirks = (QuirksFunction)findSymbol("chip8AotQuirks");
+	AotRunFunction run = (AotRunFunction)findSymbol("chip8AotRun");
+
+	if (version == nullptr || hash == nullptr || quirks == nullptr || run == nullptr)
+	{
+		LOG_E("Not an AOT module: " + path);
+		unload();
+		return false;
+	}
+
+	if (version() != AOT_ABI_VERSION)
+	{
+		LOG_E("AOT module was built for a different emulator version, rebuild it: " + path);
+		unload();
+		return false;
+	}
+
+	romHash = hash();
+	quirkFlags = quirks();
+	runFunction = run;
+
+	LOG_I("Loaded AOT module: " + path);
+	return true;
+}
+
+void AotModule::unload()
+{
+	if (library != nullptr)
+	{
+#ifdef _WIN32
+		FreeLibrary((HMODULE)library);
+#else
+		dlclose(library);
+#endif
+	}
+
+	library = nullptr;
+	runFunction = nullptr;
+	romHash = 0;
+	quirkFlags = 0;
+}
+
+bool AotModule::isCompatible(uint64_t hash, const Quirks& quirks) const
+{
+	return isLoaded() && hash == romHash && getQuirkFlags(quirks) == quirkFlags;
+}
+
+int AotModule::getQuirkFlags(const Quirks& quirks)
+{
+	return (quirks.shiftVxInPlace ? 1 : 0) | (quirks.loadStoreIncrementsI ? 2 : 0)
+		| (quirks.wrapSprites ? 4 : 0) | (quirks.addIndexSetsOverflow ? 8 : 0);
+}
+
+void* AotModule::findSymbol(const char* name)
+{
+#ifdef _WIN32
+	return (void*)GetProcAddress((HMODULE)library, name);
+#else
+	return dlsym(library, name);
+#endif
+}
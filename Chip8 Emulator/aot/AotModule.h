@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "AotMachine.h"
+#include "../Quirks.h"
+
+/**
+@brief A ROM recompiled to native code by AotCompiler, loaded from a shared library.
+
+Every module records the ROM hash and quirks it was compiled for, Chip8 only runs it when both
+match the loaded ROM. Blocks check their instruction bytes before running, so a ROM that
+rewrites its own code drops back to the interpreter for anything it changed.
+*/
+class AotModule
+{
+public:
+	AotModule();
+
+	~AotModule();
+
+	AotModule(const AotModule&) = delete;
+	AotModule& operator=(const AotModule&) = delete;
+
+	/**
+	@brief Load a module, unloading any already loaded.
+
+	@param path The shared library built by AotCompiler.
+
+	@return bool - Was successful.
+	*/
+	bool load(const std::string& path);
+
+	void unload();
+
+	bool isLoaded() const { return runFunction != nullptr; }
+
+	/** @brief Was the module compiled for this ROM and these quirks. */
+	bool isCompatible(uint64_t hash, const Quirks& quirks) const;
+
+	/** @brief Run compiled code, see AotRunFunction. */
+	unsigned long long run(AotMachine* machine, unsigned long long budget) const { return runFunction(machine, budget); }
+
+	/** @brief The quirks packed into the bit flags modules record. */
+	static int getQuirkFlags(const Quirks& quirks);
+
+private:
+	void* library;
+
+	AotRunFunction runFunction;
+
+	uint64_t romHash;
+
+	int quirkFlags;
+
+	/** @brief Look up an exported function, nullptr if it is missing. */
+	void* findSymbol(const char* name);
+};
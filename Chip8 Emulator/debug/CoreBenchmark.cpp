@@ -0,0 +1,114 @@
+#include "CoreBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+#include "../Chip8.h"
+#include "../misc/Log.h"
+
+namespace
+{
+	//Draws a 15 row sprite, then steps it 3 right and 5 down so it crosses every edge and corner
+	const unsigned char EDGE_SPRITES[] = {
+		0x60, 0x00, //V0 = 0
+		0x61, 0x00, //V1 = 0
+		0xA2, 0x10, //I = sprite
+		0xD0, 0x1F, //Draw at V0, V1
+		0x70, 0x03, //V0 += 3
+		0x71, 0x05, //V1 += 5
+		0x12, 0x06, //Jump to the draw
+		0x00, 0x00,
+		0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF, 0x3C, 0x7E, 0xDB, 0xFF, 0x66, 0x3C, 0x18
+	};
+
+	//Calls a subroutine that stores and loads 8 registers at a moving I
+	const unsigned char REGISTER_SPILLS[] = {
+		0x22, 0x04, //Call the subroutine
+		0x12, 0x00, //Loop
+		0xA3, 0x00, //I = 0x300
+		0xF0, 0x1E, //I += V0
+		0xF7, 0x55, //Store V0 - V7
+		0xF7, 0x65, //Load V0 - V7
+		0x70, 0x01, //V0 += 1
+		0x00, 0xEE  //Return
+	};
+}
+
+const unsigned long long CoreBenchmark::CYCLES;
+const int CoreBenchmark::RUNS;
+
+CoreBenchmark::CoreBenchmark()
+{
+
+}
+
+bool CoreBenchmark::run(const std::string& romPath)
+{
+	//Heap allocated as a machine is too big for the stack
+	std::unique_ptr<Chip8> machine(new Chip8());
+
+	LOG_I("Core benchmark, nanoseconds per cycle (best of " + std::to_string(RUNS) + ")");
+
+	for (int wrap = 0; wrap < 2; wrap++)
+	{
+		Quirks quirks;
+		quirks.wrapSprites = (wrap == 1);
+
+		machine->setQuirks(quirks);
+
+		if (!machine->loadROM(EDGE_SPRITES, sizeof(EDGE_SPRITES)))
+		{
+			return false;
+		}
+
+		logTiming(wrap == 1 ? "Edge sprites, wrapped" : "Edge sprites, clipped", time(*machine));
+	}
+
+	machine->setQuirks(Quirks());
+
+	if (!machine->loadROM(REGISTER_SPILLS, sizeof(REGISTER_SPILLS)))
+	{
+		return false;
+	}
+
+	logTiming("Register spills", time(*machine));
+
+	if (!romPath.empty())
+	{
+		if (!machine->loadROM(romPath))
+		{
+			return false;
+		}
+
+		logTiming(romPath, time(*machine));
+	}
+
+	return true;
+}
+
+double CoreBenchmark::time(Chip8& machine)
+{
+	double best = 0.0;
+
+	for (int run = 0; run < RUNS; run++)
+	{
+		machine.reset();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		machine.runCycles(CYCLES);
+		double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / CYCLES;
+
+		best = (run == 0 ? nanoseconds : std::min(best, nanoseconds));
+	}
+
+	return best;
+}
+
+void CoreBenchmark::logTiming(const std::string& workload, double nanoseconds)
+{
+	char line[192];
+	snprintf(line, sizeof(line), " - %-24s %8.2f ns", workload.c_str(), nanoseconds);
+	LOG_I(line);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+class Chip8;
+
+/**
+@brief Times the plain interpreter, with no instrumentation or AOT module, in nanoseconds per cycle.
+
+The built in workloads hit the masked address paths hardest: sprites drawn across every edge of the
+screen with each wrap quirk, and a subroutine that stores and loads registers through I. An optional
+ROM is timed afterwards for a real world figure. Each workload keeps the best of several runs so
+one-off stalls don't hide a regression.
+*/
+class CoreBenchmark
+{
+public:
+	/**
+	@brief Time the built in workloads, and a ROM if one is given.
+
+	@param romPath Optional ROM to time after the built in workloads.
+
+	@return bool - Was successful.
+	*/
+	static bool run(const std::string& romPath = "");
+
+private:
+	CoreBenchmark();
+
+	///Cycles per run, enough to keep timer resolution out of the result
+	static const unsigned long long CYCLES = 5000000;
+
+	///Runs per workload, only the fastest is reported
+	static const int RUNS = 5;
+
+	///Best nanoseconds per cycle from a freshly reset machine
+	static double time(Chip8& machine);
+
+	static void logTiming(const std::string& workload, double nanoseconds);
+};
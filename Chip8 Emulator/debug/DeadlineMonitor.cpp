@@ -0,0 +1,160 @@
+#include "DeadlineMonitor.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "../misc/Log.h"
+#include "../misc/ThreadTuning.h"
+
+DeadlineMonitor::DeadlineMonitor(Clock::duration tolerance)
+	: tolerance(tolerance)
+{
+	reset();
+}
+
+void DeadlineMonitor::reset()
+{
+	lateness.reset();
+	frames = 0;
+	missed = 0;
+	longestStreak = 0;
+	currentStreak = 0;
+	missesByCore.clear();
+	lastSwitches = ThreadTuning::getInvoluntarySwitches();
+	switches = 0;
+	missedFrameSwitches = 0;
+	migrations = 0;
+	lastCore = -1;
+}
+
+void DeadlineMonitor::recordFrame(Clock::time_point deadline, Clock::time_point started)
+{
+	Clock::duration late = started > deadline ? started - deadline : Clock::duration::zero();
+	lateness.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(late).count());
+	frames++;
+
+	int core = ThreadTuning::getCurrentCore();
+
+	if (frames > 1 && core != lastCore)
+	{
+		migrations++;
+	}
+
+	lastCore = core;
+
+	//Preemptions since the last frame started are the ones that could have delayed this one
+	long currentSwitches = ThreadTuning::getInvoluntarySwitches();
+	unsigned long long frameSwitches = 0;
+
+	if (currentSwitches >= 0 && lastSwitches >= 0)
+	{
+		frameSwitches = (unsigned long long)(currentSwitches - lastSwitches);
+		switches += frameSwitches;
+	}
+
+	lastSwitches = currentSwitches;
+
+	if (late <= tolerance)
+	{
+		currentStreak = 0;
+		return;
+	}
+
+	missed++;
+	missesByCore[core]++;
+	missedFrameSwitches += frameSwitches;
+
+	//A stalled system misses many frames in a row, the rest are counted in the report
+	LOG_W_LIMITED(describeMiss(late, core, frameSwitches));
+
+	currentStreak++;
+	if (currentStreak > longestStreak)
+	{
+		longestStreak = currentStreak;
+	}
+}
+
+std::string DeadlineMonitor::describeMiss(Clock::duration late, int core, unsigned long long frameSwitches)
+{
+	char line[160];
+	double lateMS = std::chrono::duration<double, std::milli>(late).count();
+
+	if (lastSwitches >= 0)
+	{
+		snprintf(line, sizeof(line), "Missed frame deadline by %.2f ms on core %s, %llu preemptions since the last frame",
+			lateMS, core < 0 ? "?" : std::to_string(core).c_str(), frameSwitches);
+	}
+	else
+	{
+		snprintf(line, sizeof(line), "Missed frame deadline by %.2f ms on core %s",
+			lateMS, core < 0 ? "?" : std::to_string(core).c_str());
+	}
+
+	return line;
+}
+
+std::string DeadlineMonitor::generateReport()
+{
+	char line[160];
+	std::string report = "Frame deadlines\n\n";
+
+	report += "Thread: " + ThreadTuning::describe() + "\n";
+
+	snprintf(line, sizeof(line), "Frames: %llu, missed: %llu (%.3f%%), longest run of misses: %llu\n",
+		frames, missed, frames > 0 ? 100.0 * missed / frames : 0.0, longestStreak);
+	report += line;
+
+	snprintf(line, sizeof(line), "Core migrations between frames: %llu\n", migrations);
+	report += line;
+
+	if (lastSwitches >= 0)
+	{
+		snprintf(line, sizeof(line), "Preemptions: %llu in all frames, %llu in missed frames\n", switches, missedFrameSwitches);
+		report += line;
+	}
+
+	report += "\nStart lateness (microseconds)\n";
+
+	if (lateness.getCount() > 0)
+	{
+		const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+		for (double percentile : percentiles)
+		{
+			snprintf(line, sizeof(line), "  p%-5g%10.1f\n", percentile, lateness.getPercentile(percentile) / 1000.0);
+			report += line;
+		}
+
+		snprintf(line, sizeof(line), "  max   %10.1f\n", lateness.getMax() / 1000.0);
+		report += line;
+	}
+
+	if (!missesByCore.empty())
+	{
+		report += "\nMisses by core\n";
+
+		for (auto& core : missesByCore)
+		{
+			snprintf(line, sizeof(line), "  %-6s%10llu\n", core.first < 0 ? "?" : std::to_string(core.first).c_str(), core.second);
+			report += line;
+		}
+	}
+
+	return report;
+}
+
+bool DeadlineMonitor::writeReport(const std::string& path)
+{
+	std::ofstream file(path);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not open deadline report: " + path);
+		return false;
+	}
+
+	file << generateReport();
+
+	LOG_I("Deadline report written to: " + path);
+	return true;
+}
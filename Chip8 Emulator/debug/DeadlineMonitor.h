@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "../misc/Histogram.h"
+
+/**
+@brief Counts frames that started late, along with where the thread was running at the time.
+
+Every frame has a deadline it should start by. A frame that starts more than the tolerance
+past it is missed. Each miss is logged, rate limited, and counted with the core the thread
+woke on and how often it was preempted during the frame, so stalls can be matched against
+affinity and priority settings. Lateness within the tolerance is normal wake up jitter and is only histogrammed.
+*/
+class DeadlineMonitor
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/** @param tolerance How late a frame can start before it counts as missed. */
+	explicit DeadlineMonitor(Clock::duration tolerance);
+
+	/** @brief Clear all recorded frames. */
+	void reset();
+
+	/**
+	@brief Record the start of a frame, call it on the emulation thread as the frame starts.
+
+	@param deadline When the frame was due to start.
+	@param started  When it actually started.
+	*/
+	void recordFrame(Clock::time_point deadline, Clock::time_point started);
+
+	/** @brief A human readable summary of the frames recorded. */
+	std::string generateReport();
+
+	/**
+	@brief Write the report to disk.
+
+	@param path The report file.
+
+	@return bool - Was successful.
+	*/
+	bool writeReport(const std::string& path);
+
+private:
+	Clock::duration tolerance;
+
+	///How late every frame started, in nanoseconds
+	Histogram lateness;
+
+	unsigned long long frames;
+	unsigned long long missed;
+
+	///Longest run of consecutive missed frames
+	unsigned long long longestStreak;
+	unsigned long long currentStreak;
+
+	///Missed frames by the core the thread woke on, -1 when the core is unknown
+	std::map<int, unsigned long long> missesByCore;
+
+	///Preemptions counted over all frames and over missed frames, -1 in lastSwitches if not counted
+	long lastSwitches;
+	unsigned long long switches;
+	unsigned long long missedFrameSwitches;
+
+	///Frames that woke on a different core to the one before
+	unsigned long long migrations;
+	int lastCore;
+
+	/** @brief The log line for a missed frame. */
+	std::string describeMiss(Clock::duration late, int core, unsigned long long frameSwitches);
+};
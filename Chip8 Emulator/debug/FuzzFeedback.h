@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+@brief What an instrumented run reports back to the fuzzer: edge coverage and bounds faults.
+
+Attach with Chip8::setFuzzFeedback(). Every executed instruction bumps a saturating counter for its
+(pc, next pc) edge, hashed into a fixed map the way AFL does so clearing and comparing it costs
+the same however large the ROM. Accesses that would have left memory or the stack are wrapped by
+the interpreter either way, and recorded here as faults.
+*/
+struct FuzzFeedback
+{
+	static const size_t MAP_SIZE = 1 << 16;
+
+	enum Fault
+	{
+		NoFault = 0,
+		StackOverflowFault = 1,  //2NNN with all 16 stack entries in use
+		StackUnderflowFault = 2, //00EE with nothing on the stack
+		MemoryRangeFault = 4,    //DXYN, FX33, FX55 or FX65 reaching past the end of memory from I
+		PcRangeFault = 8         //An instruction fetched from past the end of memory
+	};
+
+	///Hit counts per edge, saturating at 255
+	uint8_t edges[MAP_SIZE];
+
+	///Fault bits seen since the last clear()
+	uint32_t faults;
+
+	///Address of the instruction that raised the first fault
+	unsigned short faultPc;
+
+	FuzzFeedback() { clear(); }
+
+	/** @brief Reset ready for the next execution. */
+	void clear()
+	{
+		memset(edges, 0, sizeof(edges));
+		faults = NoFault;
+		faultPc = 0;
+	}
+
+	inline void recordEdge(unsigned short from, unsigned short to)
+	{
+		uint8_t& count = edges[((from * 0x9E37u) ^ to) & (MAP_SIZE - 1)];
+		count += (count != 255);
+	}
+
+	inline void recordFault(Fault fault, unsigned short pc)
+	{
+		if (faults == NoFault)
+			faultPc = pc;
+
+		faults |= fault;
+	}
+};
@@ -0,0 +1,286 @@
+#include "Fuzzer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "../misc/Log.h"
+#include "../rom/MemoryImage.h"
+#include "../rom/RomCache.h"
+
+Fuzzer::Fuzzer(const Options& options)
+	: options(options), feedback(new FuzzFeedback()), virgin(FuzzFeedback::MAP_SIZE, 0xFF),
+	randomState(options.seed != 0 ? options.seed : 1), executions(0), edgesFound(0), elapsedSeconds(0.0)
+{
+	machine.setFuzzFeedback(feedback.get());
+}
+
+bool Fuzzer::loadSeed(const std::string& romPath)
+{
+	std::shared_ptr<const RomImage> image = RomCache::load(romPath);
+
+	if (image == nullptr || !machine.loadROM(image))
+	{
+		LOG_E("Could not load fuzzing seed ROM: " + romPath);
+		return false;
+	}
+
+	snapshot = machine.fork();
+
+	Input seedInput;
+	seedInput.rom = image->data;
+	seedInput.keys.assign(options.frames, 0);
+
+	corpus.clear();
+	corpus.push_back(seedInput);
+
+	execute(seedInput);
+	updateCoverage();
+
+	return true;
+}
+
+void Fuzzer::run()
+{
+	if (snapshot == nullptr)
+	{
+		LOG_E("No fuzzing seed loaded");
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned long long i = 0; i < options.executions; i++)
+	{
+		Input input = mutate(corpus[nextRandom((uint32_t)corpus.size())]);
+
+		execute(input);
+
+		if (feedback->faults != FuzzFeedback::NoFault)
+			saveCrash(input);
+
+		if (updateCoverage())
+			corpus.push_back(std::move(input));
+	}
+
+	elapsedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string Fuzzer::generateReport() const
+{
+	char line[192];
+	std::string report;
+
+	snprintf(line, sizeof(line), "Fuzzed %llu executions in %.2f s, %.0f executions per second\n", executions, elapsedSeconds,
+		elapsedSeconds > 0.0 ? executions / elapsedSeconds : 0.0);
+	report += line;
+
+	snprintf(line, sizeof(line), "Edges: %llu, corpus: %zu inputs, unique crashes: %zu\n", edgesFound, corpus.size(), crashes.size());
+	report += line;
+
+	for (const Crash& crash : crashes)
+	{
+		snprintf(line, sizeof(line), " - %s at 0x%03X\n", describeFaults(crash.faults).c_str(), crash.faultPc);
+		report += line;
+	}
+
+	return report;
+}
+
+void Fuzzer::execute(const Input& input)
+{
+	machine.shareState(*snapshot);
+	machine.writeMemory(MemoryImage::LOAD_ADDRESS, input.rom.data(), input.rom.size());
+
+	feedback->clear();
+
+	for (uint16_t keypad : input.keys)
+	{
+		machine.setKeypad(keypad);
+		machine.runCycles(options.cyclesPerFrame);
+	}
+
+	executions++;
+}
+
+bool Fuzzer::updateCoverage()
+{
+	bool newCoverage = false;
+
+	for (size_t i = 0; i < FuzzFeedback::MAP_SIZE; i += sizeof(uint64_t))
+	{
+		//Most of the map is untouched, skip it a word at a time
+		uint64_t word;
+		memcpy(&word, feedback->edges + i, sizeof(word));
+
+		if (word == 0)
+			continue;
+
+		for (size_t edge = i; edge < i + sizeof(uint64_t); edge++)
+		{
+			uint8_t bucket = getBucket(feedback->edges[edge]);
+
+			if ((virgin[edge] & bucket) == 0)
+				continue;
+
+			if (virgin[edge] == 0xFF)
+				edgesFound++;
+
+			virgin[edge] &= ~bucket;
+			newCoverage = true;
+		}
+	}
+
+	return newCoverage;
+}
+
+Fuzzer::Input Fuzzer::mutate(const Input& parent)
+{
+	Input child = parent;
+	const int mutations = 1 + (int)nextRandom(4);
+
+	for (int i = 0; i < mutations; i++)
+	{
+		//Keypad mutations only once there is no ROM to mutate
+		uint32_t strategy = (child.rom.empty() ? 4 + nextRandom(2) : nextRandom(6));
+
+		if (child.keys.empty() && strategy >= 4)
+			continue;
+
+		switch (strategy)
+		{
+		case 0: //Flip a bit
+			child.rom[nextRandom((uint32_t)child.rom.size())] ^= (unsigned char)(1 << nextRandom(8));
+			break;
+
+		case 1: //Random byte
+			child.rom[nextRandom((uint32_t)child.rom.size())] = (unsigned char)nextRandom(256);
+			break;
+
+		case 2: //Random instruction, on an instruction boundary
+		{
+			uint32_t offset = nextRandom((uint32_t)child.rom.size()) & ~1u;
+			uint32_t opcode = nextRandom(0x10000);
+
+			child.rom[offset] = (unsigned char)(opcode >> 8);
+			if (offset + 1 < child.rom.size())
+				child.rom[offset + 1] = (unsigned char)opcode;
+		}
+			break;
+
+		case 3: //Copy an instruction from elsewhere in the ROM
+		{
+			uint32_t from = nextRandom((uint32_t)child.rom.size()) & ~1u;
+			uint32_t to = nextRandom((uint32_t)child.rom.size()) & ~1u;
+
+			for (uint32_t byte = 0; byte < 2 && from + byte < child.rom.size() && to + byte < child.rom.size(); byte++)
+				child.rom[to + byte] = parent.rom[from + byte];
+		}
+			break;
+
+		case 4: //Press or release a key for a frame
+			child.keys[nextRandom((uint32_t)child.keys.size())] ^= (uint16_t)(1 << nextRandom(16));
+			break;
+
+		case 5: //Hold a random set of keys for a frame
+			child.keys[nextRandom((uint32_t)child.keys.size())] = (uint16_t)nextRandom(0x10000);
+			break;
+		}
+	}
+
+	return child;
+}
+
+void Fuzzer::saveCrash(const Input& input)
+{
+	if (!crashKeys.insert(std::make_pair(feedback->faults, feedback->faultPc)).second)
+		return;
+
+	Crash crash;
+	crash.faults = feedback->faults;
+	crash.faultPc = feedback->faultPc;
+	crashes.push_back(crash);
+
+	if (options.outputDirectory.empty())
+		return;
+
+	const std::string basePath = options.outputDirectory + "/crash-" + std::to_string(crashes.size());
+
+	std::ofstream romFile(basePath + ".ch8", std::ios::binary);
+	std::ofstream keysFile(basePath + ".keys");
+
+	if (!romFile.is_open() || !keysFile.is_open())
+	{
+		LOG_E("Could not write fuzzing crash: " + basePath);
+		return;
+	}
+
+	romFile.write((const char*)input.rom.data(), input.rom.size());
+
+	//One frame's keypad per line, in hex
+	char keypadText[8];
+	for (uint16_t keypad : input.keys)
+	{
+		snprintf(keypadText, sizeof(keypadText), "%04X\n", keypad);
+		keysFile << keypadText;
+	}
+}
+
+uint32_t Fuzzer::nextRandom()
+{
+	//xorshift32
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+
+	return randomState;
+}
+
+uint32_t Fuzzer::nextRandom(uint32_t bound)
+{
+	return (uint32_t)(((uint64_t)nextRandom() * bound) >> 32);
+}
+
+uint8_t Fuzzer::getBucket(uint8_t count)
+{
+	if (count <= 2)
+		return count;
+
+	if (count == 3)
+		return 4;
+
+	if (count < 8)
+		return 8;
+
+	if (count < 16)
+		return 16;
+
+	if (count < 32)
+		return 32;
+
+	if (count < 128)
+		return 64;
+
+	return 128;
+}
+
+std::string Fuzzer::describeFaults(uint32_t faults)
+{
+	const char* names[] = { "stack overflow", "stack underflow", "memory out of range", "pc out of range" };
+
+	std::string text;
+
+	for (int bit = 0; bit < 4; bit++)
+	{
+		if ((faults & (1u << bit)) == 0)
+			continue;
+
+		if (!text.empty())
+			text += ", ";
+
+		text += names[bit];
+	}
+
+	return text;
+}
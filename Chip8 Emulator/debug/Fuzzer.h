@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../Chip8.h"
+#include "FuzzFeedback.h"
+
+/**
+@brief In process, coverage guided fuzzer for the Chip8 core.
+
+Inputs are a ROM and a movie of keypad states, one per frame. Each execution resets the machine to a
+snapshot taken after the seed ROM loaded, in constant time through Chip8::shareState(), patches in the
+input's ROM bytes and plays the movie. Inputs that reach new edges, or new hit count buckets of an edge,
+join the corpus the way they do in AFL. Inputs that make the core step out of bounds are saved as crashes,
+once per fault and address.
+
+Also serves as a throughput benchmark of the instrumented interpreter, executions per second are reported.
+*/
+class Fuzzer
+{
+public:
+	struct Options
+	{
+		unsigned long long executions = 100000;
+
+		///Length of every keypad movie
+		unsigned int frames = 16;
+
+		unsigned long long cyclesPerFrame = 100;
+
+		uint32_t seed = 1;
+
+		///Where crashing inputs are written, nothing is written if empty
+		std::string outputDirectory;
+	};
+
+	explicit Fuzzer(const Options& options);
+
+	/**
+	@brief Load the ROM every input is mutated from.
+
+	@param romPath The seed ROM.
+
+	@return bool - Was successful.
+	*/
+	bool loadSeed(const std::string& romPath);
+
+	/** @brief Run the configured number of executions. */
+	void run();
+
+	/** @brief A human readable summary of throughput, coverage and crashes. */
+	std::string generateReport() const;
+
+private:
+	struct Input
+	{
+		std::vector<unsigned char> rom;
+		std::vector<uint16_t> keys;
+	};
+
+	struct Crash
+	{
+		uint32_t faults;
+		unsigned short faultPc;
+	};
+
+	Options options;
+
+	Chip8 machine;
+
+	///The machine as it was right after loading the seed ROM
+	std::unique_ptr<Chip8> snapshot;
+
+	std::unique_ptr<FuzzFeedback> feedback;
+
+	///Bucket bits of each edge not seen yet, as AFL's virgin map
+	std::vector<uint8_t> virgin;
+
+	std::vector<Input> corpus;
+
+	///Faults and addresses already saved
+	std::set<std::pair<uint32_t, unsigned short>> crashKeys;
+
+	std::vector<Crash> crashes;
+
+	uint32_t randomState;
+
+	unsigned long long executions;
+	unsigned long long edgesFound;
+	double elapsedSeconds;
+
+	void execute(const Input& input);
+
+	/** @brief Fold the last execution's edges into the virgin map, returns true if any were new. */
+	bool updateCoverage();
+
+	Input mutate(const Input& parent);
+
+	void saveCrash(const Input& input);
+
+	uint32_t nextRandom();
+
+	/** @brief Random number in [0, bound). */
+	uint32_t nextRandom(uint32_t bound);
+
+	/** @brief AFL's hit count buckets, so a loop running a few more times doesn't count as new coverage. */
+	static uint8_t getBucket(uint8_t count);
+
+	static std::string describeFaults(uint32_t faults);
+};
@@ -0,0 +1,47 @@
+#include "HangDetector.h"
+
+HangDetector::HangDetector()
+{
+	reset();
+}
+
+void HangDetector::reset()
+{
+	tortoise = 0;
+	power = 1;
+	length = 0;
+	steps = 0;
+	hung = false;
+}
+
+bool HangDetector::record(uint64_t stateHash)
+{
+	if (hung)
+		return true;
+
+	steps++;
+
+	if (steps == 1)
+	{
+		tortoise = stateHash;
+		return false;
+	}
+
+	length++;
+
+	if (stateHash == tortoise)
+	{
+		hung = true;
+		return true;
+	}
+
+	//Move the tortoise up to the hare each time the window doubles
+	if (length == power)
+	{
+		tortoise = stateHash;
+		power *= 2;
+		length = 0;
+	}
+
+	return false;
+}
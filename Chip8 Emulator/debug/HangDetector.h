@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+@brief Spots a deterministic run that has entered an exact cycle of states.
+
+Fed the machine's state hash after every step, it uses Brent's algorithm so it needs constant
+memory however long the run is, and reports a cycle within a couple of passes round it. With the
+input held constant a machine that repeats a state will repeat it forever, so the run can stop.
+*/
+class HangDetector
+{
+public:
+	HangDetector();
+
+	/** @brief Forget every state seen so far. */
+	void reset();
+
+	/**
+	@brief Record the state after a step.
+
+	@param stateHash Chip8::getStateHash() for the step.
+
+	@return true once a repeated state has been found.
+	*/
+	bool record(uint64_t stateHash);
+
+	bool isHung() const { return hung; }
+
+	/** @brief Steps in the cycle of states, 0 until one is found. */
+	uint64_t getCycleLength() const { return hung ? length : 0; }
+
+	/** @brief Steps recorded, including the first state. */
+	uint64_t getSteps() const { return steps; }
+
+private:
+	///The state saved at the start of the current power of 2 window
+	uint64_t tortoise;
+
+	///Size of the current window and steps taken into it
+	uint64_t power;
+	uint64_t length;
+
+	uint64_t steps;
+
+	bool hung;
+};
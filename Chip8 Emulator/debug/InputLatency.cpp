@@ -0,0 +1,92 @@
+#include "InputLatency.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "../misc/Log.h"
+
+InputLatency::InputLatency()
+{
+	waiting.reserve(64);
+}
+
+void InputLatency::reset()
+{
+	inputLatency.reset();
+	photonLatency.reset();
+	waiting.clear();
+}
+
+void InputLatency::recordApplied(uint64_t arrival, uint64_t applied)
+{
+	inputLatency.record(applied > arrival ? applied - arrival : 0);
+	waiting.push_back(arrival);
+}
+
+void InputLatency::recordPresented(uint64_t presentTime)
+{
+	for (uint64_t arrival : waiting)
+	{
+		photonLatency.record(presentTime > arrival ? presentTime - arrival : 0);
+	}
+
+	waiting.clear();
+}
+
+std::string InputLatency::generateReport()
+{
+	std::string report = "Input latency (microseconds)\n\n";
+
+	appendDistribution(report, "Input to emulation", inputLatency);
+	appendDistribution(report, "Input to photon", photonLatency);
+
+	if (!waiting.empty())
+	{
+		report += std::to_string(waiting.size()) + " inputs were emulated but never presented\n";
+	}
+
+	return report;
+}
+
+bool InputLatency::writeReport(const std::string& path)
+{
+	std::ofstream file(path);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not open input latency report: " + path);
+		return false;
+	}
+
+	file << generateReport();
+
+	LOG_I("Input latency report written to: " + path);
+	return true;
+}
+
+void InputLatency::appendDistribution(std::string& report, const char* name, const Histogram& histogram)
+{
+	const double percentiles[] = { 10.0, 25.0, 50.0, 75.0, 90.0, 99.0, 99.9 };
+
+	char line[128];
+
+	report += std::string(name) + ": " + std::to_string(histogram.getCount()) + " inputs\n";
+
+	if (histogram.getCount() == 0)
+	{
+		report += "\n";
+		return;
+	}
+
+	snprintf(line, sizeof(line), "  min  %10.1f\n  mean %10.1f\n", histogram.getMin() / 1000.0, histogram.getMean() / 1000.0);
+	report += line;
+
+	for (double percentile : percentiles)
+	{
+		snprintf(line, sizeof(line), "  p%-4g%10.1f\n", percentile, histogram.getPercentile(percentile) / 1000.0);
+		report += line;
+	}
+
+	snprintf(line, sizeof(line), "  max  %10.1f\n\n", histogram.getMax() / 1000.0);
+	report += line;
+}
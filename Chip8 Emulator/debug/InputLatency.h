@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../misc/Histogram.h"
+
+/**
+@brief Measures how long keypad input takes to reach the emulator and then the screen.
+
+Each keypad change is followed from the moment SDL queued it, to the point in a frame where the
+emulator applies it, to the first present after that frame. A frame only presents when the ROM draws,
+so the photon latency includes any frames the ROM spends before reacting on screen.
+*/
+class InputLatency
+{
+public:
+	InputLatency();
+
+	/** @brief Clear all recorded latencies. */
+	void reset();
+
+	/**
+	@brief Record a keypad change being handed to the emulator.
+
+	@param arrival When the event was queued, in nanoseconds.
+	@param applied When the emulator reached the cycle the change lands on, on the same clock.
+	*/
+	void recordApplied(uint64_t arrival, uint64_t applied);
+
+	/**
+	@brief Record a present, which makes every applied change still waiting visible.
+
+	@param presentTime When the present finished, in nanoseconds.
+	*/
+	void recordPresented(uint64_t presentTime);
+
+	/** @brief A human readable summary of both latency distributions. */
+	std::string generateReport();
+
+	/**
+	@brief Write the report to disk.
+
+	@param path The report file.
+
+	@return bool - Was successful.
+	*/
+	bool writeReport(const std::string& path);
+
+private:
+	///Arrival to the emulator applying it, in nanoseconds
+	Histogram inputLatency;
+
+	///Arrival to the first present after it was emulated, in nanoseconds
+	Histogram photonLatency;
+
+	///Arrival times of applied changes that haven't been presented yet
+	std::vector<uint64_t> waiting;
+
+	static void appendDistribution(std::string& report, const char* name, const Histogram& histogram);
+};
@@ -0,0 +1,249 @@
+#include "KernelBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Chip8.h"
+#include "../misc/CpuFeatures.h"
+#include "../misc/Kernels.h"
+#include "../misc/Log.h"
+
+namespace
+{
+	const size_t PIXEL_COUNT = Chip8::WIDTH * Chip8::HEIGHT;
+
+	//Results are folded into this so the optimiser can't drop the calls being timed
+	volatile size_t sink;
+
+	void logTiming(const char* kernel, Kernels::Variant variant, double nanoseconds, double baseline)
+	{
+		char line[128];
+		snprintf(line, sizeof(line), " - %-18s %-8s %10.1f ns  %5.2fx", kernel, Kernels::getVariantName(variant),
+			nanoseconds, baseline / nanoseconds);
+		LOG_I(line);
+	}
+}
+
+KernelBenchmark::KernelBenchmark()
+{
+
+}
+
+bool KernelBenchmark::run()
+{
+	std::string supported;
+
+	for (int feature = 0; feature < CpuFeatures::FeatureCount; feature++)
+	{
+		if (CpuFeatures::has((CpuFeatures::Feature)feature))
+			supported += std::string(" ") + CpuFeatures::getName((CpuFeatures::Feature)feature);
+	}
+
+	LOG_I("Kernel benchmark, CPU features:" + supported);
+
+	bool passed = benchmarkExpand();
+	passed &= benchmarkSpriteRow();
+	passed &= benchmarkDifference();
+
+	if (!passed)
+	{
+		LOG_E("Kernel benchmark found variants that don't match the scalar kernel");
+	}
+
+	return passed;
+}
+
+template<typename Call>
+double KernelBenchmark::time(Call call)
+{
+	//One untimed pass to warm the caches and the branch predictors
+	call();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		call();
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	return (double)elapsed.count() / ITERATIONS;
+}
+
+bool KernelBenchmark::benchmarkExpand()
+{
+	std::mt19937 random(1);
+	std::vector<unsigned char> pixels(PIXEL_COUNT);
+
+	for (unsigned char& pixel : pixels)
+	{
+		pixel = random() & 1;
+	}
+
+	std::vector<unsigned char> expected(PIXEL_COUNT * 4);
+	std::vector<unsigned char> rgba(PIXEL_COUNT * 4);
+
+	Kernels::getExpandFramebuffer(Kernels::ScalarVariant)(pixels.data(), expected.data(), PIXEL_COUNT);
+
+	bool passed = true;
+	double baseline = 0.0;
+
+	for (int variant = 0; variant < Kernels::VariantCount; variant++)
+	{
+		Kernels::ExpandFunction expand = Kernels::getExpandFramebuffer((Kernels::Variant)variant);
+
+		if (expand == nullptr)
+			continue;
+
+		//An odd count also exercises the scalar tail of the wider variants
+		std::fill(rgba.begin(), rgba.end(), 0xAA);
+		expand(pixels.data(), rgba.data(), PIXEL_COUNT - 3);
+
+		if (memcmp(rgba.data(), expected.data(), (PIXEL_COUNT - 3) * 4) != 0 || rgba[(PIXEL_COUNT - 3) * 4] != 0xAA)
+		{
+			LOG_E(std::string("Framebuffer expand ") + Kernels::getVariantName((Kernels::Variant)variant) + " gave the wrong result");
+			passed = false;
+			continue;
+		}
+
+		double nanoseconds = time([&]() {
+			expand(pixels.data(), rgba.data(), PIXEL_COUNT);
+			sink = sink + rgba[PIXEL_COUNT];
+		});
+
+		if (variant == Kernels::ScalarVariant)
+			baseline = nanoseconds;
+
+		logTiming("Framebuffer expand", (Kernels::Variant)variant, nanoseconds, baseline);
+	}
+
+	return passed;
+}
+
+bool KernelBenchmark::benchmarkSpriteRow()
+{
+	bool passed = true;
+	double baseline = 0.0;
+
+	for (int variant = 0; variant < Kernels::VariantCount; variant++)
+	{
+		Kernels::SpriteRowFunction xorRow = Kernels::getXorSpriteRow((Kernels::Variant)variant);
+		Kernels::SpriteRowFunction scalar = Kernels::getXorSpriteRow(Kernels::ScalarVariant);
+
+		if (xorRow == nullptr)
+			continue;
+
+		//Every sprite row against every screen row is small enough to check exhaustively
+		bool matched = true;
+
+		for (int screenBits = 0; screenBits < 256 && matched; screenBits++)
+		{
+			for (int spriteBits = 0; spriteBits < 256; spriteBits++)
+			{
+				unsigned char expected[16] = {};
+				unsigned char pixels[16] = {};
+
+				for (int i = 0; i < 8; i++)
+				{
+					expected[i] = pixels[i] = (screenBits >> i) & 1;
+				}
+
+				bool expectedCollision = scalar(expected, (uint8_t)spriteBits);
+				bool collision = xorRow(pixels, (uint8_t)spriteBits);
+
+				if (collision != expectedCollision || memcmp(pixels, expected, sizeof(pixels)) != 0)
+				{
+					matched = false;
+					break;
+				}
+			}
+		}
+
+		if (!matched)
+		{
+			LOG_E(std::string("Sprite row ") + Kernels::getVariantName((Kernels::Variant)variant) + " gave the wrong result");
+			passed = false;
+			continue;
+		}
+
+		unsigned char screen[Chip8::WIDTH * Chip8::HEIGHT] = {};
+		uint8_t bits = 0;
+
+		//A full screen of rows, the way a busy frame of DXYN would draw
+		double nanoseconds = time([&]() {
+			size_t collisions = 0;
+
+			for (size_t row = 0; row < PIXEL_COUNT; row += 8)
+			{
+				collisions += xorRow(screen + row, bits++);
+			}
+
+			sink = sink + collisions;
+		});
+
+		if (variant == Kernels::ScalarVariant)
+			baseline = nanoseconds;
+
+		logTiming("Sprite rows (256)", (Kernels::Variant)variant, nanoseconds, baseline);
+	}
+
+	return passed;
+}
+
+bool KernelBenchmark::benchmarkDifference()
+{
+	std::mt19937 random(2);
+	std::vector<unsigned char> a(PIXEL_COUNT);
+
+	for (unsigned char& pixel : a)
+	{
+		pixel = random() & 1;
+	}
+
+	std::vector<unsigned char> b = a;
+
+	bool passed = true;
+	double baseline = 0.0;
+
+	for (int variant = 0; variant < Kernels::VariantCount; variant++)
+	{
+		Kernels::DiffFunction difference = Kernels::getFindDifference((Kernels::Variant)variant);
+
+		if (difference == nullptr)
+			continue;
+
+		//Equal buffers, then a difference at every position
+		bool matched = difference(a.data(), b.data(), PIXEL_COUNT) == PIXEL_COUNT;
+
+		for (size_t position = 0; position < PIXEL_COUNT && matched; position++)
+		{
+			b[position] ^= 1;
+			matched = difference(a.data(), b.data(), PIXEL_COUNT) == position;
+			b[position] ^= 1;
+		}
+
+		if (!matched)
+		{
+			LOG_E(std::string("Buffer difference ") + Kernels::getVariantName((Kernels::Variant)variant) + " gave the wrong result");
+			passed = false;
+			continue;
+		}
+
+		//Equal buffers are the worst case, every byte has to be compared
+		double nanoseconds = time([&]() {
+			sink = sink + difference(a.data(), b.data(), PIXEL_COUNT);
+		});
+
+		if (variant == Kernels::ScalarVariant)
+			baseline = nanoseconds;
+
+		logTiming("Buffer difference", (Kernels::Variant)variant, nanoseconds, baseline);
+	}
+
+	return passed;
+}
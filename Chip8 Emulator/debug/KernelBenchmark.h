@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+@brief Times every variant of each kernel the host can run, on the same inputs.
+
+Each variant is first checked against the scalar kernel, so a variant that is fast but wrong
+is reported as a failure rather than a win. Results are written to the log.
+*/
+class KernelBenchmark
+{
+public:
+	/**
+	@brief Check and time all supported variants.
+
+	@return bool - Did every variant match the scalar kernel.
+	*/
+	static bool run();
+
+private:
+	KernelBenchmark();
+
+	///Calls timed per variant, enough to keep timer resolution out of the result
+	static const int ITERATIONS = 200000;
+
+	///Average nanoseconds per call of a function
+	template<typename Call>
+	static double time(Call call);
+
+	static bool benchmarkExpand();
+	static bool benchmarkSpriteRow();
+	static bool benchmarkDifference();
+};
@@ -0,0 +1,291 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "../misc/Log.h"
+
+const unsigned int Profiler::MAX_CALL_DEPTH;
+
+Profiler::Profiler()
+{
+	reset();
+}
+
+void Profiler::reset()
+{
+	std::fill(addressCounts, addressCounts + Chip8::MEMORY_SIZE, 0ULL);
+	std::fill(classCounts, classCounts + Opcodes::ClassCount, 0ULL);
+
+	totalInstructions = 0;
+	skipsTaken = skipsNotTaken = 0;
+
+	backwardJumps.clear();
+	subroutines.clear();
+	callEdges.clear();
+	callStack.clear();
+}
+
+void Profiler::recordInstruction(unsigned short address, unsigned short opcode, unsigned short nextPc)
+{
+	Opcodes::Class opClass = Opcodes::classify(opcode);
+
+	addressCounts[address & (Chip8::MEMORY_SIZE - 1)]++;
+	classCounts[opClass]++;
+	totalInstructions++;
+
+	if (Opcodes::isSkip(opClass))
+	{
+		if (nextPc == address + 4)
+			skipsTaken++;
+		else
+			skipsNotTaken++;
+
+		return;
+	}
+
+	switch (opClass)
+	{
+	case Opcodes::Call:
+	{
+		unsigned short caller = callStack.empty() ? 0x200 : callStack.back().subroutine;
+		callEdges[(unsigned int)caller << 16 | nextPc]++;
+
+		Subroutine& subroutine = subroutines[nextPc];
+		subroutine.address = nextPc;
+		subroutine.calls++;
+
+		//Runaway recursion is not tracked past the depth the real stack could hold
+		if (callStack.size() < MAX_CALL_DEPTH)
+			callStack.push_back({ nextPc, totalInstructions });
+	}
+		break;
+
+	case Opcodes::Return:
+		if (!callStack.empty())
+		{
+			CallFrame frame = callStack.back();
+			callStack.pop_back();
+
+			subroutines[frame.subroutine].inclusiveInstructions += totalInstructions - frame.entryInstruction;
+		}
+		break;
+
+	case Opcodes::Jump:
+	case Opcodes::JumpV0:
+	{
+		//BNNN can land past the end of memory, loops are keyed on where it wraps to
+		unsigned short from = address & (Chip8::MEMORY_SIZE - 1);
+		unsigned short to = nextPc & (Chip8::MEMORY_SIZE - 1);
+
+		//A jump backwards (or to itself) closes a loop
+		if (to <= from)
+			backwardJumps[(unsigned int)from << 16 | to]++;
+	}
+		break;
+
+	default:
+		break;
+	}
+}
+
+std::vector<Profiler::Loop> Profiler::collectLoops()
+{
+	std::vector<Loop> loops;
+
+	for (auto& jump : backwardJumps)
+	{
+		Loop loop;
+		loop.end = (unsigned short)(jump.first >> 16);
+		loop.start = (unsigned short)(jump.first & 0xFFFF);
+		loop.iterations = jump.second;
+		loop.bodyInstructions = 0;
+
+		for (unsigned int address = loop.start; address <= loop.end && address < Chip8::MEMORY_SIZE; address++)
+			loop.bodyInstructions += addressCounts[address];
+
+		loops.push_back(loop);
+	}
+
+	std::sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+		return a.bodyInstructions > b.bodyInstructions;
+	});
+
+	return loops;
+}
+
+std::vector<Profiler::Subroutine> Profiler::collectSubroutines()
+{
+	std::vector<Subroutine> sorted;
+
+	for (auto& subroutine : subroutines)
+		sorted.push_back(subroutine.second);
+
+	std::sort(sorted.begin(), sorted.end(), [](const Subroutine& a, const Subroutine& b) {
+		return a.inclusiveInstructions > b.inclusiveInstructions;
+	});
+
+	return sorted;
+}
+
+std::string Profiler::generateReport(unsigned int maxEntries)
+{
+	std::stringstream ss;
+
+	ss << "Chip8 Profile" << std::endl;
+	ss << "Instructions executed: " << totalInstructions << std::endl;
+	ss << "Skips taken: " << skipsTaken << ", not taken: " << skipsNotTaken << std::endl;
+
+	//Hottest addresses
+	std::vector<unsigned short> addresses;
+	for (unsigned int i = 0; i < Chip8::MEMORY_SIZE; i++)
+	{
+		if (addressCounts[i] > 0)
+			addresses.push_back((unsigned short)i);
+	}
+
+	std::sort(addresses.begin(), addresses.end(), [this](unsigned short a, unsigned short b) {
+		return addressCounts[a] > addressCounts[b];
+	});
+
+	ss << std::endl << "Hottest addresses:" << std::endl;
+	for (unsigned int i = 0; i < addresses.size() && i < maxEntries; i++)
+	{
+		ss << "  " << toHex(addresses[i]) << "  " << std::setw(12) << addressCounts[addresses[i]] << std::endl;
+	}
+
+	//Opcode histogram
+	ss << std::endl << "Opcode histogram:" << std::endl;
+	for (int i = 0; i < Opcodes::ClassCount; i++)
+	{
+		if (classCounts[i] == 0)
+			continue;
+
+		double percent = (100.0 * classCounts[i]) / totalInstructions;
+		ss << "  " << Opcodes::getPattern((Opcodes::Class)i) << "  " << std::setw(12) << classCounts[i]
+			<< "  " << std::fixed << std::setprecision(2) << percent << "%" << std::endl;
+	}
+
+	//Loops
+	std::vector<Loop> loops = collectLoops();
+	ss << std::endl << "Hottest loops:" << std::endl;
+	for (unsigned int i = 0; i < loops.size() && i < maxEntries; i++)
+	{
+		ss << "  " << toHex(loops[i].start) << "-" << toHex(loops[i].end)
+			<< "  iterations: " << loops[i].iterations
+			<< "  body instructions: " << loops[i].bodyInstructions << std::endl;
+	}
+
+	//Subroutines
+	std::vector<Subroutine> sorted = collectSubroutines();
+	ss << std::endl << "Hottest subroutines (inclusive):" << std::endl;
+	for (unsigned int i = 0; i < sorted.size() && i < maxEntries; i++)
+	{
+		ss << "  " << toHex(sorted[i].address)
+			<< "  calls: " << sorted[i].calls
+			<< "  inclusive instructions: " << sorted[i].inclusiveInstructions << std::endl;
+
+		for (auto& edge : callEdges)
+		{
+			if ((edge.first >> 16) == sorted[i].address)
+				ss << "    -> " << toHex(edge.first & 0xFFFF) << " x" << edge.second << std::endl;
+		}
+	}
+
+	return ss.str();
+}
+
+std::string Profiler::generateJSON()
+{
+	std::stringstream ss;
+	bool first = true;
+
+	ss << "{" << std::endl;
+	ss << "  \"instructions\": " << totalInstructions << "," << std::endl;
+	ss << "  \"skips\": { \"taken\": " << skipsTaken << ", \"notTaken\": " << skipsNotTaken << " }," << std::endl;
+
+	//Only addresses that were executed are listed, most of memory is usually untouched
+	ss << "  \"addresses\": {";
+	for (unsigned int i = 0; i < Chip8::MEMORY_SIZE; i++)
+	{
+		if (addressCounts[i] == 0)
+			continue;
+
+		ss << (first ? "" : ",") << " \"" << toHex(i) << "\": " << addressCounts[i];
+		first = false;
+	}
+	ss << " }," << std::endl;
+
+	first = true;
+	ss << "  \"opcodes\": {";
+	for (int i = 0; i < Opcodes::ClassCount; i++)
+	{
+		ss << (first ? "" : ",") << " \"" << Opcodes::getPattern((Opcodes::Class)i) << "\": " << classCounts[i];
+		first = false;
+	}
+	ss << " }," << std::endl;
+
+	first = true;
+	ss << "  \"loops\": [";
+	for (auto& loop : collectLoops())
+	{
+		ss << (first ? "" : ",") << std::endl << "    { \"start\": \"" << toHex(loop.start)
+			<< "\", \"end\": \"" << toHex(loop.end)
+			<< "\", \"iterations\": " << loop.iterations
+			<< ", \"bodyInstructions\": " << loop.bodyInstructions << " }";
+		first = false;
+	}
+	ss << std::endl << "  ]," << std::endl;
+
+	first = true;
+	ss << "  \"subroutines\": [";
+	for (auto& subroutine : collectSubroutines())
+	{
+		ss << (first ? "" : ",") << std::endl << "    { \"address\": \"" << toHex(subroutine.address)
+			<< "\", \"calls\": " << subroutine.calls
+			<< ", \"inclusiveInstructions\": " << subroutine.inclusiveInstructions << " }";
+		first = false;
+	}
+	ss << std::endl << "  ]," << std::endl;
+
+	first = true;
+	ss << "  \"callGraph\": [";
+	for (auto& edge : callEdges)
+	{
+		ss << (first ? "" : ",") << std::endl << "    { \"caller\": \"" << toHex(edge.first >> 16)
+			<< "\", \"callee\": \"" << toHex(edge.first & 0xFFFF)
+			<< "\", \"calls\": " << edge.second << " }";
+		first = false;
+	}
+	ss << std::endl << "  ]" << std::endl;
+	ss << "}" << std::endl;
+
+	return ss.str();
+}
+
+bool Profiler::writeReports(const std::string& basePath)
+{
+	std::ofstream report(basePath + ".txt");
+	std::ofstream json(basePath + ".json");
+
+	if (!report.is_open() || !json.is_open())
+	{
+		LOG_E("Could not open profiler output files: " + basePath);
+		return false;
+	}
+
+	report << generateReport();
+	json << generateJSON();
+
+	LOG_I("Profiler reports written to: " + basePath + ".txt/.json");
+	return true;
+}
+
+std::string Profiler::toHex(unsigned int value)
+{
+	std::stringstream ss;
+	ss << "0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << value;
+	return ss.str();
+}
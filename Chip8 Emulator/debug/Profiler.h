@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "../Chip8.h"
+#include "../Opcodes.h"
+
+/**
+@brief Collects execution statistics from a running Chip8.
+
+Attach with Chip8::setProfiler(). When no profiler is attached the interpreter runs an
+uninstrumented instantiation of its cycle function, so profiling costs nothing when off.
+*/
+class Profiler
+{
+public:
+	Profiler();
+
+	/** @brief Clear all collected statistics. */
+	void reset();
+
+	/**
+	@brief Record a single executed instruction. Called by the interpreter after each instruction.
+
+	@param address The address the opcode was fetched from.
+	@param opcode  The executed opcode.
+	@param nextPc  The program counter after execution.
+	*/
+	void recordInstruction(unsigned short address, unsigned short opcode, unsigned short nextPc);
+
+	/**
+	@brief Generate a human readable report of the hottest addresses, loops and subroutines.
+
+	@param maxEntries Max number of entries listed in each section.
+
+	@return The report text.
+	*/
+	std::string generateReport(unsigned int maxEntries = 16);
+
+	/**
+	@brief Generate a machine readable JSON report containing all collected statistics.
+
+	@return The JSON text.
+	*/
+	std::string generateJSON();
+
+	/**
+	@brief Write both reports to disk, as "<basePath>.txt" and "<basePath>.json".
+
+	@param basePath Path and filename without an extension.
+
+	@return bool - Was successful.
+	*/
+	bool writeReports(const std::string& basePath);
+
+private:
+
+	/** @brief A loop found through a backwards jump, the body is [start, end]. */
+	struct Loop
+	{
+		unsigned short start;
+		unsigned short end;
+		unsigned long long iterations;
+		unsigned long long bodyInstructions;
+	};
+
+	/** @brief Counts for a subroutine entered through 2NNN. */
+	struct Subroutine
+	{
+		unsigned short address;
+		unsigned long long calls;
+		///Instructions executed inside this subroutine and everything it calls.
+		unsigned long long inclusiveInstructions;
+	};
+
+	/** @brief An active 2NNN call waiting for its 00EE. */
+	struct CallFrame
+	{
+		unsigned short subroutine;
+		unsigned long long entryInstruction;
+	};
+
+	/** @brief Deepest call stack tracked, the Chip8 stack only has 16 entries anyway. */
+	static const unsigned int MAX_CALL_DEPTH = 16;
+
+	/** @brief Executions of each address in memory. */
+	unsigned long long addressCounts[Chip8::MEMORY_SIZE];
+
+	/** @brief Executions of each instruction class. */
+	unsigned long long classCounts[Opcodes::ClassCount];
+
+	unsigned long long totalInstructions;
+
+	unsigned long long skipsTaken;
+	unsigned long long skipsNotTaken;
+
+	/** @brief Backwards jumps, keyed by (from << 16 | to). */
+	std::unordered_map<unsigned int, unsigned long long> backwardJumps;
+
+	/** @brief Subroutines keyed by their entry address. */
+	std::unordered_map<unsigned short, Subroutine> subroutines;
+
+	/** @brief Call graph edges, keyed by (caller << 16 | callee). Top level code is treated as 0x200. */
+	std::unordered_map<unsigned int, unsigned long long> callEdges;
+
+	std::vector<CallFrame> callStack;
+
+	std::vector<Loop> collectLoops();
+
+	std::vector<Subroutine> collectSubroutines();
+
+	static std::string toHex(unsigned int value);
+};
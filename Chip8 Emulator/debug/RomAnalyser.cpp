@@ -0,0 +1,557 @@
+#include "RomAnalyser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "../Opcodes.h"
+#include "../misc/Log.h"
+#include "../rom/RomCache.h"
+
+const unsigned short RomAnalyser::LOAD_ADDRESS;
+const int RomAnalyser::MEMORY_SIZE;
+
+std::mutex RomAnalyser::cacheMutex;
+std::unordered_map<uint64_t, std::shared_ptr<const RomAnalyser::Analysis>> RomAnalyser::cache;
+
+namespace
+{
+	//Index register states while tracking I, anything else is a known address
+	const int I_UNVISITED = -2;
+	const int I_UNKNOWN = -1;
+
+	inline unsigned short readOpcode(const unsigned char* memory, unsigned short address)
+	{
+		return (unsigned short)(memory[address & 0xFFF] << 8 | memory[(address + 1) & 0xFFF]);
+	}
+
+	std::string toHex(unsigned int value, int width)
+	{
+		std::stringstream ss;
+		ss << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+		return ss.str();
+	}
+
+	std::string joinAddresses(const std::vector<unsigned short>& addresses)
+	{
+		std::string text;
+		for (unsigned short address : addresses)
+			text += (text.empty() ? "0x" : ", 0x") + toHex(address, 3);
+
+		return text;
+	}
+}
+
+std::shared_ptr<const RomAnalyser::Analysis> RomAnalyser::analyse(const std::shared_ptr<const RomImage>& image)
+{
+	if (image == nullptr || image->data.size() > (size_t)(MEMORY_SIZE - LOAD_ADDRESS))
+		return nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		auto cached = cache.find(image->hash);
+		if (cached != cache.end())
+			return cached->second;
+	}
+
+	unsigned char memory[MEMORY_SIZE] = {};
+	if (!image->data.empty())
+		memcpy(memory + LOAD_ADDRESS, image->data.data(), image->data.size());
+
+	std::shared_ptr<Analysis> analysis = std::make_shared<Analysis>();
+	analysis->romHash = image->hash;
+	analysis->romEnd = (unsigned short)(LOAD_ADDRESS + image->data.size());
+	analysis->byteFlags.assign(MEMORY_SIZE, Unreached);
+
+	std::vector<bool> leaders(MEMORY_SIZE, false);
+	std::vector<unsigned short> functionEntries;
+
+	discoverCode(*analysis, memory, leaders, functionEntries);
+	buildBlocks(*analysis, memory, leaders);
+	buildFunctions(*analysis, functionEntries);
+	trackIndexRegister(*analysis, memory);
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cache[image->hash] = analysis;
+
+	return analysis;
+}
+
+void RomAnalyser::clearCache()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cache.clear();
+}
+
+void RomAnalyser::discoverCode(Analysis& analysis, const unsigned char* memory, std::vector<bool>& leaders,
+	std::vector<unsigned short>& functionEntries)
+{
+	std::vector<uint8_t>& flags = analysis.byteFlags;
+	std::vector<unsigned short> pending;
+
+	auto branchTo = [&](unsigned short target)
+	{
+		leaders[target & 0xFFF] = true;
+		pending.push_back(target & 0xFFF);
+	};
+
+	functionEntries.push_back(LOAD_ADDRESS);
+	branchTo(LOAD_ADDRESS);
+
+	while (!pending.empty())
+	{
+		unsigned short address = pending.back();
+		pending.pop_back();
+
+		//Follow the path until it ends, leaves the ROM or joins code already found
+		while (address >= LOAD_ADDRESS && address + 2 <= analysis.romEnd && !(flags[address] & InstructionStart))
+		{
+			unsigned short opcode = readOpcode(memory, address);
+			Opcodes::Class opClass = Opcodes::classify(opcode);
+
+			//Nothing the interpreter would run, so the path has most likely wandered into data
+			if (opClass == Opcodes::Unknown || opClass == Opcodes::SysCall)
+				break;
+
+			flags[address] |= InstructionStart;
+			flags[address + 1] |= InstructionOperand;
+
+			//Successors wrap like the core's pc, the last instruction in memory is followed by address 0
+			unsigned short next = (address + 2) & 0xFFF;
+
+			if (opClass == Opcodes::Return)
+				break;
+
+			if (opClass == Opcodes::Jump)
+			{
+				branchTo(opcode & 0x0FFF);
+				break;
+			}
+
+			if (opClass == Opcodes::JumpV0)
+			{
+				analysis.indirectJumps.push_back(address);
+				break;
+			}
+
+			if (Opcodes::isSkip(opClass))
+			{
+				branchTo(next);
+				branchTo(next + 2);
+				break;
+			}
+
+			if (opClass == Opcodes::Call)
+			{
+				unsigned short target = opcode & 0x0FFF;
+				if (std::find(functionEntries.begin(), functionEntries.end(), target) == functionEntries.end())
+					functionEntries.push_back(target);
+
+				branchTo(target);
+
+				//The return lands on the next instruction, which starts a new block
+				leaders[next] = true;
+			}
+
+			address = next;
+		}
+	}
+}
+
+void RomAnalyser::buildBlocks(Analysis& analysis, const unsigned char* memory, const std::vector<bool>& leaders)
+{
+	for (int start = LOAD_ADDRESS; start < MEMORY_SIZE; start++)
+	{
+		if (!leaders[start] || !analysis.isInstruction((unsigned short)start))
+			continue;
+
+		BasicBlock block = {};
+		block.start = (unsigned short)start;
+
+		unsigned short address = block.start;
+		for (;;)
+		{
+			unsigned short opcode = readOpcode(memory, address);
+			Opcodes::Class opClass = Opcodes::classify(opcode);
+			unsigned short end = address + 2;
+			unsigned short next = end & 0xFFF;
+
+			if (opClass == Opcodes::Return)
+			{
+				block.endsInReturn = true;
+			}
+			else if (opClass == Opcodes::Jump)
+			{
+				block.successors.push_back(opcode & 0x0FFF);
+				block.endsInHalt = ((opcode & 0x0FFF) == address);
+			}
+			else if (opClass == Opcodes::JumpV0)
+			{
+				block.endsInIndirectJump = true;
+			}
+			else if (Opcodes::isSkip(opClass))
+			{
+				block.successors.push_back(next);
+				block.successors.push_back((next + 2) & 0xFFF);
+			}
+			else if (opClass == Opcodes::Call)
+			{
+				block.callTarget = opcode & 0x0FFF;
+				block.successors.push_back(next);
+			}
+			else if (leaders[next])
+			{
+				//Falls through into another block
+				block.successors.push_back(next);
+			}
+			else if (analysis.isInstruction(next))
+			{
+				address = next;
+				continue;
+			}
+
+			block.end = end;
+			break;
+		}
+
+		//Drop edges to anything that isn't code, e.g. a jump out of the ROM
+		block.successors.erase(std::remove_if(block.successors.begin(), block.successors.end(),
+			[&](unsigned short successor) { return !analysis.isInstruction(successor); }), block.successors.end());
+
+		analysis.blocks[block.start] = block;
+	}
+
+	for (auto& block : analysis.blocks)
+	{
+		for (unsigned short successor : block.second.successors)
+		{
+			auto target = analysis.blocks.find(successor);
+			if (target != analysis.blocks.end())
+				target->second.predecessors.push_back(block.first);
+		}
+	}
+}
+
+void RomAnalyser::buildFunctions(Analysis& analysis, const std::vector<unsigned short>& functionEntries)
+{
+	for (unsigned short entry : functionEntries)
+	{
+		if (analysis.blocks.find(entry) == analysis.blocks.end())
+			continue;
+
+		Function function;
+		function.entry = entry;
+
+		//Calls return to the next block, so following successors stays inside the function
+		std::vector<unsigned short> pending(1, entry);
+		std::vector<bool> visited(MEMORY_SIZE, false);
+		visited[entry] = true;
+
+		while (!pending.empty())
+		{
+			const BasicBlock& block = analysis.blocks[pending.back()];
+			pending.pop_back();
+
+			function.blocks.push_back(block.start);
+
+			if (block.callTarget != 0 && std::find(function.callees.begin(), function.callees.end(), block.callTarget) == function.callees.end())
+				function.callees.push_back(block.callTarget);
+
+			for (unsigned short successor : block.successors)
+			{
+				if (!visited[successor])
+				{
+					visited[successor] = true;
+					pending.push_back(successor);
+				}
+			}
+		}
+
+		std::sort(function.blocks.begin(), function.blocks.end());
+		std::sort(function.callees.begin(), function.callees.end());
+
+		analysis.functions[entry] = function;
+	}
+
+	for (auto& block : analysis.blocks)
+	{
+		auto callee = analysis.functions.find(block.second.callTarget);
+		if (block.second.callTarget != 0 && callee != analysis.functions.end())
+			callee->second.callSites.push_back(block.second.end - 2);
+	}
+}
+
+void RomAnalyser::trackIndexRegister(Analysis& analysis, const unsigned char* memory)
+{
+	//I on entry to each block: unvisited, unknown (paths disagree) or a known address
+	std::map<unsigned short, int> entryI;
+	for (auto& block : analysis.blocks)
+		entryI[block.first] = I_UNVISITED;
+
+	//I is 0 after a reset, subroutines get I from their call sites like any other successor
+	std::vector<unsigned short> pending(1, LOAD_ADDRESS);
+	entryI[LOAD_ADDRESS] = 0;
+
+	auto simulate = [&](const BasicBlock& block, bool record) -> int
+	{
+		int I = entryI[block.start];
+
+		for (unsigned short address = block.start; address < block.end; address += 2)
+		{
+			unsigned short opcode = readOpcode(memory, address);
+			unsigned int x = (opcode & 0x0F00) >> 8;
+
+			switch (Opcodes::classify(opcode))
+			{
+			case Opcodes::LoadI:
+				I = opcode & 0x0FFF;
+				break;
+
+			case Opcodes::AddI:
+			case Opcodes::FontCharacter:
+				I = I_UNKNOWN;
+				break;
+
+			case Opcodes::Draw:
+				//DXY0 is a 16x16 SCHIP sprite
+				if (record && I != I_UNKNOWN)
+					markRange(analysis, (unsigned short)I, ((opcode & 0x000F) == 0 ? 32 : (opcode & 0x000F)), SpriteData);
+				break;
+
+			case Opcodes::StoreBCD:
+			case Opcodes::StoreRegisters:
+			{
+				unsigned int length = (Opcodes::classify(opcode) == Opcodes::StoreBCD ? 3 : x + 1);
+
+				if (record && I == I_UNKNOWN)
+				{
+					analysis.unknownStores.push_back(address);
+				}
+				else if (record)
+				{
+					for (unsigned int i = 0; i < length; i++)
+					{
+						if (analysis.isCode((unsigned short)(I + i)))
+						{
+							analysis.codeWrites.push_back({ address, (unsigned short)I, (unsigned short)length });
+							break;
+						}
+					}
+
+					markRange(analysis, (unsigned short)I, length, StoredData);
+				}
+
+				//Whether I moves past the registers depends on the ROM's quirks
+				if (Opcodes::classify(opcode) == Opcodes::StoreRegisters)
+					I = I_UNKNOWN;
+			}
+				break;
+
+			case Opcodes::LoadRegisters:
+				if (record && I != I_UNKNOWN)
+					markRange(analysis, (unsigned short)I, x + 1, LoadedData);
+
+				I = I_UNKNOWN;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		return I;
+	};
+
+	auto merge = [&](unsigned short target, int I)
+	{
+		int& targetI = entryI[target];
+		int merged = (targetI == I_UNVISITED ? I : (targetI == I ? I : I_UNKNOWN));
+
+		if (merged != targetI)
+		{
+			targetI = merged;
+			pending.push_back(target);
+		}
+	};
+
+	//Iterate to a fixed point, each block's entry can only move from unvisited to known to unknown
+	while (!pending.empty())
+	{
+		const BasicBlock& block = analysis.blocks[pending.back()];
+		pending.pop_back();
+
+		int exitI = simulate(block, false);
+
+		//The subroutine could leave I anywhere, so it is unknown once the call returns
+		if (block.callTarget != 0 && entryI.count(block.callTarget) != 0)
+		{
+			merge(block.callTarget, exitI);
+			exitI = I_UNKNOWN;
+		}
+
+		for (unsigned short successor : block.successors)
+			merge(successor, exitI);
+	}
+
+	//Only classify memory once the states have settled, an earlier guess could have been wrong
+	for (auto& block : analysis.blocks)
+	{
+		if (entryI[block.first] != I_UNVISITED)
+			simulate(block.second, true);
+	}
+}
+
+void RomAnalyser::markRange(Analysis& analysis, unsigned short start, unsigned int length, ByteFlags flag)
+{
+	for (unsigned int i = 0; i < length; i++)
+		analysis.byteFlags[(start + i) & 0xFFF] |= flag;
+}
+
+std::string RomAnalyser::generateListing(const Analysis& analysis, const RomImage& image)
+{
+	std::stringstream ss;
+
+	size_t codeBytes = 0, dataBytes = 0, unreachedBytes = 0;
+	for (int address = LOAD_ADDRESS; address < analysis.romEnd; address++)
+	{
+		uint8_t flags = analysis.byteFlags[address];
+
+		if (flags & (InstructionStart | InstructionOperand))
+			codeBytes++;
+		else if (flags != Unreached)
+			dataBytes++;
+		else
+			unreachedBytes++;
+	}
+
+	ss << "; ROM " << toHex((unsigned int)(analysis.romHash >> 32), 8) << toHex((unsigned int)analysis.romHash, 8)
+		<< ", " << image.data.size() << " bytes loaded at 0x" << toHex(LOAD_ADDRESS, 3) << std::endl;
+	ss << "; " << codeBytes << " code bytes, " << dataBytes << " data bytes, " << unreachedBytes << " unreached bytes" << std::endl;
+	ss << "; " << analysis.blocks.size() << " basic blocks, " << analysis.functions.size() << " functions" << std::endl;
+
+	if (!analysis.indirectJumps.empty())
+		ss << "; Indirect jumps not followed: " << joinAddresses(analysis.indirectJumps) << std::endl;
+
+	for (const CodeWrite& write : analysis.codeWrites)
+	{
+		ss << "; Self modifying: 0x" << toHex(write.pc, 3) << " writes " << write.length
+			<< " bytes from 0x" << toHex(write.target, 3) << " over code" << std::endl;
+	}
+
+	if (!analysis.unknownStores.empty())
+		ss << "; Stores with an unknown I: " << joinAddresses(analysis.unknownStores) << std::endl;
+
+	ss << std::endl << "; Call graph" << std::endl;
+	for (auto& function : analysis.functions)
+	{
+		ss << ";   0x" << toHex(function.first, 3) << " -> "
+			<< (function.second.callees.empty() ? "(leaf)" : joinAddresses(function.second.callees)) << std::endl;
+	}
+
+	int address = LOAD_ADDRESS;
+	while (address < analysis.romEnd)
+	{
+		uint8_t flags = analysis.byteFlags[address];
+
+		auto function = analysis.functions.find((unsigned short)address);
+		if (function != analysis.functions.end())
+		{
+			ss << std::endl << "; ---- " << (address == LOAD_ADDRESS ? "entry" : "subroutine") << " 0x" << toHex(address, 3);
+
+			if (!function->second.callSites.empty())
+				ss << ", called from " << joinAddresses(function->second.callSites);
+
+			ss << std::endl;
+		}
+
+		auto block = analysis.blocks.find((unsigned short)address);
+		if (block != analysis.blocks.end())
+		{
+			ss << "L" << toHex(address, 3) << ":";
+
+			if (!block->second.predecessors.empty())
+				ss << "  ; from " << joinAddresses(block->second.predecessors);
+
+			ss << std::endl;
+		}
+
+		if ((flags & InstructionStart) && address + 1 < analysis.romEnd)
+		{
+			unsigned short opcode = (unsigned short)(image.data[address - LOAD_ADDRESS] << 8 | image.data[address + 1 - LOAD_ADDRESS]);
+
+			ss << "  " << toHex(address, 3) << "  " << toHex(opcode, 4) << "  " << Opcodes::disassemble(opcode);
+
+			if (flags & (SpriteData | StoredData | LoadedData))
+				ss << "  ; also used as data";
+
+			ss << std::endl;
+			address += 2;
+		}
+		else if (flags & SpriteData)
+		{
+			//One sprite row per line with a picture of it
+			unsigned char byte = image.data[address - LOAD_ADDRESS];
+
+			ss << "  " << toHex(address, 3) << "  " << toHex(byte, 2) << "    DB 0x" << toHex(byte, 2) << "  ; ";
+			for (int bit = 7; bit >= 0; bit--)
+				ss << ((byte >> bit) & 1 ? '#' : '.');
+
+			ss << std::endl;
+			address++;
+		}
+		else
+		{
+			//Other data 8 bytes to a line, split wherever the kind of data changes
+			ss << "  " << toHex(address, 3) << "        DB ";
+
+			int count = 0;
+			do
+			{
+				ss << (count == 0 ? "0x" : ", 0x") << toHex(image.data[address - LOAD_ADDRESS], 2);
+				address++;
+				count++;
+			} while (count < 8 && address < analysis.romEnd && analysis.byteFlags[address] == flags
+				&& analysis.blocks.find((unsigned short)address) == analysis.blocks.end());
+
+			if (flags & StoredData)
+				ss << "  ; written";
+			else if (flags & LoadedData)
+				ss << "  ; loaded";
+			else
+				ss << "  ; unreached";
+
+			ss << std::endl;
+		}
+	}
+
+	return ss.str();
+}
+
+bool RomAnalyser::writeListing(const std::string& romPath, const std::string& listingPath)
+{
+	std::shared_ptr<const RomImage> image = RomCache::load(romPath);
+	if (image == nullptr)
+		return false;
+
+	std::shared_ptr<const Analysis> analysis = analyse(image);
+	if (analysis == nullptr)
+	{
+		LOG_E("ROM too big to analyse: " + romPath);
+		return false;
+	}
+
+	std::ofstream file(listingPath);
+	if (!file.is_open())
+	{
+		LOG_E("Could not open disassembly output: " + listingPath);
+		return false;
+	}
+
+	file << generateListing(*analysis, *image);
+
+	LOG_I("Disassembly written to: " + listingPath);
+	return true;
+}
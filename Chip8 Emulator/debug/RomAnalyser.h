@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct RomImage;
+
+/**
+@brief Static analysis of a ROM image loaded at 0x200.
+
+Disassembles by recursive descent from the entry point, following jumps, calls and both sides
+of every skip, so bytes that are never reachable as instructions are left as data. From that
+it builds the basic block control flow graph and the call graph, tracks I through the
+graph and into calls to find the sprite bytes DXYN draws and the memory FX33/FX55/FX65 touch, and flags
+stores that land on instructions as likely self-modifying code.
+
+BNNN jumps can't be followed statically, so code only reachable through them is reported as
+data and the jump is listed so the result can be treated with care.
+*/
+class RomAnalyser
+{
+public:
+	static const unsigned short LOAD_ADDRESS = 0x200;
+
+	static const int MEMORY_SIZE = 4096;
+
+	/** @brief What a byte of memory was found to be. A byte can be more than one, e.g. an instruction that is also drawn. */
+	enum ByteFlags
+	{
+		Unreached = 0,
+		InstructionStart = 1,   ///< First byte of a reachable instruction
+		InstructionOperand = 2, ///< Second byte of a reachable instruction
+		SpriteData = 4,         ///< Drawn by a DXYN with a known I
+		StoredData = 8,         ///< Written by FX33/FX55 with a known I
+		LoadedData = 16         ///< Read by FX65 with a known I
+	};
+
+	/** @brief A straight line run of instructions, only ever entered at its start. */
+	struct BasicBlock
+	{
+		unsigned short start;
+		///One past the last instruction
+		unsigned short end;
+		std::vector<unsigned short> successors;
+		std::vector<unsigned short> predecessors;
+		///Subroutine called by the last instruction, 0 if it isn't a call
+		unsigned short callTarget;
+		bool endsInReturn;
+		///Ends in BNNN, so its successors are unknown
+		bool endsInIndirectJump;
+		///Ends in a jump to itself, the usual way a ROM stops
+		bool endsInHalt;
+	};
+
+	/** @brief A subroutine (or the ROM entry point) and the blocks reachable from it without a call. */
+	struct Function
+	{
+		unsigned short entry;
+		std::vector<unsigned short> blocks;
+		std::vector<unsigned short> callees;
+		///Addresses of the 2NNN instructions that call it
+		std::vector<unsigned short> callSites;
+	};
+
+	/** @brief A store with a known I that overwrites reachable instructions. */
+	struct CodeWrite
+	{
+		unsigned short pc;
+		unsigned short target;
+		unsigned short length;
+	};
+
+	struct Analysis
+	{
+		uint64_t romHash;
+
+		///One past the last ROM byte
+		unsigned short romEnd;
+
+		///ByteFlags for every address
+		std::vector<uint8_t> byteFlags;
+
+		///Keyed by start address
+		std::map<unsigned short, BasicBlock> blocks;
+
+		///Keyed by entry address
+		std::map<unsigned short, Function> functions;
+
+		std::vector<CodeWrite> codeWrites;
+
+		///BNNN instructions, whose targets weren't followed
+		std::vector<unsigned short> indirectJumps;
+
+		///FX33/FX55 instructions where I couldn't be worked out, which could write anywhere
+		std::vector<unsigned short> unknownStores;
+
+		bool isInstruction(unsigned short address) const { return (byteFlags[address & 0xFFF] & InstructionStart) != 0; }
+
+		bool isCode(unsigned short address) const { return (byteFlags[address & 0xFFF] & (InstructionStart | InstructionOperand)) != 0; }
+
+		///Could the ROM rewrite its own instructions, either through a known store or one that can't be followed
+		bool mayModifyCode() const { return !codeWrites.empty() || !unknownStores.empty(); }
+
+		///Was every reachable instruction found, false if there are BNNN jumps that weren't followed
+		bool isComplete() const { return indirectJumps.empty(); }
+	};
+
+	/**
+	@brief Analyse a ROM, returning the cached result if the same contents have been analysed before.
+
+	@param image The ROM.
+
+	@return The analysis, nullptr if the ROM doesn't fit in memory.
+	*/
+	static std::shared_ptr<const Analysis> analyse(const std::shared_ptr<const RomImage>& image);
+
+	/** @brief A disassembly listing with labels, data, the call graph and anything needing attention. */
+	static std::string generateListing(const Analysis& analysis, const RomImage& image);
+
+	/**
+	@brief Analyse a ROM file and write its disassembly listing.
+
+	@param romPath     The ROM to disassemble.
+	@param listingPath The text file to write.
+
+	@return bool - Was successful.
+	*/
+	static bool writeListing(const std::string& romPath, const std::string& listingPath);
+
+	/** @brief Forget every cached analysis. */
+	static void clearCache();
+
+private:
+	static std::mutex cacheMutex;
+
+	static std::unordered_map<uint64_t, std::shared_ptr<const Analysis>> cache;
+
+	/** @brief Recursive descent from the entry point, marking instructions and collecting block leaders. */
+	static void discoverCode(Analysis& analysis, const unsigned char* memory, std::vector<bool>& leaders,
+		std::vector<unsigned short>& functionEntries);
+
+	/** @brief Split the discovered instructions into blocks and link them up. */
+	static void buildBlocks(Analysis& analysis, const unsigned char* memory, const std::vector<bool>& leaders);
+
+	static void buildFunctions(Analysis& analysis, const std::vector<unsigned short>& functionEntries);
+
+	/** @brief Track I across the control flow graph to classify the memory each instruction touches. */
+	static void trackIndexRegister(Analysis& analysis, const unsigned char* memory);
+
+	static void markRange(Analysis& analysis, unsigned short start, unsigned int length, ByteFlags flag);
+};
@@ -0,0 +1,151 @@
+#include "TraceBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+#include "../Opcodes.h"
+#include "../misc/Log.h"
+
+const uint8_t TraceBuffer::NO_REGISTER;
+const uint32_t TraceBuffer::FILE_VERSION;
+
+TraceBuffer::TraceBuffer(uint64_t capacity)
+	: writeIndex(0)
+{
+	uint64_t roundedCapacity = 1;
+	while (roundedCapacity < capacity)
+		roundedCapacity <<= 1;
+
+	mask = roundedCapacity - 1;
+
+	//Allocated up front so recording never has to
+	records.resize((size_t)roundedCapacity);
+}
+
+uint64_t TraceBuffer::size() const
+{
+	return (writeIndex > mask ? mask + 1 : writeIndex);
+}
+
+void TraceBuffer::clear()
+{
+	writeIndex = 0;
+}
+
+bool TraceBuffer::dump(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+
+	if (file == nullptr)
+	{
+		LOG_E("Could not open trace file for writing: " + path);
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(header.magic, "C8TR", 4);
+	header.version = FILE_VERSION;
+	header.recordCount = size();
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	//The ring is written as at most two contiguous runs, oldest records first
+	uint64_t oldest = writeIndex - header.recordCount;
+	uint64_t firstStart = oldest & mask;
+	uint64_t firstLength = std::min<uint64_t>(header.recordCount, (mask + 1) - firstStart);
+
+	if (success && firstLength > 0)
+		success = fwrite(&records[(size_t)firstStart], sizeof(TraceRecord), (size_t)firstLength, file) == firstLength;
+
+	if (success && header.recordCount > firstLength)
+	{
+		size_t secondLength = (size_t)(header.recordCount - firstLength);
+		success = fwrite(&records[0], sizeof(TraceRecord), secondLength, file) == secondLength;
+	}
+
+	fclose(file);
+
+	if (!success)
+	{
+		LOG_E("Could not write trace file: " + path);
+		return false;
+	}
+
+	LOG_I("Trace of " + std::to_string(header.recordCount) + " instructions written to: " + path);
+	return true;
+}
+
+bool TraceBuffer::decode(const std::string& tracePath, const std::string& textPath)
+{
+	FILE* file = fopen(tracePath.c_str(), "rb");
+
+	if (file == nullptr)
+	{
+		LOG_E("Could not open trace file: " + tracePath);
+		return false;
+	}
+
+	FileHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		memcmp(header.magic, "C8TR", 4) != 0 || header.version != FILE_VERSION)
+	{
+		LOG_E("Not a supported trace file: " + tracePath);
+		fclose(file);
+		return false;
+	}
+
+	std::ofstream output(textPath);
+	if (!output.is_open())
+	{
+		LOG_E("Could not open decoded trace output: " + textPath);
+		fclose(file);
+		return false;
+	}
+
+	output << std::setfill('0') << std::uppercase;
+
+	//Decode in chunks so huge traces don't need to fit in memory
+	std::vector<TraceRecord> chunk(4096);
+	uint64_t remaining = header.recordCount;
+
+	while (remaining > 0)
+	{
+		size_t toRead = (size_t)std::min<uint64_t>(remaining, chunk.size());
+		size_t read = fread(chunk.data(), sizeof(TraceRecord), toRead, file);
+
+		for (size_t i = 0; i < read; i++)
+		{
+			const TraceRecord& record = chunk[i];
+
+			output << std::dec << std::setw(12) << std::setfill(' ') << record.cycle << std::setfill('0')
+				<< "  " << std::hex << std::setw(3) << record.pc
+				<< "  " << std::setw(4) << record.opcode
+				<< "  " << Opcodes::getPattern(Opcodes::classify(record.opcode))
+				<< "  I=" << std::setw(3) << record.I;
+
+			if (record.changedRegister != NO_REGISTER)
+			{
+				output << "  V" << (unsigned int)record.changedRegister
+					<< "=" << std::setw(2) << (unsigned int)record.registerValue;
+			}
+
+			output << '\n';
+		}
+
+		if (read != toRead)
+		{
+			LOG_W("Trace file ended early: " + tracePath);
+			break;
+		}
+
+		remaining -= read;
+	}
+
+	fclose(file);
+
+	LOG_I("Decoded trace written to: " + textPath);
+	return true;
+}
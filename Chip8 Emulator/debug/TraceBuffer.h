@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+@brief Fixed size binary record of one executed instruction.
+
+Kept at 16 bytes so a million instructions of history only costs 16MB.
+*/
+struct TraceRecord
+{
+	uint64_t cycle;
+	uint16_t pc;
+	uint16_t opcode;
+	uint16_t I;
+	///Register written by the instruction, TraceBuffer::NO_REGISTER if none.
+	uint8_t changedRegister;
+	///Value of the changed register after the instruction.
+	uint8_t registerValue;
+};
+
+/**
+@brief Preallocated ring buffer holding the most recent executed instructions.
+
+Recording never allocates or formats anything so it is cheap enough to leave on, the buffer
+is only turned into text by decode() when it is dumped.
+*/
+class TraceBuffer
+{
+public:
+	static const uint8_t NO_REGISTER = 0xFF;
+
+	/**
+	@brief Constructor
+
+	@param capacity Number of records kept, rounded up to a power of two.
+	*/
+	explicit TraceBuffer(uint64_t capacity);
+
+	/** @brief Record an instruction, overwriting the oldest record once full. */
+	inline void record(uint64_t cycle, uint16_t pc, uint16_t opcode, uint16_t I,
+		uint8_t changedRegister, uint8_t registerValue)
+	{
+		TraceRecord& entry = records[(size_t)(writeIndex & mask)];
+		entry.cycle = cycle;
+		entry.pc = pc;
+		entry.opcode = opcode;
+		entry.I = I;
+		entry.changedRegister = changedRegister;
+		entry.registerValue = registerValue;
+		writeIndex++;
+	}
+
+	/**
+	@brief Gets the Vx register an opcode writes to.
+
+	@param opcode The executed opcode.
+
+	@return The register index, NO_REGISTER if the opcode doesn't write to Vx.
+	*/
+	static inline uint8_t getChangedRegister(uint16_t opcode)
+	{
+		switch (opcode >> 12)
+		{
+		case 0x6:
+		case 0x7:
+		case 0x8:
+		case 0xC:
+			return (opcode & 0x0F00) >> 8;
+
+		case 0xF:
+			switch (opcode & 0x00FF)
+			{
+			case 0x07:
+			case 0x0A:
+			case 0x65:
+				return (opcode & 0x0F00) >> 8;
+			}
+			return NO_REGISTER;
+
+		default:
+			return NO_REGISTER;
+		}
+	}
+
+	/** @brief Number of records currently held. */
+	uint64_t size() const;
+
+	uint64_t getCapacity() const { return mask + 1; }
+
+	/** @brief Forget all recorded instructions. */
+	void clear();
+
+	/**
+	@brief Write the held records to a binary trace file, oldest first.
+
+	@param path The file to write.
+
+	@return bool - Was successful.
+	*/
+	bool dump(const std::string& path) const;
+
+	/**
+	@brief Convert a binary trace file written by dump() into readable text.
+
+	@param tracePath The binary trace file.
+	@param textPath  The text file to write.
+
+	@return bool - Was successful.
+	*/
+	static bool decode(const std::string& tracePath, const std::string& textPath);
+
+private:
+
+	/** @brief Header at the start of every trace file. Native endian. */
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t recordCount;
+	};
+
+	static const uint32_t FILE_VERSION = 1;
+
+	std::vector<TraceRecord> records;
+
+	uint64_t mask;
+
+	/** @brief Total records ever written, the ring position is this masked. */
+	uint64_t writeIndex;
+};
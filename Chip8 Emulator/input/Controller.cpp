@@ -1,39 +1,76 @@
 #include "Controller.h"
 
-#include <assert.h>
-
 #include "../misc/Log.h"
-#include "../misc/Utility.h"
 
-Controller::Controller(int joyID)
-	: joystickID(joyID), leftStick(0), rightStick(0), leftTrigger(0), rightTrigger(0), 
-	rumbleSupported(false)
+namespace
 {
+	//Axis values map to positions through 257 point tables, one point per 256 raw values, read
+	//with linear interpolation. All in 16.16 fixed point so an axis event is a couple of integer ops.
+	const int AXIS_TABLE_POINTS = 257;
+	const int32_t FIXED_ONE = 1 << 16;
+
+	struct AxisTables
+	{
+		int32_t stick[AXIS_TABLE_POINTS];
+		int32_t trigger[AXIS_TABLE_POINTS];
 
-	buttons = {
-		{ A , None },
-		{ B , None },
-		{ X , None },
-		{ Y , None },
-		{ BACK , None },
-		{ GUIDE , None },
-		{ START , None },
-		{ LEFTSTICK , None },
-		{ RIGHTSTICK , None },
-		{ LEFTSHOULDER , None },
-		{ RIGHTSHOULDER , None },
-		{ DPAD_UP , None },
-		{ DPAD_DOWN , None },
-		{ DPAD_LEFT , None },
-		{ DPAD_RIGHT , None }
+		AxisTables()
+		{
+			for (int point = 0; point < AXIS_TABLE_POINTS; point++)
+			{
+				//The raw value at this point, the last point is just past the top of the range
+				long long value = (long long)point * 256 - 32768;
+
+				//-32768 to 32767 onto -1 to 1
+				stick[point] = (int32_t)(((value + 32768) * 2 * FIXED_ONE) / 65535 - FIXED_ONE);
+
+				//0 to 32767 onto 0 to 1, triggers never go negative
+				trigger[point] = (int32_t)(value > 0 ? (value * FIXED_ONE) / 32767 : 0);
+			}
+		}
 	};
 
+	const AxisTables axisTables;
+
+	int32_t lookupAxis(const int32_t* table, Sint16 value)
+	{
+		int index = value + 32768;
+		int point = index >> 8;
+		int fraction = index & 0xFF;
+
+		return table[point] + (((table[point + 1] - table[point]) * fraction) >> 8);
+	}
+
+	float fixedToFloat(int32_t value)
+	{
+		return value * (1.0f / FIXED_ONE);
+	}
+}
+
+Controller::Controller()
+	: gameController(nullptr), joystickID(-1), joystickInstanceID(-1), axes(),
+	buttonsCurrent(0), buttonsPrevious(0), haptic(nullptr), rumbleSupported(false)
+{
+
+}
+
+Controller::~Controller()
+{
+	close();
+}
+
+bool Controller::open(int joyID)
+{
+	close();
+
+	joystickID = joyID;
+
 	gameController = SDL_GameControllerOpen(joyID);
 	if (gameController == nullptr)
 	{
-		Log::logE("Controller (" + std::to_string(joyID) + ") did not Init");
-		Log::logE(SDL_GetError());
-		return;
+		LOG_E("Controller (" + std::to_string(joyID) + ") did not Init");
+		LOG_E(SDL_GetError());
+		return false;
 	}
 
 	SDL_Joystick* joy = SDL_GameControllerGetJoystick(gameController);
@@ -41,9 +78,10 @@ Controller::Controller(int joyID)
 
 
 	initializeHaptics(joy);
+	return true;
 }
 
-Controller::~Controller()
+void Controller::close()
 {
 	if (haptic != nullptr)
 	{
@@ -52,11 +90,21 @@ Controller::~Controller()
 		haptic = nullptr;
 	}
 
-	SDL_GameControllerClose(gameController);
-	gameController = nullptr;
+	if (gameController != nullptr)
+	{
+		SDL_GameControllerClose(gameController);
+		gameController = nullptr;
+	}
 
-	buttons.clear();
+	joystickID = -1;
+	joystickInstanceID = -1;
+	rumbleSupported = false;
+	buttonsCurrent = buttonsPrevious = 0;
 
+	for (int axis = 0; axis < SDL_CONTROLLER_AXIS_MAX; axis++)
+	{
+		axes[axis] = 0;
+	}
 }
 
 bool Controller::isValid()
@@ -82,17 +130,17 @@ SDL_JoystickID Controller::getJoystickInstanceID()
 
 bool Controller::wasButtonPressed(Button button)
 {
-	return (buttons.count(button) == 1 && buttons[button] == Pressed);
+	return ((buttonsCurrent & ~buttonsPrevious) >> button) & 1;
 }
 
 bool Controller::isButtonHeld(Button button)
 {
-	return (buttons.count(button) == 1 && (buttons[button] == Pressed || buttons[button] == Held));
+	return (buttonsCurrent >> button) & 1;
 }
 
 bool Controller::wasButtonReleased(Button button)
 {
-	return (buttons.count(button) == 1 && buttons[button] == Released);
+	return ((~buttonsCurrent & buttonsPrevious) >> button) & 1;
 }
 
 float Controller::getAxis1D(Axis1D axis)
@@ -100,15 +148,15 @@ float Controller::getAxis1D(Axis1D axis)
 	switch (axis)
 	{
 	case Controller::LeftTrigger:
-		return leftTrigger;
+		return fixedToFloat(axes[SDL_CONTROLLER_AXIS_TRIGGERLEFT]);
 		break;
 
 	case Controller::RightTrigger:
-		return rightTrigger;
+		return fixedToFloat(axes[SDL_CONTROLLER_AXIS_TRIGGERRIGHT]);
 		break;
 
 	default:
-		Log::logW("Invalid Axis1D requested");
+		LOG_W("Invalid Axis1D requested");
 		return 0.0f;
 		break;
 	}
@@ -119,15 +167,15 @@ Vec2 Controller::getAxis2D(Axis2D axis)
 	switch (axis)
 	{
 	case Controller::LeftStick:
-		return leftStick;
+		return Vec2(fixedToFloat(axes[SDL_CONTROLLER_AXIS_LEFTX]), fixedToFloat(axes[SDL_CONTROLLER_AXIS_LEFTY]));
 		break;
 	
 	case Controller::RightStick:
-		return rightStick;
+		return Vec2(fixedToFloat(axes[SDL_CONTROLLER_AXIS_RIGHTX]), fixedToFloat(axes[SDL_CONTROLLER_AXIS_RIGHTY]));
 		break;
 
 	default:
-		Log::logW("Invalid Axis2D requested");
+		LOG_W("Invalid Axis2D requested");
 		return Vec2(0);
 		break;
 	}
@@ -151,43 +199,40 @@ void Controller::processEvents(SDL_Event& e)
 
 void Controller::updateAxis(SDL_Event& e)
 {
-	Sint16 value = e.caxis.value;
-
 	switch (e.caxis.axis)
 	{
 	case SDL_CONTROLLER_AXIS_LEFTX:
-		leftStick.x = Utility::normaliseBetweenMinusOneAndOne(value, AXIS_MAX, AXIS_MIN);
-		break;
 	case SDL_CONTROLLER_AXIS_LEFTY:
-		leftStick.y = Utility::normaliseBetweenMinusOneAndOne(value, AXIS_MAX, AXIS_MIN);
-		break;
-
 	case SDL_CONTROLLER_AXIS_RIGHTX:
-		rightStick.x = Utility::normaliseBetweenMinusOneAndOne(value, AXIS_MAX, AXIS_MIN);
-		break;
 	case SDL_CONTROLLER_AXIS_RIGHTY:
-		rightStick.y = Utility::normaliseBetweenMinusOneAndOne(value, AXIS_MAX, AXIS_MIN);
+		axes[e.caxis.axis] = lookupAxis(axisTables.stick, e.caxis.value);
 		break;
 
 	case SDL_CONTROLLER_AXIS_TRIGGERLEFT:
-		leftTrigger = Utility::normaliseFloat(value, AXIS_MAX, 0);
-		break;
 	case SDL_CONTROLLER_AXIS_TRIGGERRIGHT:
-		rightTrigger = Utility::normaliseFloat(value, AXIS_MAX, 0);
+		axes[e.caxis.axis] = lookupAxis(axisTables.trigger, e.caxis.value);
 		break;
 	}
 }
 
 void Controller::updateButtons(SDL_Event& e)
 {
-	ButtonState buttonState = (e.cbutton.type == SDL_CONTROLLERBUTTONDOWN ? Pressed : Released);
-	
-	//They provide a uint8 instead of the actual enum so it needs casting.
-	Button button = (Button)e.cbutton.button;
+	//Buttons past the 32 bit mask aren't tracked
+	if (e.cbutton.button >= 32)
+	{
+		return;
+	}
 
-	assert(buttons.count(button) == 1);
+	uint32_t bit = 1u << e.cbutton.button;
 
-	buttons[button] = buttonState;
+	if (e.cbutton.type == SDL_CONTROLLERBUTTONDOWN)
+	{
+		buttonsCurrent |= bit;
+	}
+	else
+	{
+		buttonsCurrent &= ~bit;
+	}
 }
 
 void Controller::initializeHaptics(SDL_Joystick* joystick)
@@ -197,17 +242,17 @@ void Controller::initializeHaptics(SDL_Joystick* joystick)
 		haptic = SDL_HapticOpenFromJoystick(joystick);
 		if (haptic != nullptr)
 		{
-			Log::logI(this->getName() + "'s haptic features opened successfully");
+			LOG_I(this->getName() + "'s haptic features opened successfully");
 		}
 		else
 		{
-			Log::logW(this->getName() + "'s haptic features could not be opened due to an error: " + SDL_GetError());
+			LOG_W(this->getName() + "'s haptic features could not be opened due to an error: " + SDL_GetError());
 			return;
 		}
 	}
 	else
 	{
-		Log::logI(this->getName() + " does not support haptic features");
+		LOG_I(this->getName() + " does not support haptic features");
 		haptic = nullptr;
 		return;
 	}
@@ -220,13 +265,13 @@ void Controller::initializeHaptics(SDL_Joystick* joystick)
 		break;
 
 	case SDL_FALSE:
-		Log::logI(this->getName() + " does not support the Rumble Haptic");
+		LOG_I(this->getName() + " does not support the Rumble Haptic");
 		rumbleSupported = false;
 		return;
 		break;
 
 	default:
-		Log::logW(this->getName() + 
+		LOG_W(this->getName() + 
 			" had an error occur when querying its support of rumble features: " + SDL_GetError());
 		rumbleSupported = false;
 		return;
@@ -236,7 +281,7 @@ void Controller::initializeHaptics(SDL_Joystick* joystick)
 
 	if (SDL_HapticRumbleInit(haptic) != 0)
 	{
-		Log::logW(this->getName() + " had an error occur when initializing Rumble haptic: "
+		LOG_W(this->getName() + " had an error occur when initializing Rumble haptic: "
 			+ SDL_GetError());
 		rumbleSupported = false;
 		return;
@@ -250,7 +295,7 @@ void Controller::rumblePlay(float strength, uint32_t lengthMS)
 	{
 		if (SDL_HapticRumblePlay(haptic, strength, lengthMS) != 0)
 		{
-			Log::logW(this->getName() + " had an error occur when trying to play a rumble haptic: "
+			LOG_W(this->getName() + " had an error occur when trying to play a rumble haptic: "
 				+ SDL_GetError());
 		}
 	}
@@ -262,7 +307,7 @@ void Controller::rumbleStop()
 	{
 		if (SDL_HapticRumbleStop(haptic) != 0)
 		{
-			Log::logW(this->getName() + " had an error occur when trying to stop a rumble haptic: "
+			LOG_W(this->getName() + " had an error occur when trying to stop a rumble haptic: "
 				+ SDL_GetError());
 		}
 	}
@@ -272,17 +317,5 @@ void Controller::rumbleStop()
 void Controller::update()
 {
 	//Buttons
-	for (auto& button : buttons)
-	{
-		ButtonState buttonState = button.second;
-
-		if (buttonState == Pressed) {
-			button.second = Held;
-		}
-		else if (buttonState == Released) {
-			button.second = None;
-		}
-	}
-
+	buttonsPrevious = buttonsCurrent;
 }
-
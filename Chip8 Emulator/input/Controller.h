@@ -1,8 +1,7 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <functional>
-#include <unordered_map>
 #include <SDL.h>
 
 #include "../misc/Vec2.h"
@@ -40,20 +39,19 @@ public:
 		DPAD_RIGHT = SDL_CONTROLLER_BUTTON_DPAD_RIGHT
 	};
 
+	//A closed slot, open() it when a controller connects
+	Controller();
 
-	//Explanation here: http://www.drdobbs.com/windows/user-defined-hash-functions-for-unordere/231600210?pgno=3
-	// Basically non VS compilers require a hash function for all User Defined types.
-	struct ButtonHash
-	{
-		size_t operator()(const Button button) const
-		{
-			return std::hash<int>()(button);
-		}
-	};
+	~Controller();
 
-	Controller(int joyID);
+	//Not copyable, it owns the SDL controller and haptic handles
+	Controller(const Controller&) = delete;
+	Controller& operator=(const Controller&) = delete;
 
-	~Controller();
+	//Open the controller, closing whatever the slot held first. Returns isValid()
+	bool open(int joyID);
+
+	void close();
 
 	bool isValid();
 
@@ -70,6 +68,9 @@ public:
 
 	bool wasButtonReleased(Button button);
 
+	//Held buttons, bit N for button N
+	uint32_t getButtonsHeld() { return buttonsCurrent; }
+
 	float getAxis1D(Axis1D axis);
 
 	Vec2 getAxis2D(Axis2D axis);
@@ -85,17 +86,6 @@ public:
 	void update();
 private:
 
-	const Sint16 AXIS_MIN = -32768;
-	const Sint16 AXIS_MAX = 32767;
-
-	enum ButtonState {
-		Pressed,
-		Held,
-		Released,
-		None,
-		Unknown
-	};
-
 	void updateAxis(SDL_Event& e);
 
 	void updateButtons(SDL_Event& e);
@@ -106,16 +96,15 @@ private:
 
 	SDL_JoystickID joystickInstanceID;
 
+	//Axis positions in 16.16 fixed point, indexed by SDL_GameControllerAxis.
+	//-1 to 1 for the sticks and 0 to 1 for the triggers.
+	int32_t axes[SDL_CONTROLLER_AXIS_MAX];
 
-	Vec2 leftStick;
-
-	Vec2 rightStick;
-
-	float leftTrigger;
-
-	float rightTrigger;
+	//Buttons down as of the last event, bit N for button N
+	uint32_t buttonsCurrent;
 
-	std::unordered_map<Button, ButtonState, ButtonHash> buttons;
+	//Buttons down as of the last update
+	uint32_t buttonsPrevious;
 
 	//Haptics
 	void initializeHaptics(SDL_Joystick* joystick);
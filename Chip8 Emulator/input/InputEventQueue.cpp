@@ -0,0 +1,86 @@
+#include "InputEventQueue.h"
+
+#include <chrono>
+
+#include "../misc/Log.h"
+
+MPSCQueue<InputEventQueue::TimedEvent> InputEventQueue::queue(QUEUE_CAPACITY);
+bool InputEventQueue::started = false;
+std::atomic<uint64_t> InputEventQueue::dropped(0);
+
+InputEventQueue::InputEventQueue()
+{
+
+}
+
+bool InputEventQueue::start()
+{
+	if (started)
+	{
+		LOG_W("Input event queue already started");
+		return false;
+	}
+
+	started = true;
+	SDL_AddEventWatch(&InputEventQueue::onEvent, nullptr);
+	return true;
+}
+
+void InputEventQueue::stop()
+{
+	if (!started)
+	{
+		return;
+	}
+
+	SDL_DelEventWatch(&InputEventQueue::onEvent, nullptr);
+	started = false;
+
+	if (dropped > 0)
+	{
+		LOG_W("Input event queue dropped " + std::to_string(dropped) + " events");
+	}
+}
+
+bool InputEventQueue::pop(TimedEvent& event)
+{
+	return queue.tryPop(event);
+}
+
+uint64_t InputEventQueue::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int SDLCALL InputEventQueue::onEvent(void*, SDL_Event* event)
+{
+	switch (event->type)
+	{
+	case SDL_KEYDOWN:
+		if (event->key.repeat != 0)
+			return 0;
+		break;
+
+	case SDL_KEYUP:
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP:
+	case SDL_CONTROLLERDEVICEREMOVED:
+		break;
+
+	default:
+		return 0;
+	}
+
+	TimedEvent timedEvent;
+	timedEvent.timestamp = now();
+	timedEvent.event = *event;
+
+	if (!queue.tryPush(std::move(timedEvent)))
+	{
+		dropped++;
+	}
+
+	//The return value of a watch is ignored
+	return 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <SDL.h>
+
+#include "../misc/MPSCQueue.h"
+
+/**
+@brief Timestamps keypad relevant SDL events the moment SDL queues them.
+
+An SDL event watch sees every event as it is pumped, on whichever thread pumps it, so it
+stamps key and controller button events and controller removals with the time they arrived and
+pushes them onto a lock-free queue. The main loop drains the queue once per frame and uses the
+timestamps to place each change at the matching point in the next frame's cycles, rather than
+applying everything at the frame boundary. Key repeats are dropped as they never change the keypad.
+Events are dropped when the queue is full, getDroppedCount() going up tells the main loop to
+resync from polled state.
+*/
+class InputEventQueue
+{
+public:
+	/** @brief An event and when it arrived. */
+	struct TimedEvent
+	{
+		///Nanoseconds on the now() clock
+		uint64_t timestamp;
+		SDL_Event event;
+	};
+
+	/**
+	@brief Start watching for events.
+
+	@return bool - Was successful.
+	*/
+	static bool start();
+
+	/** @brief Stop watching for events. */
+	static void stop();
+
+	/**
+	@brief Pop the oldest queued event. Must only be called from one thread.
+
+	@param [out] event Receives the event.
+
+	@return false if the queue is empty.
+	*/
+	static bool pop(TimedEvent& event);
+
+	/** @brief Nanoseconds on a steady clock, the clock events are stamped with. */
+	static uint64_t now();
+
+	/** @brief Number of events dropped because the queue was full. */
+	static uint64_t getDroppedCount() { return dropped; }
+
+private:
+	InputEventQueue();
+
+	///Events that can wait between drains, anything past it is dropped
+	static const size_t QUEUE_CAPACITY = 1024;
+
+	static MPSCQueue<TimedEvent> queue;
+
+	static bool started;
+
+	static std::atomic<uint64_t> dropped;
+
+	static int SDLCALL onEvent(void* userdata, SDL_Event* event);
+};
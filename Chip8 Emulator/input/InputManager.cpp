@@ -3,254 +3,15 @@
 #include <assert.h>
 
 #include "../misc/Log.h"
+#include "../misc/Utility.h"
 
 //Static Declarations
-std::unordered_map<SDL_Keycode, InputManager::ButtonState> InputManager::keys = {
-	{ SDLK_UNKNOWN, None },
-	{ SDLK_RETURN, None },
-	{ SDLK_ESCAPE, None },
-	{ SDLK_BACKSPACE, None },
-	{ SDLK_TAB, None },
-	{ SDLK_SPACE, None },
-	{ SDLK_EXCLAIM, None },
-	{ SDLK_QUOTEDBL, None },
-	{ SDLK_HASH, None },
-	{ SDLK_PERCENT, None },
-	{ SDLK_DOLLAR, None },
-	{ SDLK_AMPERSAND, None },
-	{ SDLK_QUOTE, None },
-	{ SDLK_LEFTPAREN, None },
-	{ SDLK_RIGHTPAREN, None },
-	{ SDLK_ASTERISK, None },
-	{ SDLK_PLUS, None },
-	{ SDLK_COMMA, None },
-	{ SDLK_MINUS, None },
-	{ SDLK_PERIOD, None },
-	{ SDLK_SLASH, None },
-	{ SDLK_0, None },
-	{ SDLK_1, None },
-	{ SDLK_2, None },
-	{ SDLK_3, None },
-	{ SDLK_4, None },
-	{ SDLK_5, None },
-	{ SDLK_6, None },
-	{ SDLK_7, None },
-	{ SDLK_8, None },
-	{ SDLK_9, None },
-	{ SDLK_COLON, None },
-	{ SDLK_SEMICOLON, None },
-	{ SDLK_LESS, None },
-	{ SDLK_EQUALS, None },
-	{ SDLK_GREATER, None },
-	{ SDLK_QUESTION, None },
-	{ SDLK_AT, None },
-	{ SDLK_LEFTBRACKET, None },
-	{ SDLK_BACKSLASH, None },
-	{ SDLK_RIGHTBRACKET, None },
-	{ SDLK_CARET, None },
-	{ SDLK_UNDERSCORE, None },
-	{ SDLK_BACKQUOTE, None },
-	{ SDLK_a, None },
-	{ SDLK_b, None },
-	{ SDLK_c, None },
-	{ SDLK_d, None },
-	{ SDLK_e, None },
-	{ SDLK_f, None },
-	{ SDLK_g, None },
-	{ SDLK_h, None },
-	{ SDLK_i, None },
-	{ SDLK_j, None },
-	{ SDLK_k, None },
-	{ SDLK_l, None },
-	{ SDLK_m, None },
-	{ SDLK_n, None },
-	{ SDLK_o, None },
-	{ SDLK_p, None },
-	{ SDLK_q, None },
-	{ SDLK_r, None },
-	{ SDLK_s, None },
-	{ SDLK_t, None },
-	{ SDLK_u, None },
-	{ SDLK_v, None },
-	{ SDLK_w, None },
-	{ SDLK_x, None },
-	{ SDLK_y, None },
-	{ SDLK_z, None },
-	{ SDLK_CAPSLOCK, None },
-	{ SDLK_F1, None },
-	{ SDLK_F2, None },
-	{ SDLK_F3, None },
-	{ SDLK_F4, None },
-	{ SDLK_F5, None },
-	{ SDLK_F6, None },
-	{ SDLK_F7, None },
-	{ SDLK_F8, None },
-	{ SDLK_F9, None },
-	{ SDLK_F10, None },
-	{ SDLK_F11, None },
-	{ SDLK_F12, None },
-	{ SDLK_PRINTSCREEN, None },
-	{ SDLK_SCROLLLOCK, None },
-	{ SDLK_PAUSE, None },
-	{ SDLK_INSERT, None },
-	{ SDLK_HOME, None },
-	{ SDLK_PAGEUP, None },
-	{ SDLK_DELETE, None },
-	{ SDLK_END, None },
-	{ SDLK_PAGEDOWN, None },
-	{ SDLK_RIGHT, None },
-	{ SDLK_LEFT, None },
-	{ SDLK_DOWN, None },
-	{ SDLK_UP, None },
-	{ SDLK_NUMLOCKCLEAR, None },
-	{ SDLK_KP_DIVIDE, None },
-	{ SDLK_KP_MULTIPLY, None },
-	{ SDLK_KP_MINUS, None },
-	{ SDLK_KP_PLUS, None },
-	{ SDLK_KP_ENTER, None },
-	{ SDLK_KP_1, None },
-	{ SDLK_KP_2, None },
-	{ SDLK_KP_3, None },
-	{ SDLK_KP_4, None },
-	{ SDLK_KP_5, None },
-	{ SDLK_KP_6, None },
-	{ SDLK_KP_7, None },
-	{ SDLK_KP_8, None },
-	{ SDLK_KP_9, None },
-	{ SDLK_KP_0, None },
-	{ SDLK_KP_PERIOD, None },
-	{ SDLK_APPLICATION, None },
-	{ SDLK_POWER, None },
-	{ SDLK_KP_EQUALS, None },
-	{ SDLK_F13, None },
-	{ SDLK_F14, None },
-	{ SDLK_F15, None },
-	{ SDLK_F16, None },
-	{ SDLK_F17, None },
-	{ SDLK_F18, None },
-	{ SDLK_F19, None },
-	{ SDLK_F20, None },
-	{ SDLK_F21, None },
-	{ SDLK_F22, None },
-	{ SDLK_F23, None },
-	{ SDLK_F24, None },
-	{ SDLK_EXECUTE, None },
-	{ SDLK_HELP, None },
-	{ SDLK_MENU, None },
-	{ SDLK_SELECT, None },
-	{ SDLK_STOP, None },
-	{ SDLK_AGAIN, None },
-	{ SDLK_UNDO, None },
-	{ SDLK_CUT, None },
-	{ SDLK_COPY, None },
-	{ SDLK_PASTE, None },
-	{ SDLK_FIND, None },
-	{ SDLK_MUTE, None },
-	{ SDLK_VOLUMEUP, None },
-	{ SDLK_VOLUMEDOWN, None },
-	{ SDLK_KP_COMMA, None },
-	{ SDLK_KP_EQUALSAS400, None },
-	{ SDLK_ALTERASE, None },
-	{ SDLK_SYSREQ, None },
-	{ SDLK_CANCEL, None },
-	{ SDLK_CLEAR, None },
-	{ SDLK_PRIOR, None },
-	{ SDLK_RETURN2, None },
-	{ SDLK_SEPARATOR, None },
-	{ SDLK_OUT, None },
-	{ SDLK_OPER, None },
-	{ SDLK_CLEARAGAIN, None },
-	{ SDLK_CRSEL, None },
-	{ SDLK_EXSEL, None },
-	{ SDLK_KP_00, None },
-	{ SDLK_KP_000, None },
-	{ SDLK_THOUSANDSSEPARATOR, None },
-	{ SDLK_DECIMALSEPARATOR, None },
-	{ SDLK_CURRENCYUNIT, None },
-	{ SDLK_CURRENCYSUBUNIT, None },
-	{ SDLK_KP_LEFTPAREN, None },
-	{ SDLK_KP_RIGHTPAREN, None },
-	{ SDLK_KP_LEFTBRACE, None },
-	{ SDLK_KP_RIGHTBRACE, None },
-	{ SDLK_KP_TAB, None },
-	{ SDLK_KP_BACKSPACE, None },
-	{ SDLK_KP_A, None },
-	{ SDLK_KP_B, None },
-	{ SDLK_KP_C, None },
-	{ SDLK_KP_D, None },
-	{ SDLK_KP_E, None },
-	{ SDLK_KP_F, None },
-	{ SDLK_KP_XOR, None },
-	{ SDLK_KP_POWER, None },
-	{ SDLK_KP_PERCENT, None },
-	{ SDLK_KP_LESS, None },
-	{ SDLK_KP_GREATER, None },
-	{ SDLK_KP_AMPERSAND, None },
-	{ SDLK_KP_DBLAMPERSAND, None },
-	{ SDLK_KP_VERTICALBAR, None },
-	{ SDLK_KP_DBLVERTICALBAR, None },
-	{ SDLK_KP_COLON, None },
-	{ SDLK_KP_HASH, None },
-	{ SDLK_KP_SPACE, None },
-	{ SDLK_KP_AT, None },
-	{ SDLK_KP_EXCLAM, None },
-	{ SDLK_KP_MEMSTORE, None },
-	{ SDLK_KP_MEMRECALL, None },
-	{ SDLK_KP_MEMCLEAR, None },
-	{ SDLK_KP_MEMADD, None },
-	{ SDLK_KP_MEMSUBTRACT, None },
-	{ SDLK_KP_MEMMULTIPLY, None },
-	{ SDLK_KP_MEMDIVIDE, None },
-	{ SDLK_KP_PLUSMINUS, None },
-	{ SDLK_KP_CLEAR, None },
-	{ SDLK_KP_CLEARENTRY, None },
-	{ SDLK_KP_BINARY, None },
-	{ SDLK_KP_OCTAL, None },
-	{ SDLK_KP_DECIMAL, None },
-	{ SDLK_KP_HEXADECIMAL, None },
-	{ SDLK_LCTRL, None },
-	{ SDLK_LSHIFT, None },
-	{ SDLK_LALT, None },
-	{ SDLK_LGUI, None },
-	{ SDLK_RCTRL, None },
-	{ SDLK_RSHIFT, None },
-	{ SDLK_RALT, None },
-	{ SDLK_RGUI, None },
-	{ SDLK_MODE, None },
-	{ SDLK_AUDIONEXT, None },
-	{ SDLK_AUDIOPREV, None },
-	{ SDLK_AUDIOSTOP, None },
-	{ SDLK_AUDIOPLAY, None },
-	{ SDLK_AUDIOMUTE, None },
-	{ SDLK_MEDIASELECT, None },
-	{ SDLK_WWW, None },
-	{ SDLK_MAIL, None },
-	{ SDLK_CALCULATOR, None },
-	{ SDLK_COMPUTER, None },
-	{ SDLK_AC_SEARCH, None },
-	{ SDLK_AC_HOME, None },
-	{ SDLK_AC_BACK, None },
-	{ SDLK_AC_FORWARD, None },
-	{ SDLK_AC_STOP, None },
-	{ SDLK_AC_REFRESH, None },
-	{ SDLK_AC_BOOKMARKS, None },
-	{ SDLK_BRIGHTNESSDOWN, None },
-	{ SDLK_BRIGHTNESSUP, None },
-	{ SDLK_DISPLAYSWITCH, None },
-	{ SDLK_KBDILLUMTOGGLE, None },
-	{ SDLK_KBDILLUMDOWN, None },
-	{ SDLK_KBDILLUMUP, None },
-	{ SDLK_EJECT, None },
-	{ SDLK_SLEEP, None },
-};
-std::unordered_map<int, InputManager::ButtonState> InputManager::mouseButtons = {
-	{ SDL_BUTTON_LEFT, None },
-	{ SDL_BUTTON_MIDDLE, None },
-	{ SDL_BUTTON_RIGHT, None },
-	{ SDL_BUTTON_X1, None },
-	{ SDL_BUTTON_X2, None }
-};
-std::vector<Controller*> InputManager::gamepads;
+uint64_t InputManager::keysCurrent[KEY_WORDS] = {};
+uint64_t InputManager::keysPrevious[KEY_WORDS] = {};
+uint32_t InputManager::changedKeyWords = 0;
+uint8_t InputManager::mouseButtonsCurrent = 0;
+uint8_t InputManager::mouseButtonsPrevious = 0;
+Controller InputManager::gamepads[MAX_GAMEPADS];
 Vec2 InputManager::mousePos;
 Vec2 InputManager::mouseDirection;
 Vec2 InputManager::mouseWheelDirection;
@@ -264,76 +25,86 @@ InputManager::InputManager()
 
 void InputManager::cleanup()
 {
-	keys.clear();
-	mouseButtons.clear();
-
-	for (auto& gamepad : gamepads)
+	for (int word = 0; word < KEY_WORDS; word++)
 	{
-		delete gamepad;
+		keysCurrent[word] = 0;
+		keysPrevious[word] = 0;
 	}
 
-	gamepads.clear();
+	changedKeyWords = 0;
+	mouseButtonsCurrent = 0;
+	mouseButtonsPrevious = 0;
+
+	for (Controller& gamepad : gamepads)
+	{
+		gamepad.close();
+	}
 }
 
 //Keyboard
-bool InputManager::wasKeyPressed(SDL_Keycode key)
+bool InputManager::wasKeyPressed(SDL_Scancode key)
 {
-	assert(keys.count(key) == 1);
+	assert(key >= 0 && key < SDL_NUM_SCANCODES);
 
-	return (keys[key] == Pressed);
+	return ((keysCurrent[key >> 6] & ~keysPrevious[key >> 6]) >> (key & 63)) & 1;
 }
 
-bool InputManager::isKeyHeld(SDL_Keycode key)
+bool InputManager::isKeyHeld(SDL_Scancode key)
 {
-	assert(keys.count(key) == 1);
+	assert(key >= 0 && key < SDL_NUM_SCANCODES);
 
-	return (keys[key] == Pressed || keys[key] == Held);
+	return (keysCurrent[key >> 6] >> (key & 63)) & 1;
 }
 
-bool InputManager::wasKeyReleased(SDL_Keycode key)
+bool InputManager::wasKeyReleased(SDL_Scancode key)
 {
-	assert(keys.count(key) == 1);
+	assert(key >= 0 && key < SDL_NUM_SCANCODES);
+
+	return ((~keysCurrent[key >> 6] & keysPrevious[key >> 6]) >> (key & 63)) & 1;
+}
 
-	return (keys[key] == Released);;
+const uint64_t* InputManager::getKeysHeld()
+{
+	return keysCurrent;
 }
 
 //Quick shortcuts
 bool InputManager::ctrl()
 {
-	return (isKeyHeld(SDLK_LCTRL) || isKeyHeld(SDLK_RCTRL));
+	return (isKeyHeld(SDL_SCANCODE_LCTRL) || isKeyHeld(SDL_SCANCODE_RCTRL));
 }
 
 bool InputManager::alt()
 {
-	return (isKeyHeld(SDLK_LALT) || isKeyHeld(SDLK_RALT));
+	return (isKeyHeld(SDL_SCANCODE_LALT) || isKeyHeld(SDL_SCANCODE_RALT));
 }
 
 bool InputManager::shift()
 {
-	return (isKeyHeld(SDLK_LSHIFT) || isKeyHeld(SDLK_RSHIFT));
+	return (isKeyHeld(SDL_SCANCODE_LSHIFT) || isKeyHeld(SDL_SCANCODE_RSHIFT));
 }
 
 
 //Mouse
 bool InputManager::wasMouseButtonPressed(uint8_t button)
 {
-	assert(mouseButtons.count(button) == 1);
+	assert(button >= SDL_BUTTON_LEFT && button <= SDL_BUTTON_X2);
 
-	return (mouseButtons[button] == Pressed);
+	return ((mouseButtonsCurrent & ~mouseButtonsPrevious) >> (button - 1)) & 1;
 }
 
 bool InputManager::isMouseButtonHeld(uint8_t button)
 {
-	assert(mouseButtons.count(button) == 1);
+	assert(button >= SDL_BUTTON_LEFT && button <= SDL_BUTTON_X2);
 
-	return (mouseButtons[button] == Pressed || mouseButtons[button] == Held);
+	return (mouseButtonsCurrent >> (button - 1)) & 1;
 }
 
 bool InputManager::wasMouseButtonReleased(uint8_t button)
 {
-	assert(mouseButtons.count(button) == 1);
+	assert(button >= SDL_BUTTON_LEFT && button <= SDL_BUTTON_X2);
 
-	return (mouseButtons[button] == Released);;
+	return ((~mouseButtonsCurrent & mouseButtonsPrevious) >> (button - 1)) & 1;
 }
 
 //Mouse Vectors
@@ -351,17 +122,14 @@ void InputManager::checkForActiveControllers()
 	{
 		if (SDL_IsGameController(curJoy))
 		{
+			int freeSlot = findFreeSlot();
 
-			gamepads.push_back(new Controller(curJoy));
-			if (gamepads.back()->isValid())
+			if (freeSlot == -1)
 			{
-				Log::logI(gamepads.back()->getName() + " Connected.");
-			}
-			else
-			{
-				delete gamepads.back();
-				gamepads.pop_back();
+				return;
 			}
+
+			addNewController(curJoy, freeSlot);
 		}
 	}
 }
@@ -370,62 +138,85 @@ bool InputManager::wasControllerButtonPressed(int controller, Controller::Button
 {
 	if (!isGamepadValid(controller))
 	{
-		//Log::logW("Invalid Gamepad requested");
+		//LOG_W("Invalid Gamepad requested");
 		return false;
 	}
 
-	return gamepads[controller]->wasButtonPressed(button);
+	return gamepads[controller].wasButtonPressed(button);
 }
 
 bool InputManager::isControllerButtonHeld(int controller, Controller::Button button)
 {
 	if (!isGamepadValid(controller))
 	{
-		//Log::logW("Invalid Gamepad requested");
+		//LOG_W("Invalid Gamepad requested");
 		return false;
 	}
 
-	return gamepads[controller]->isButtonHeld(button);
+	return gamepads[controller].isButtonHeld(button);
+}
+
+uint32_t InputManager::getControllerButtonsHeld(int controller)
+{
+	if (!isGamepadValid(controller))
+	{
+		return 0;
+	}
+
+	return gamepads[controller].getButtonsHeld();
+}
+
+int InputManager::getControllerIndex(SDL_JoystickID instanceID)
+{
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
+	{
+		if (isGamepadValid(curPad) && gamepads[curPad].getJoystickInstanceID() == instanceID)
+		{
+			return curPad;
+		}
+	}
+
+	return -1;
 }
 
 bool InputManager::wasControllerButtonReleased(int controller, Controller::Button button)
 {
 	if (!isGamepadValid(controller))
 	{
-		//Log::logW("Invalid Gamepad requested");
+		//LOG_W("Invalid Gamepad requested");
 		return false;
 	}
 
-	return gamepads[controller]->wasButtonReleased(button);
+	return gamepads[controller].wasButtonReleased(button);
 }
 
 float InputManager::getControllerAxis1D(int controller, Controller::Axis1D axis)
 {
 	if (!isGamepadValid(controller))
 	{
-		//Log::logW("Invalid Gamepad requested");
+		//LOG_W("Invalid Gamepad requested");
 		return 0.0f;
 	}
 
-	return gamepads[controller]->getAxis1D(axis);
+	return gamepads[controller].getAxis1D(axis);
 }
 
 Vec2 InputManager::getControllerAxis2D(int controller, Controller::Axis2D axis)
 {
 	if (!isGamepadValid(controller))
 	{
-		//Log::logW("Invalid Gamepad requested");
+		//LOG_W("Invalid Gamepad requested");
 		return Vec2(0.0f);
 	}
 
-	return gamepads[controller]->getAxis2D(axis);
+	return gamepads[controller].getAxis2D(axis);
 }
 
 void InputManager::playControllerRumble(int controller, float strength, uint32_t lengthMS)
 {
 	if (isGamepadValid(controller))
 	{
-		gamepads[controller]->rumblePlay(strength, lengthMS);
+		gamepads[controller].rumblePlay(strength, lengthMS);
 	}
 }
 
@@ -433,7 +224,7 @@ void InputManager::stopControllerRumble(int controller)
 {
 	if (isGamepadValid(controller))
 	{
-		gamepads[controller]->rumbleStop();
+		gamepads[controller].rumbleStop();
 	}
 }
 
@@ -441,7 +232,7 @@ uint8_t InputManager::getNumControllers()
 {
 	uint8_t controllers = 0;
 
-	for (unsigned int curPad = 0; curPad < gamepads.size(); curPad++)
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 	{
 		if (isGamepadValid(curPad))
 		{
@@ -469,37 +260,36 @@ void InputManager::setDeadZone(float newDeadzone)
 //Event Processing
 void InputManager::processKeyEvent(SDL_Event& e)
 {
-	ButtonState eventType = Unknown;
+	assert(e.type == SDL_KEYDOWN || e.type == SDL_KEYUP);
 
-	switch (e.key.type)
+	int scancode = e.key.keysym.scancode;
+
+	if (scancode < 0 || scancode >= SDL_NUM_SCANCODES)
 	{
-	case SDL_KEYDOWN:
-		eventType = Pressed;
-		break;
-	case SDL_KEYUP:
-		eventType = Released;
-		break;
+		return;
 	}
 
-	assert(eventType != Unknown);
+	int word = scancode >> 6;
+	uint64_t bit = (uint64_t)1 << (scancode & 63);
 
-	assert(keys.count(e.key.keysym.sym) == 1);
+	if (e.type == SDL_KEYDOWN)
+	{
+		keysCurrent[word] |= bit;
+	}
+	else
+	{
+		keysCurrent[word] &= ~bit;
+	}
 
-	keys[e.key.keysym.sym] = eventType;
+	changedKeyWords |= 1u << word;
 }
 
 void InputManager::processMouseEvent(SDL_Event& e)
 {
-	ButtonState buttonState = Unknown;
-
 	switch (e.type)
 	{
 	case SDL_MOUSEBUTTONDOWN:
-		buttonState = Pressed;
-		break;
-
 	case SDL_MOUSEBUTTONUP:
-		buttonState = Released;
 		break;
 
 	case SDL_MOUSEMOTION:
@@ -514,16 +304,28 @@ void InputManager::processMouseEvent(SDL_Event& e)
 		break;
 
 	default:
-		Log::logE("Unhandled event passed through to processMouseEvent");
+		LOG_E("Unhandled event passed through to processMouseEvent");
 		assert(false);
+		return;
 		break;
 	}
 
-	assert(buttonState != Unknown);
+	//Buttons past X2 aren't tracked
+	if (e.button.button < SDL_BUTTON_LEFT || e.button.button > SDL_BUTTON_X2)
+	{
+		return;
+	}
 
-	assert(mouseButtons.count(e.button.button) == 1);
+	uint8_t bit = (uint8_t)(1 << (e.button.button - 1));
 
-	mouseButtons[e.button.button] = buttonState;
+	if (e.type == SDL_MOUSEBUTTONDOWN)
+	{
+		mouseButtonsCurrent |= bit;
+	}
+	else
+	{
+		mouseButtonsCurrent &= ~bit;
+	}
 }
 
 void InputManager::processGameControllerEvent(SDL_Event& e)
@@ -536,12 +338,12 @@ void InputManager::processGameControllerEvent(SDL_Event& e)
 	case SDL_CONTROLLERBUTTONDOWN:
 	case SDL_CONTROLLERBUTTONUP:
 
-		for (unsigned int curPad = 0; curPad < gamepads.size(); curPad++)
+		for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 		{
 			if (isGamepadValid(curPad) &&
-				gamepads[curPad]->getJoystickInstanceID() == (SDL_JoystickID)joyInstanceID)
+				gamepads[curPad].getJoystickInstanceID() == (SDL_JoystickID)joyInstanceID)
 			{
-				gamepads[curPad]->processEvents(e);
+				gamepads[curPad].processEvents(e);
 			}
 		}
 
@@ -560,41 +362,26 @@ void InputManager::processGameControllerEvent(SDL_Event& e)
 
 void InputManager::update()
 {
-	//Keyboard
-	for (auto& key : keys)
+	//Keyboard, only the words that saw an event need bringing up to date
+	while (changedKeyWords != 0)
 	{
-		ButtonState keyState = key.second;
-
-		if (keyState == Pressed) {
-			key.second = Held;
-		}
-		else if (keyState == Released) {
-			key.second = None;
-		}
+		int word = Utility::lowestSetBit(changedKeyWords);
+		keysPrevious[word] = keysCurrent[word];
+		changedKeyWords &= changedKeyWords - 1;
 	}
 
 	//Mouse
-	for (auto& button : mouseButtons)
-	{
-		ButtonState buttonState = button.second;
-
-		if (buttonState == Pressed) {
-			button.second = Held;
-		}
-		else if (buttonState == Released) {
-			button.second = None;
-		}
-	}
+	mouseButtonsPrevious = mouseButtonsCurrent;
 
 	mouseDirection = { 0 };
 	mouseWheelDirection = { 0 };
 
 	//Gamepads
-	for (unsigned int curPad = 0; curPad < gamepads.size(); curPad++)
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 	{
 		if (isGamepadValid(curPad))
 		{
-			gamepads[curPad]->update();
+			gamepads[curPad].update();
 		}
 	}
 
@@ -604,25 +391,25 @@ void InputManager::printDebugInfo()
 {
 	//Mouse Tests
 	if (InputManager::wasMouseButtonPressed(SDL_BUTTON_LEFT)) {
-		Log::logI("Mouse Pos: " + InputManager::getMousePos().convertToString());
+		LOG_I("Mouse Pos: " + InputManager::getMousePos().convertToString());
 	}
 	if (InputManager::wasMouseButtonPressed(SDL_BUTTON_MIDDLE)) {
-		Log::logI("Mouse Dir: " + InputManager::getMouseDirection().convertToString());
+		LOG_I("Mouse Dir: " + InputManager::getMouseDirection().convertToString());
 	}
 	if (InputManager::wasMouseButtonPressed(SDL_BUTTON_RIGHT)) {
-		Log::logI("Mouse wheel: " + InputManager::getMouseWheelDirection().convertToString());
+		LOG_I("Mouse wheel: " + InputManager::getMouseWheelDirection().convertToString());
 	}
 
 	//Controller Tests
 	if (InputManager::wasControllerButtonPressed(0, Controller::A))
 	{
-		Log::logI("LeftAxis: " +
+		LOG_I("LeftAxis: " +
 			InputManager::getControllerAxis2D(0, Controller::LeftStick).convertToString());
-		Log::logI("RightAxis: " +
+		LOG_I("RightAxis: " +
 			InputManager::getControllerAxis2D(0, Controller::RightStick).convertToString());
-		Log::logI("LeftTrigger: " +
+		LOG_I("LeftTrigger: " +
 			std::to_string(InputManager::getControllerAxis1D(0, Controller::LeftTrigger)));
-		Log::logI("RightTrigger: " +
+		LOG_I("RightTrigger: " +
 			std::to_string(InputManager::getControllerAxis1D(0, Controller::RightTrigger)));
 	}
 
@@ -636,9 +423,8 @@ void InputManager::printDebugInfo()
 
 bool InputManager::isGamepadValid(int controller)
 {
-	return (controller < (int)gamepads.size() &&
-		gamepads[controller] != nullptr &&
-		gamepads[controller]->isValid()
+	return (controller >= 0 && controller < (int)MAX_GAMEPADS &&
+		gamepads[controller].isValid()
 		);
 }
 
@@ -675,75 +461,54 @@ void InputManager::addController(SDL_Event& e)
 {
 	//Check if not already added by joystickID (Not instance ID).
 	int joystickID = e.cdevice.which;
-	int firstFreeJoy = -1;
 
-	for (unsigned int curJoy = 0; curJoy < gamepads.size(); curJoy++)
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 	{
-		if (isGamepadValid(curJoy))
-		{
-			if (gamepads[curJoy]->getJoystickID() == joystickID)
-			{
-				return;
-			}
-		}
-		else
+		if (isGamepadValid(curPad) && gamepads[curPad].getJoystickID() == joystickID)
 		{
-			//Only set this variable if it hasn't been set already
-			firstFreeJoy = (firstFreeJoy == -1 ? curJoy : firstFreeJoy);
+			return;
 		}
 	}
 
+	//Nothing to do if every slot is taken
+	int freeSlot = findFreeSlot();
 
-	//If no old controllers to replace create a new one if we haven't reached the max
-	if (gamepads.size() < MAX_GAMEPADS)
+	if (freeSlot != -1)
 	{
-		addNewController(joystickID, firstFreeJoy);
+		addNewController(joystickID, freeSlot);
 	}
-
 }
 
-void InputManager::addNewController(int joystickID, int arrayPos)
+int InputManager::findFreeSlot()
 {
-	if (SDL_IsGameController(joystickID))
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 	{
-
-		if (arrayPos == -1)
+		if (!isGamepadValid(curPad))
 		{
-			gamepads.push_back(new Controller(joystickID));
-			arrayPos = gamepads.size() - 1;
-		}
-		else
-		{
-			if (gamepads[arrayPos] != nullptr)
-			{
-				delete gamepads[arrayPos];
-			}
-
-			gamepads[arrayPos] = new Controller(joystickID);
+			return curPad;
 		}
+	}
 
+	return -1;
+}
 
-		if (gamepads[arrayPos]->isValid())
-		{
-			Log::logI(gamepads[arrayPos]->getName() + " Connected.");
-		}
-		else
-		{
-			delete gamepads[arrayPos];
-		}
+void InputManager::addNewController(int joystickID, int slot)
+{
+	if (SDL_IsGameController(joystickID) && gamepads[slot].open(joystickID))
+	{
+		LOG_I(gamepads[slot].getName() + " Connected.");
 	}
 }
 
 void InputManager::removeController(SDL_Event& e)
 {
-	for (unsigned int curPad = 0; curPad < gamepads.size(); curPad++)
+	for (unsigned int curPad = 0; curPad < MAX_GAMEPADS; curPad++)
 	{
 		if (isGamepadValid(curPad) &&
-			gamepads[curPad]->getJoystickInstanceID() == (SDL_JoystickID)e.cdevice.which)
+			gamepads[curPad].getJoystickInstanceID() == (SDL_JoystickID)e.cdevice.which)
 		{
-			Log::logI(gamepads[curPad]->getName() + " Disconnected");
-			delete gamepads[curPad];
-			gamepads[curPad] = nullptr;
+			LOG_I(gamepads[curPad].getName() + " Disconnected");
+			gamepads[curPad].close();
 		}
 	}
 }
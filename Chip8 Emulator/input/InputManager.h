@@ -1,7 +1,6 @@
 #pragma once
 
-#include <vector>
-#include <unordered_map>
+#include <cstdint>
 #include <SDL.h>
 
 #include "../misc/Vec2.h"
@@ -11,6 +10,13 @@
 class InputManager
 {
 public:
+	/** @brief	Number of 64 bit words needed for one bit per scancode. */
+	static const int KEY_WORDS = (SDL_NUM_SCANCODES + 63) / 64;
+	static_assert(KEY_WORDS <= 32, "changedKeyWords needs a bit per word");
+
+	/** @brief	The maximum number of gamepads that can be handled. */
+	static const unsigned int MAX_GAMEPADS = 4;
+
 	/** @brief	Clean up memory used by Input Manager */
 	static void cleanup();
 
@@ -19,29 +25,36 @@ public:
 	/**
 	@brief	Was the specified key pressed.
 
-	@param	key	The key code.
+	@param	key	The key's scancode.
 
 	@return	true if pressed, false if not.
 	*/
-	static bool wasKeyPressed(SDL_Keycode key);
+	static bool wasKeyPressed(SDL_Scancode key);
 
 	/**
 	@brief	Is the specified key held.
 
-	@param	key	The key code.
+	@param	key	The key's scancode.
 
 	@return	true if held, false if not.
 	*/
-	static bool isKeyHeld(SDL_Keycode key);
+	static bool isKeyHeld(SDL_Scancode key);
 
 	/**
 	@brief	Was the specified key released.
 
-	@param	key	The key code.
+	@param	key	The key's scancode.
 
 	@return	true if released, false if not.
 	*/
-	static bool wasKeyReleased(SDL_Keycode key);
+	static bool wasKeyReleased(SDL_Scancode key);
+
+	/**
+	@brief	Every held key at once, for mapping many keys without a call per key.
+
+	@return	KEY_WORDS words, bit (scancode & 63) of word (scancode >> 6) set if held.
+	*/
+	static const uint64_t* getKeysHeld();
 
 
 	//Quick Shortcuts.
@@ -151,6 +164,24 @@ public:
 	*/
 	static bool isControllerButtonHeld(int controller, Controller::Button button);
 
+	/**
+	@brief	Every held button on the specified controller at once.
+
+	@param	controller	The controller index.
+
+	@return	Bit N set if button N is held, 0 if the controller doesn't exist.
+	*/
+	static uint32_t getControllerButtonsHeld(int controller);
+
+	/**
+	@brief	Finds the controller index an event's joystick instance is open in.
+
+	@param	instanceID	The joystick instance identifier, as carried by controller events.
+
+	@return	The controller index, -1 if no open controller has that instance.
+	*/
+	static int getControllerIndex(SDL_JoystickID instanceID);
+
 	/**
 	@brief	Was the specified controller button released.
 
@@ -241,30 +272,26 @@ public:
 
 private:
 
-	/** @brief	Values that represent all the possible button states for a controller. */
-	enum ButtonState {
-		Pressed,  ///< Button was pressed this frame
-		Held,     ///< Button is held
-		Released, ///< Button was release this frame
-		None,     ///< Button has no active state
-		Unknown   ///< An unknown button that can't be used
-	};
+	/**
+	@brief	Keys down as of the last event, one bit per scancode.
+	Pressed, held and released all come from comparing this with keysPrevious.
+	*/
+	static uint64_t keysCurrent[KEY_WORDS];
 
-	/** @brief	Map of keys and their states. */
-	static std::unordered_map<SDL_Keycode, ButtonState> keys;
+	/** @brief	Keys down as of the last update. */
+	static uint64_t keysPrevious[KEY_WORDS];
 
-	/** @brief	Map of mouse buttons and their states. */
-	static std::unordered_map<int, ButtonState> mouseButtons;
+	/** @brief	Bit per word of keysCurrent changed since the last update, so update only copies those. */
+	static uint32_t changedKeyWords;
 
-	/**
-	@brief Vector containing all initialised controllers
+	/** @brief	Mouse buttons down as of the last event, bit (button - 1) per SDL_BUTTON_*. */
+	static uint8_t mouseButtonsCurrent;
 
-	@todo Possibly switch to standard array.
-	*/
-	static std::vector<Controller*> gamepads;
+	/** @brief	Mouse buttons down as of the last update. */
+	static uint8_t mouseButtonsPrevious;
 
-	/** @brief	The maximum number of gamepads that can be handled. */
-	static const unsigned int MAX_GAMEPADS = 4;
+	/** @brief	A slot per controller, reused as controllers come and go so hotplugging never allocates. */
+	static Controller gamepads[MAX_GAMEPADS];
 
 	static float deadzone;
 
@@ -317,12 +344,19 @@ private:
 	static void addController(SDL_Event& e);
 
 	/**
-	@brief	Adds a new controller to the internal arrays.
+	@brief	Finds a slot without an open controller.
+
+	@return	The slot index, -1 if every slot is in use.
+	*/
+	static int findFreeSlot();
+
+	/**
+	@brief	Opens a controller in a free slot.
 
 	@param	joystickID	Identifier for the joystick.
-	@param	arrayPos  	The array position.
+	@param	slot      	The slot to open it in.
 	*/
-	static void addNewController(int joystickID, int arrayPos);
+	static void addNewController(int joystickID, int slot);
 
 	/**
 	@brief	Called when a controller is no longer detected.
@@ -0,0 +1,274 @@
+#include "KeypadMap.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "../misc/Log.h"
+#include "../misc/Utility.h"
+
+uint16_t KeypadMap::scancodeKeypad[SDL_NUM_SCANCODES] = {};
+uint64_t KeypadMap::boundScancodes[InputManager::KEY_WORDS] = {};
+uint16_t KeypadMap::buttonKeypad[SDL_CONTROLLER_BUTTON_MAX] = {};
+uint32_t KeypadMap::boundButtons = 0;
+uint64_t KeypadMap::eventKeysDown[InputManager::KEY_WORDS] = {};
+uint32_t KeypadMap::eventButtonsHeld[InputManager::MAX_GAMEPADS] = {};
+
+static_assert(SDL_CONTROLLER_BUTTON_MAX <= 32, "boundButtons needs a bit per button");
+
+KeypadMap::KeypadMap()
+{
+
+}
+
+void KeypadMap::setDefaults()
+{
+	// Keyboard layout
+	// 1 2 3 4
+	// Q W E R
+	// A S D F
+	// Z X C V
+	const SDL_Scancode keyboardLayout[16] = {
+		SDL_SCANCODE_X,
+		SDL_SCANCODE_1,
+		SDL_SCANCODE_2,
+		SDL_SCANCODE_3,
+		SDL_SCANCODE_Q,
+		SDL_SCANCODE_W,
+		SDL_SCANCODE_E,
+		SDL_SCANCODE_A,
+		SDL_SCANCODE_S,
+		SDL_SCANCODE_D,
+		SDL_SCANCODE_Z,
+		SDL_SCANCODE_C,
+		SDL_SCANCODE_4,
+		SDL_SCANCODE_R,
+		SDL_SCANCODE_F,
+		SDL_SCANCODE_V
+	};
+
+	clear();
+
+	for (int key = 0; key < 16; key++)
+	{
+		bindKey(key, keyboardLayout[key]);
+	}
+
+	//Most games move with 2/4/6/8 and act with 5
+	bindButton(0x2, SDL_CONTROLLER_BUTTON_DPAD_UP);
+	bindButton(0x4, SDL_CONTROLLER_BUTTON_DPAD_LEFT);
+	bindButton(0x6, SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
+	bindButton(0x8, SDL_CONTROLLER_BUTTON_DPAD_DOWN);
+	bindButton(0x5, SDL_CONTROLLER_BUTTON_A);
+}
+
+bool KeypadMap::load(const std::string& path)
+{
+	std::ifstream file(path);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not open keypad map: " + path);
+		return false;
+	}
+
+	clear();
+
+	std::string line;
+	int lineNumber = 0;
+	int bindings = 0;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		//keypad source name, the name is last as scancode names can contain spaces
+		std::istringstream fields(line);
+		std::string keyText, source, name;
+
+		fields >> keyText >> source >> std::ws;
+		std::getline(fields, name);
+
+		while (!name.empty() && (name.back() == '\r' || name.back() == ' ' || name.back() == '\t'))
+		{
+			name.pop_back();
+		}
+
+		char* keyEnd = nullptr;
+		long keypadKey = strtol(keyText.c_str(), &keyEnd, 16);
+
+		if (keyText.size() != 1 || *keyEnd != '\0' || name.empty())
+		{
+			LOG_W("Skipping malformed keypad map line " + std::to_string(lineNumber) + " in " + path);
+			continue;
+		}
+
+		bool bound = false;
+
+		if (source == "key")
+		{
+			bound = bindKey((int)keypadKey, SDL_GetScancodeFromName(name.c_str()));
+		}
+		else if (source == "button")
+		{
+			bound = bindButton((int)keypadKey, SDL_GameControllerGetButtonFromString(name.c_str()));
+		}
+
+		if (!bound)
+		{
+			LOG_W("Skipping keypad map line " + std::to_string(lineNumber) + " with an unknown key or button: " + name);
+			continue;
+		}
+
+		bindings++;
+	}
+
+	LOG_I("Loaded " + std::to_string(bindings) + " keypad bindings from: " + path);
+	return true;
+}
+
+void KeypadMap::clear()
+{
+	for (int scancode = 0; scancode < SDL_NUM_SCANCODES; scancode++)
+	{
+		scancodeKeypad[scancode] = 0;
+	}
+
+	for (int word = 0; word < InputManager::KEY_WORDS; word++)
+	{
+		boundScancodes[word] = 0;
+	}
+
+	for (int button = 0; button < SDL_CONTROLLER_BUTTON_MAX; button++)
+	{
+		buttonKeypad[button] = 0;
+	}
+
+	boundButtons = 0;
+}
+
+bool KeypadMap::bindKey(int keypadKey, SDL_Scancode scancode)
+{
+	if (keypadKey < 0 || keypadKey > 15 || scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES)
+	{
+		return false;
+	}
+
+	scancodeKeypad[scancode] |= (uint16_t)(1 << keypadKey);
+	boundScancodes[scancode >> 6] |= (uint64_t)1 << (scancode & 63);
+	return true;
+}
+
+bool KeypadMap::bindButton(int keypadKey, SDL_GameControllerButton button)
+{
+	if (keypadKey < 0 || keypadKey > 15 || button <= SDL_CONTROLLER_BUTTON_INVALID || button >= SDL_CONTROLLER_BUTTON_MAX)
+	{
+		return false;
+	}
+
+	buttonKeypad[button] |= (uint16_t)(1 << keypadKey);
+	boundButtons |= 1u << button;
+	return true;
+}
+
+uint16_t KeypadMap::applyEvent(const SDL_Event& e)
+{
+	switch (e.type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+	{
+		int scancode = e.key.keysym.scancode;
+
+		if (scancode > SDL_SCANCODE_UNKNOWN && scancode < SDL_NUM_SCANCODES)
+		{
+			uint64_t bit = (uint64_t)1 << (scancode & 63);
+
+			if (e.type == SDL_KEYDOWN)
+				eventKeysDown[scancode >> 6] |= bit;
+			else
+				eventKeysDown[scancode >> 6] &= ~bit;
+		}
+	}
+	break;
+
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP:
+	{
+		int button = e.cbutton.button;
+		int controller = InputManager::getControllerIndex(e.cbutton.which);
+
+		if (controller >= 0 && button >= 0 && button < SDL_CONTROLLER_BUTTON_MAX)
+		{
+			if (e.type == SDL_CONTROLLERBUTTONDOWN)
+				eventButtonsHeld[controller] |= 1u << button;
+			else
+				eventButtonsHeld[controller] &= ~(1u << button);
+		}
+	}
+	break;
+
+	//The removed controller's slot is already closed, so its held buttons can't be found from here
+	case SDL_CONTROLLERDEVICEREMOVED:
+		return resync();
+	}
+
+	return mapKeys(eventKeysDown) | mapButtons(eventButtonsHeld);
+}
+
+uint16_t KeypadMap::resync()
+{
+	const uint64_t* keysHeld = InputManager::getKeysHeld();
+
+	for (int word = 0; word < InputManager::KEY_WORDS; word++)
+	{
+		eventKeysDown[word] = keysHeld[word];
+	}
+
+	for (unsigned int controller = 0; controller < InputManager::MAX_GAMEPADS; controller++)
+	{
+		eventButtonsHeld[controller] = InputManager::getControllerButtonsHeld(controller);
+	}
+
+	return mapKeys(eventKeysDown) | mapButtons(eventButtonsHeld);
+}
+
+uint16_t KeypadMap::mapKeys(const uint64_t* keysHeld)
+{
+	uint16_t keypad = 0;
+
+	//Only held keys with a binding need looking up
+	for (int word = 0; word < InputManager::KEY_WORDS; word++)
+	{
+		uint64_t active = keysHeld[word] & boundScancodes[word];
+
+		while (active != 0)
+		{
+			keypad |= scancodeKeypad[(word << 6) + Utility::lowestSetBit(active)];
+			active &= active - 1;
+		}
+	}
+
+	return keypad;
+}
+
+uint16_t KeypadMap::mapButtons(const uint32_t* buttonsHeld)
+{
+	uint16_t keypad = 0;
+
+	for (unsigned int controller = 0; controller < InputManager::MAX_GAMEPADS; controller++)
+	{
+		uint32_t buttons = buttonsHeld[controller] & boundButtons;
+
+		while (buttons != 0)
+		{
+			keypad |= buttonKeypad[Utility::lowestSetBit(buttons)];
+			buttons &= buttons - 1;
+		}
+	}
+
+	return keypad;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <SDL.h>
+
+#include "InputManager.h"
+
+/**
+@brief Maps keyboard keys and controller buttons onto the 16 key CHIP-8 keypad.
+
+Bindings are compiled into flat tables, a keypad bitmask per scancode and per controller
+button, so building the keypad state each frame is a mask of the held keys against the bound
+ones and a table lookup for each hit. Any number of keys and buttons can share a keypad key.
+
+The config file has one binding per line, '#' starts a comment:
+
+	<keypad key 0-F> key <SDL scancode name, e.g. X, Keypad 5, Left Shift>
+	<keypad key 0-F> button <SDL controller button name, e.g. a, dpup, leftshoulder>
+
+Buttons are read from every connected controller.
+*/
+class KeypadMap
+{
+public:
+	/** @brief Bind the QWERTY 1234/QWER/ASDF/ZXCV block and the d-pad to 2/4/6/8 with A on 5. */
+	static void setDefaults();
+
+	/**
+	@brief Replace the bindings with the ones in a config file.
+
+	@param path The config file.
+
+	@return bool - Was successful, the bindings are left unchanged if the file can't be opened.
+	*/
+	static bool load(const std::string& path);
+
+	/** @brief Remove every binding. */
+	static void clear();
+
+	/**
+	@brief Bind a keyboard key to a keypad key.
+
+	@param keypadKey The keypad key, 0 to 15.
+	@param scancode  The keyboard key.
+
+	@return bool - Were both valid.
+	*/
+	static bool bindKey(int keypadKey, SDL_Scancode scancode);
+
+	/**
+	@brief Bind a controller button to a keypad key.
+
+	@param keypadKey The keypad key, 0 to 15.
+	@param button    The controller button.
+
+	@return bool - Were both valid.
+	*/
+	static bool bindButton(int keypadKey, SDL_GameControllerButton button);
+
+	/**
+	@brief Track a single key or controller button event, so the keypad can be followed event by
+	event rather than sampled once a frame. Each controller's held buttons are kept as one mask.
+	A controller being removed resyncs, as its buttons will never see their release events.
+
+	@param e A key or controller button event, or a controller removal, anything else is ignored.
+
+	@return The keypad after the event.
+	*/
+	static uint16_t applyEvent(const SDL_Event& e);
+
+	/**
+	@brief Replace the state applyEvent tracks with the keys and buttons InputManager has polled,
+	for when events have been missed.
+
+	@return The keypad keys held through any binding.
+	*/
+	static uint16_t resync();
+
+private:
+	KeypadMap();
+
+	///Keypad bits each scancode holds
+	static uint16_t scancodeKeypad[SDL_NUM_SCANCODES];
+
+	///Bit per scancode with a binding, laid out like InputManager::getKeysHeld
+	static uint64_t boundScancodes[InputManager::KEY_WORDS];
+
+	///Keypad bits each controller button holds
+	static uint16_t buttonKeypad[SDL_CONTROLLER_BUTTON_MAX];
+
+	///Bit per controller button with a binding
+	static uint32_t boundButtons;
+
+	///Keys down as tracked by applyEvent
+	static uint64_t eventKeysDown[InputManager::KEY_WORDS];
+
+	///Buttons held on each controller as tracked by applyEvent, laid out like InputManager::getControllerButtonsHeld
+	static uint32_t eventButtonsHeld[InputManager::MAX_GAMEPADS];
+
+	/** @brief The keypad bits of every held key with a binding. */
+	static uint16_t mapKeys(const uint64_t* keysHeld);
+
+	/** @brief The keypad bits of every held button with a binding, from a mask per controller. */
+	static uint16_t mapButtons(const uint32_t* buttonsHeld);
+};
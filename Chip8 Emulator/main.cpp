@@ -1,71 +1,425 @@
 #include "misc/Platform.h"
 #include "misc/Log.h"
 #include "Chip8.h"
+#include "FrameMemo.h"
 #include "input/InputManager.h"
-
+#include "input/KeypadMap.h"
+#include "input/InputEventQueue.h"
+#include "debug/Profiler.h"
+#include "debug/TraceBuffer.h"
+#include "debug/RomAnalyser.h"
+#include "debug/InputLatency.h"
+#include "debug/KernelBenchmark.h"
+#include "debug/CoreBenchmark.h"
+#include "debug/DeadlineMonitor.h"
+#include "debug/HangDetector.h"
+#include "debug/Fuzzer.h"
+#include "misc/FrameMetrics.h"
+#include "misc/EventTrace.h"
+#include "misc/Kernels.h"
+#include "misc/ThreadTuning.h"
+#include "rom/RomCache.h"
+#include "rom/RomLibrary.h"
+#include "aot/AotCompiler.h"
+#include "aot/AotModule.h"
+#include "scheduler/MachineScheduler.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <fstream>
+#include <vector>
 
 int main(int argc, char* argv[]);
 
+//Captured during static initialisation, the earliest point startup can be timed from portably
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
 void render();
 
 bool eventHandler();
 
+bool handleEvent(SDL_Event& e);
+
+bool waitForEvents(std::chrono::steady_clock::time_point deadline);
+
 void passThroughInput();
 
+void queueKeypadChange(unsigned long long cycle, uint16_t keypad, uint64_t arrival);
+
+void recordKeypadLatency(uint64_t emulationStart, uint64_t emulationEnd);
+
+//Parse the whole of text as a number from minimum to maximum, false if it isn't one
+bool parseNumber(const char* text, long long minimum, long long maximum, long long& value, int base = 10);
+
+//Parse an option's value, a malformed one is logged and the option keeps its default. Returns false if it was malformed
+template <typename T>
+bool parseOptionValue(const std::string& option, const char* text, T& value, long long minimum, long long maximum);
+
 Platform platform;
 SDL_Renderer* renderer;
 SDL_Texture* screenTex;
 
 Chip8 c8;
 
+Profiler profiler;
+
+FrameMetrics frameMetrics;
+
+AotModule aotModule;
+
+//Each frame emulates cyclesPerFrame cycles, then handles events until the next one is due
+const std::chrono::microseconds framePeriod(8000);
+unsigned long long cyclesPerFrame = 1;
+
+//Keypad changes for the frame about to run, placed by when they arrived during the last one
+std::vector<Chip8::KeypadEvent> keypadEvents;
+uint64_t inputWindowStart = 0;
+
+//When each of keypadEvents arrived, 0 for changes that didn't come from an event
+std::vector<uint64_t> keypadArrivals;
+
+//Changes past the end of a frame's cycle budget, applied from the start of the next one
+struct CarriedKeypadChange
+{
+	uint64_t arrival;
+	uint16_t keypad;
+};
+std::vector<CarriedKeypadChange> carriedKeypadChanges;
+std::vector<CarriedKeypadChange> carriedKeypadScratch;
+
+//InputEventQueue's dropped count as of the last drain
+uint64_t inputEventsDropped = 0;
+
+std::unique_ptr<InputLatency> inputLatency;
+
+//Frames that start more than this late count as missed
+const std::chrono::microseconds deadlineTolerance(1000);
+std::unique_ptr<DeadlineMonitor> deadlineMonitor;
+
+//Replays frames the ROM has already run from the same state and keypad, for kiosks left in attract mode
+std::unique_ptr<FrameMemo> frameMemo;
+
+//Stack the emulation loop can use without faulting once memory is locked
+const size_t lockedStackBytes = 256 * 1024;
+
+//Log how long each startup step took and quit after the first presented frame
+bool startupBenchmark = false;
+
+void logStartupTime(const char* step);
+
+//Run many copies of a ROM on this thread through MachineScheduler and log the throughput
+bool runSchedulerBenchmark(const std::string& romPath, size_t machineCount, unsigned long long frames);
+
+//Run a ROM without a window with the keypad held fixed, stopping early once it repeats an exact state
+bool runHeadless(const std::string& romPath, unsigned long long maxCycles, uint16_t keypad);
+
+std::unique_ptr<TraceBuffer> traceBuffer;
+std::string tracePath;
+
 const unsigned int screenArraySize = (Chip8::WIDTH * Chip8::HEIGHT) * (4 * sizeof(unsigned char));
 unsigned char screenArray[screenArraySize];
 
-// Keyboard layout
-// 1 2 3 4 
-// Q W E R
-// A S D F
-// Z X C V
-int keyboardLayout[16] = {
-	SDLK_x,
-	SDLK_1,
-	SDLK_2,
-	SDLK_3,
-	SDLK_q,
-	SDLK_w,
-	SDLK_e,
-	SDLK_a,
-	SDLK_s,
-	SDLK_d,
-	SDLK_z,
-	SDLK_c,
-	SDLK_4,
-	SDLK_r,
-	SDLK_f,
-	SDLK_v
-};
+//The Chip8 screen flattened out of its pages, and the one last expanded into screenArray. Redraws that change nothing skip the upload
+unsigned char currentScreen[Chip8::WIDTH * Chip8::HEIGHT];
+unsigned char presentedScreen[Chip8::WIDTH * Chip8::HEIGHT];
+bool presentedScreenValid = false;
 
 int main(int argc, char* argv[])
 {
 	Log::init(false, "Richard Hancock", "Chip8 Emulator");
 
+	//Offline trace decoding, doesn't need a ROM or SDL window
+	if (argc >= 4 && std::string(argv[1]) == "--decode-trace")
+	{
+		return TraceBuffer::decode(argv[2], argv[3]) ? 0 : -1;
+	}
+
+	//Static disassembly listing, also doesn't need SDL
+	if (argc >= 4 && std::string(argv[1]) == "--disassemble")
+	{
+		return RomAnalyser::writeListing(argv[2], argv[3]) ? 0 : -1;
+	}
+
+	//Recompile a ROM to a native module, with the quirks from an index if one is given
+	if (argc >= 4 && std::string(argv[1]) == "--aot-build")
+	{
+		Quirks quirks;
+		std::shared_ptr<const RomImage> image = RomCache::load(argv[2]);
+
+		if (argc >= 6 && std::string(argv[4]) == "--rom-index" && RomLibrary::loadIndex(argv[5]) && image != nullptr)
+		{
+			RomLibrary::findQuirks(image->hash, quirks);
+		}
+
+		return AotCompiler::build(argv[2], argv[3], quirks) ? 0 : -1;
+	}
+
+	//Check and time every kernel variant this CPU can run
+	if (argc >= 2 && std::string(argv[1]) == "--kernel-benchmark")
+	{
+		return KernelBenchmark::run() ? 0 : -1;
+	}
+
+	//Time the plain interpreter on the built in workloads, and optionally a ROM
+	if (argc >= 2 && std::string(argv[1]) == "--core-benchmark")
+	{
+		return CoreBenchmark::run(argc >= 3 ? argv[2] : "") ? 0 : -1;
+	}
+
+	//Headless, for sizing how many sessions a core can host
+	if (argc >= 5 && std::string(argv[1]) == "--scheduler-benchmark")
+	{
+		long long machineCount, frames;
+
+		if (!parseNumber(argv[3], 1, LLONG_MAX, machineCount) || !parseNumber(argv[4], 1, LLONG_MAX, frames))
+		{
+			LOG_E(std::string("Malformed scheduler benchmark machine count or frames: ") + argv[3] + " " + argv[4]);
+			return -1;
+		}
+
+		if (argc >= 6)
+		{
+			parseOptionValue("cycles per frame", argv[5], cyclesPerFrame, 1, LLONG_MAX);
+		}
+
+		return runSchedulerBenchmark(argv[2], (size_t)machineCount, (unsigned long long)frames) ? 0 : -1;
+	}
+
+	//Headless, for checking ROMs run to a budget without hanging
+	if (argc >= 4 && std::string(argv[1]) == "--headless")
+	{
+		long long maxCycles;
+		long long keypad = 0;
+
+		if (!parseNumber(argv[3], 1, LLONG_MAX, maxCycles) || (argc >= 5 && !parseNumber(argv[4], 0, 0xFFFF, keypad, 16)))
+		{
+			LOG_E("Malformed headless cycle budget or keypad, expected cycles and an optional hex keypad mask");
+			return -1;
+		}
+
+		return runHeadless(argv[2], (unsigned long long)maxCycles, (uint16_t)keypad) ? 0 : -1;
+	}
+
+	//Coverage guided fuzzing of the core from a seed ROM, also reports the instrumented throughput
+	if (argc >= 4 && std::string(argv[1]) == "--fuzz")
+	{
+		Fuzzer::Options options;
+		long long executions;
+
+		if (!parseNumber(argv[3], 1, LLONG_MAX, executions))
+		{
+			LOG_E(std::string("Malformed fuzz execution count: ") + argv[3]);
+			return -1;
+		}
+
+		options.executions = (unsigned long long)executions;
+
+		if (argc >= 5)
+		{
+			options.outputDirectory = argv[4];
+		}
+
+		Fuzzer fuzzer(options);
+
+		if (!fuzzer.loadSeed(argv[2]))
+		{
+			return -1;
+		}
+
+		fuzzer.run();
+		LOG_I(fuzzer.generateReport());
+		return 0;
+	}
+
 	if (argc < 2)
 	{
-		Log::logE("No ROM path passed through comand line parameters");
+		LOG_E("No ROM path passed through comand line parameters");
 		return -1;
 	}
 
+	//Optional parameters after the ROM path
+	std::string profilePath;
+	unsigned long long traceSize = 1 << 20;
+	std::string metricsTarget;
+	std::string eventTracePath;
+	unsigned int metricsInterval = 1000;
+	std::string romIndexPath;
+	std::string romScanDirectory;
+	std::string aotModulePath;
+	std::string keypadMapPath = "keymap.cfg";
+	std::string inputLatencyPath;
+	std::string deadlineReportPath;
+	std::vector<int> affinityCores;
+	int realtimePriority = 0;
+	int niceValue = 0;
+	bool niceRequested = false;
+	bool lockMemory = false;
+	size_t frameMemoCapacity = 0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "--profile" && i + 1 < argc)
+		{
+			profilePath = argv[++i];
+		}
+		else if (arg == "--trace" && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (arg == "--trace-size" && i + 1 < argc)
+		{
+			parseOptionValue(arg, argv[++i], traceSize, 1, LLONG_MAX);
+		}
+		else if (arg == "--metrics" && i + 1 < argc)
+		{
+			metricsTarget = argv[++i];
+		}
+		else if (arg == "--metrics-interval" && i + 1 < argc)
+		{
+			parseOptionValue(arg, argv[++i], metricsInterval, 1, UINT_MAX);
+		}
+		else if (arg == "--event-trace" && i + 1 < argc)
+		{
+			eventTracePath = argv[++i];
+		}
+		else if (arg == "--rom-index" && i + 1 < argc)
+		{
+			romIndexPath = argv[++i];
+		}
+		else if (arg == "--scan-roms" && i + 1 < argc)
+		{
+			romScanDirectory = argv[++i];
+		}
+		else if (arg == "--aot" && i + 1 < argc)
+		{
+			aotModulePath = argv[++i];
+		}
+		else if (arg == "--keymap" && i + 1 < argc)
+		{
+			keypadMapPath = argv[++i];
+		}
+		else if (arg == "--startup-benchmark")
+		{
+			startupBenchmark = true;
+		}
+		else if (arg == "--cycles-per-frame" && i + 1 < argc)
+		{
+			//0 would carry every keypad change forward forever without applying any
+			parseOptionValue(arg, argv[++i], cyclesPerFrame, 1, LLONG_MAX);
+		}
+		else if (arg == "--input-latency" && i + 1 < argc)
+		{
+			inputLatencyPath = argv[++i];
+		}
+		else if (arg == "--cpu-affinity" && i + 1 < argc)
+		{
+			if (!ThreadTuning::parseCoreList(argv[++i], affinityCores))
+			{
+				LOG_W(std::string("Ignoring malformed core list: ") + argv[i]);
+			}
+		}
+		else if (arg == "--rt-priority" && i + 1 < argc)
+		{
+			parseOptionValue(arg, argv[++i], realtimePriority, 1, 99);
+		}
+		else if (arg == "--nice" && i + 1 < argc)
+		{
+			if (parseOptionValue(arg, argv[++i], niceValue, -20, 19))
+			{
+				niceRequested = true;
+			}
+		}
+		else if (arg == "--lock-memory")
+		{
+			lockMemory = true;
+		}
+		else if (arg == "--deadline-report" && i + 1 < argc)
+		{
+			deadlineReportPath = argv[++i];
+		}
+		else if (arg == "--frame-memo" && i + 1 < argc)
+		{
+			parseOptionValue(arg, argv[++i], frameMemoCapacity, 1, LLONG_MAX);
+		}
+		else
+		{
+			LOG_W("Unknown command line parameter: " + arg);
+		}
+	}
+
+	if (!profilePath.empty())
+	{
+		c8.setProfiler(&profiler);
+	}
+
+	if (!tracePath.empty())
+	{
+		traceBuffer.reset(new TraceBuffer(traceSize));
+		c8.setTraceBuffer(traceBuffer.get());
+	}
+
+	if (!metricsTarget.empty())
+	{
+		frameMetrics.setExportTarget(metricsTarget, metricsInterval);
+	}
+
+	if (!eventTracePath.empty())
+	{
+		EventTrace::enable();
+		EventTrace::setThreadName("Main");
+		c8.setEventTracing(true);
+	}
+
+	//ROM library, so loadROM can pick the quirk profile for the ROM
+	if (!romScanDirectory.empty() && romIndexPath.empty())
+	{
+		romIndexPath = "roms.index";
+	}
+
+	if (!romIndexPath.empty())
+	{
+		std::ifstream existingIndex(romIndexPath);
+		if (existingIndex.good())
+		{
+			RomLibrary::loadIndex(romIndexPath);
+		}
+	}
+
+	if (!romScanDirectory.empty() && RomLibrary::scan(romScanDirectory))
+	{
+		RomLibrary::saveIndex(romIndexPath);
+	}
+
+	//Keypad bindings, the built in layout unless a map file exists
+	KeypadMap::setDefaults();
+
+	std::ifstream existingKeypadMap(keypadMapPath);
+	if (existingKeypadMap.good())
+	{
+		KeypadMap::load(keypadMapPath);
+	}
+
 	//Init Random
-	srand((unsigned int)time(0));
+	c8.setRandomSeed((uint32_t)time(0));
+
+	logStartupTime("Options parsed");
 
 	if (!platform.initSDL())
 	{
-		Log::logE("SDL Failed to initialize");
+		LOG_E("SDL Failed to initialize");
 		exit(1);
 	}
 
+	logStartupTime("Window created");
+
 	renderer = platform.getRenderer();
 	SDL_RenderSetLogicalSize(renderer, 64, 32);
 
@@ -74,118 +428,548 @@ int main(int argc, char* argv[])
 
 	if (screenTex == NULL)
 	{
-		Log::logE(SDL_GetError());
+		LOG_E(SDL_GetError());
 	}
 
 	//Load Program
 	c8.loadROM(argv[1]);
+	logStartupTime("ROM loaded");
+
+	if (!aotModulePath.empty() && aotModule.load(aotModulePath))
+	{
+		c8.setAotModule(&aotModule);
+	}
+
+	//Too few cycles a frame and the memo would only cost the state hashing it turns on
+	if (frameMemoCapacity > 0 && cyclesPerFrame < FrameMemo::MIN_CYCLE_BUDGET)
+	{
+		LOG_W("Frame memo needs at least " + std::to_string(FrameMemo::MIN_CYCLE_BUDGET) + " cycles per frame, running without it");
+	}
+	else if (frameMemoCapacity > 0)
+	{
+		frameMemo.reset(new FrameMemo(frameMemoCapacity));
+		c8.setFrameMemo(frameMemo.get());
+	}
+
+	if (!inputLatencyPath.empty())
+	{
+		inputLatency.reset(new InputLatency());
+	}
+
+	InputEventQueue::start();
+	keypadEvents.reserve(64);
+	keypadArrivals.reserve(64);
+	carriedKeypadChanges.reserve(64);
+	carriedKeypadScratch.reserve(64);
+	inputWindowStart = InputEventQueue::now();
+
+	//The loop below is the emulation thread, place it now that startup has allocated everything
+	if (!affinityCores.empty())
+	{
+		ThreadTuning::setAffinity(affinityCores);
+	}
+
+	//Fall back to nice if a real time policy isn't permitted
+	if (realtimePriority > 0 && !ThreadTuning::setRealtimePriority(realtimePriority) && !niceRequested)
+	{
+		LOG_W("Continuing at normal priority, pass --nice to request a higher nice priority instead");
+	}
+
+	if (niceRequested)
+	{
+		ThreadTuning::setNice(niceValue);
+	}
+
+	if (lockMemory)
+	{
+		ThreadTuning::lockMemory(lockedStackBytes);
+	}
+
+	if (!deadlineReportPath.empty())
+	{
+		deadlineMonitor.reset(new DeadlineMonitor(deadlineTolerance));
+		LOG_I("Emulation thread: " + ThreadTuning::describe());
+	}
+
+	std::chrono::steady_clock::time_point frameDeadline = std::chrono::steady_clock::now() + framePeriod;
+	std::chrono::steady_clock::time_point frameDue = std::chrono::steady_clock::now();
 
 	bool run = true;
+	bool controllersRequested = false;
 
 	while (run)
 	{
+		TRACE_SCOPE("frame", "host");
+		frameMetrics.beginFrame();
+
+		if (deadlineMonitor)
+		{
+			deadlineMonitor->recordFrame(frameDue, std::chrono::steady_clock::now());
+		}
+
 		//Input
 		run = eventHandler();
+		frameMetrics.endPhase(FrameMetrics::EventHandler);
 
 		passThroughInput();
+		frameMetrics.endPhase(FrameMetrics::PassThroughInput);
 
 		InputManager::update();
+		frameMetrics.endPhase(FrameMetrics::InputUpdate);
 
-		//Emulate Cycle
-		c8.emulateCycle();
+		//Emulate Frame
+		{
+			TRACE_SCOPE("emulateFrame", "chip8", "cycles", cyclesPerFrame);
+			uint64_t emulationStart = (inputLatency ? InputEventQueue::now() : 0);
+
+			c8.runFrame(cyclesPerFrame, keypadEvents.data(), keypadEvents.size());
+
+			if (inputLatency)
+			{
+				recordKeypadLatency(emulationStart, InputEventQueue::now());
+			}
+		}
+		frameMetrics.endPhase(FrameMetrics::Emulation);
 
 		//Update Graphics if flag set
 		if (c8.isDrawFlagSet())
 		{
 			//Should switch to lock/unlock texture
 			render();
+
+			if (inputLatency)
+			{
+				inputLatency->recordPresented(InputEventQueue::now());
+			}
+
+			if (startupBenchmark)
+			{
+				logStartupTime("First frame presented");
+				run = false;
+			}
 		}
+		frameMetrics.endPhase(FrameMetrics::Render);
 
 		//Audio
 		if (c8.beepThisCycle())
 		{
 			//Temp until I implement a audio solution
-			Log::logD("BEEP");
+			EventTrace::instant("beep", "audio");
+			LOG_D("BEEP");
+		}
+		frameMetrics.endPhase(FrameMetrics::Audio);
+
+		//Scanning for controllers can take a while, so it waits until the first frame is out and eats into
+		//the sleep. SDL subsystems have to come up on the thread that pumps events, so it can't run alongside
+		if (!controllersRequested && run)
+		{
+			controllersRequested = true;
+			platform.initControllers();
+			logStartupTime("Controllers initialised");
+		}
+
+		//Handle events as they arrive until the next frame is due, so they're timestamped on arrival
+		{
+			TRACE_SCOPE("sleep", "host");
+			run = waitForEvents(frameDeadline) && run;
 		}
 
-		//Not Perfect But need to try to keep cycle running 60 times a second
-		//std::this_thread::sleep_for(std::chrono::microseconds(16600));
-		std::this_thread::sleep_for(std::chrono::microseconds(8000));
+		frameDue = frameDeadline;
+
+		//Don't try to catch up after a stall, just start pacing again from now
+		frameDeadline += framePeriod;
+		if (frameDeadline < std::chrono::steady_clock::now())
+		{
+			frameDeadline = std::chrono::steady_clock::now() + framePeriod;
+		}
+		frameMetrics.endPhase(FrameMetrics::Sleep);
+
+		frameMetrics.endFrame();
+	}
+
+	if (!profilePath.empty())
+	{
+		profiler.writeReports(profilePath);
+	}
+
+	if (traceBuffer)
+	{
+		traceBuffer->dump(tracePath);
+	}
+
+	if (!eventTracePath.empty())
+	{
+		EventTrace::writeJSON(eventTracePath);
+	}
+
+	if (inputLatency)
+	{
+		inputLatency->writeReport(inputLatencyPath);
+	}
+
+	if (deadlineMonitor)
+	{
+		deadlineMonitor->writeReport(deadlineReportPath);
+	}
+
+	if (frameMemo)
+	{
+		LOG_I("Frame memo hits: " + std::to_string(frameMemo->getStats().hits) + ", misses: " + std::to_string(frameMemo->getStats().misses)
+			+ ", evictions: " + std::to_string(frameMemo->getStats().evictions));
 	}
 
+	InputEventQueue::stop();
+
 	InputManager::cleanup();
 
 	SDL_DestroyTexture(screenTex);
 
+	Log::cleanup();
+
 	return 0;
 }
 
 void render()
 {
-	for (int i = 0; i < Chip8::WIDTH * Chip8::HEIGHT; i++)
+	TRACE_SCOPE("render", "host");
+
+	const unsigned char* screen = currentScreen;
+	c8.copyScreen(currentScreen);
+
+	const size_t pixelCount = Chip8::WIDTH * Chip8::HEIGHT;
+
+	//Erasing and redrawing a sprite in the same frame sets the draw flag without changing anything
+	if (!presentedScreenValid || Kernels::findDifference(screen, presentedScreen, pixelCount) != pixelCount)
 	{
-		unsigned char pixel = c8.getScreenArray()[i] * 255;
-		unsigned int offsetI = i * 4;
+		Kernels::expandFramebuffer(screen, screenArray, pixelCount);
+		memcpy(presentedScreen, screen, pixelCount);
+		presentedScreenValid = true;
 
-		screenArray[offsetI] = pixel;
-		screenArray[offsetI + 1] = pixel;
-		screenArray[offsetI + 2] = pixel;
-		screenArray[offsetI + 3] = 0; //Alpha Chennel
+		SDL_UpdateTexture(screenTex, NULL, screenArray, Chip8::WIDTH * (4 * sizeof(unsigned char)));
 	}
 
-	SDL_UpdateTexture(screenTex, NULL, screenArray, Chip8::WIDTH * (4 * sizeof(unsigned char)));
-
 	SDL_RenderClear(renderer);
 	SDL_RenderCopy(renderer, screenTex, NULL, NULL);
+
+	TRACE_SCOPE("present", "host");
 	SDL_RenderPresent(renderer);
 }
 
 bool eventHandler()
 {
+	TRACE_SCOPE("eventHandler", "host");
+
 	SDL_Event e;
 	while (SDL_PollEvent(&e))
 	{
-		switch (e.type)
+		if (!handleEvent(e))
 		{
-		case SDL_QUIT:
 			return false;
-			break;
+		}
+	}
 
-		case SDL_KEYUP:
-		case SDL_KEYDOWN:
-			InputManager::processKeyEvent(e);
-			break;
+	if (InputManager::wasKeyReleased(SDL_SCANCODE_ESCAPE))
+	{
+		return false;
+	}
 
-		case SDL_MOUSEBUTTONDOWN:
-		case SDL_MOUSEBUTTONUP:
-		case SDL_MOUSEMOTION:
-		case SDL_MOUSEWHEEL:
-			InputManager::processMouseEvent(e);
+	//Dump the instruction history on demand, for when a ROM starts misbehaving
+	if (traceBuffer && InputManager::wasKeyReleased(SDL_SCANCODE_F12))
+	{
+		traceBuffer->dump(tracePath);
+	}
 
-			break;
+	return true;
+}
 
-		case SDL_CONTROLLERAXISMOTION:
-		case SDL_CONTROLLERBUTTONDOWN:
-		case SDL_CONTROLLERBUTTONUP:
-		case SDL_CONTROLLERDEVICEADDED:
-		case SDL_CONTROLLERDEVICEREMOVED:
-			InputManager::processGameControllerEvent(e);
-			break;
+bool handleEvent(SDL_Event& e)
+{
+	EventTrace::instant("inputEvent", "input", "type", e.type);
+
+	switch (e.type)
+	{
+	case SDL_QUIT:
+		return false;
+		break;
+
+	case SDL_KEYUP:
+	case SDL_KEYDOWN:
+		InputManager::processKeyEvent(e);
+		break;
+
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEWHEEL:
+		InputManager::processMouseEvent(e);
+
+		break;
+
+	case SDL_CONTROLLERAXISMOTION:
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP:
+	case SDL_CONTROLLERDEVICEADDED:
+	case SDL_CONTROLLERDEVICEREMOVED:
+		InputManager::processGameControllerEvent(e);
+		break;
+	}
+
+	return true;
+}
+
+bool waitForEvents(std::chrono::steady_clock::time_point deadline)
+{
+	SDL_Event e;
+
+	for (;;)
+	{
+		std::chrono::steady_clock::duration remaining = deadline - std::chrono::steady_clock::now();
+
+		if (remaining <= std::chrono::steady_clock::duration::zero())
+		{
+			return true;
+		}
+
+		//SDL waits in whole milliseconds, sleep off anything shorter
+		int remainingMS = (int)std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count();
+
+		if (remainingMS == 0)
+		{
+			std::this_thread::sleep_for(remaining);
+			return true;
+		}
+
+		if (SDL_WaitEventTimeout(&e, remainingMS) && !handleEvent(e))
+		{
+			return false;
+		}
+	}
+}
+
+void passThroughInput()
+{
+	//Changes that arrived over the last frame are spread across this one by arrival time, so they
+	//keep their spacing and all land exactly a frame late rather than bunched at the frame start
+	uint64_t windowEnd = InputEventQueue::now();
+	uint64_t windowLength = (windowEnd > inputWindowStart ? windowEnd - inputWindowStart : 1);
+
+	uint16_t keypad = c8.getKeypad();
+
+	keypadEvents.clear();
+	keypadArrivals.clear();
+
+	//Whatever didn't fit in the last frame goes first
+	carriedKeypadScratch.swap(carriedKeypadChanges);
+	carriedKeypadChanges.clear();
+
+	for (const CarriedKeypadChange& change : carriedKeypadScratch)
+	{
+		keypad = change.keypad;
+		queueKeypadChange(0, keypad, change.arrival);
+	}
+
+	InputEventQueue::TimedEvent timedEvent;
+	while (InputEventQueue::pop(timedEvent))
+	{
+		uint16_t newKeypad = KeypadMap::applyEvent(timedEvent.event);
+
+		if (newKeypad == keypad)
+		{
+			continue;
+		}
+
+		keypad = newKeypad;
+
+		uint64_t offset = (timedEvent.timestamp > inputWindowStart ? timedEvent.timestamp - inputWindowStart : 0);
+		unsigned long long cycle = (unsigned long long)((double)offset / windowLength * cyclesPerFrame);
+
+		queueKeypadChange(cycle, keypad, timedEvent.timestamp);
+	}
+
+	//Events dropped on a full queue are gone, catch up with the polled state after the ones that made it
+	uint64_t dropped = InputEventQueue::getDroppedCount();
+
+	if (dropped != inputEventsDropped)
+	{
+		inputEventsDropped = dropped;
+
+		uint16_t polledKeypad = KeypadMap::resync();
+
+		if (polledKeypad != keypad)
+		{
+			queueKeypadChange(0, polledKeypad, 0);
+		}
+	}
+
+	inputWindowStart = windowEnd;
+}
+
+void queueKeypadChange(unsigned long long cycle, uint16_t keypad, uint64_t arrival)
+{
+	//Every change gets a cycle to itself so a press and release in the same frame is still seen,
+	//and events from different threads can be stamped slightly out of order
+	if (!keypadEvents.empty() && cycle <= keypadEvents.back().cycle)
+	{
+		cycle = keypadEvents.back().cycle + 1;
+	}
+
+	//Once one change spills into the next frame the rest follow it, keeping them in order
+	if (cycle >= cyclesPerFrame || !carriedKeypadChanges.empty())
+	{
+		CarriedKeypadChange change = { arrival, keypad };
+		carriedKeypadChanges.push_back(change);
+		return;
+	}
+
+	Chip8::KeypadEvent event = { cycle, keypad };
+	keypadEvents.push_back(event);
+	keypadArrivals.push_back(arrival);
+}
+
+void recordKeypadLatency(uint64_t emulationStart, uint64_t emulationEnd)
+{
+	//A change takes effect when the frame reaches its cycle, cycles are taken to run at an even pace
+	for (size_t i = 0; i < keypadEvents.size(); i++)
+	{
+		if (keypadArrivals[i] == 0)
+		{
+			continue;
 		}
+
+		uint64_t applied = emulationStart + (uint64_t)((double)(emulationEnd - emulationStart) * keypadEvents[i].cycle / cyclesPerFrame);
+		inputLatency->recordApplied(keypadArrivals[i], applied);
+	}
+}
+
+void logStartupTime(const char* step)
+{
+	if (!startupBenchmark)
+	{
+		return;
+	}
+
+	double elapsedMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+
+	char line[128];
+	snprintf(line, sizeof(line), "Startup: %-24s %8.2f ms", step, elapsedMS);
+	LOG_I(line);
+}
+
+bool runSchedulerBenchmark(const std::string& romPath, size_t machineCount, unsigned long long frames)
+{
+	std::shared_ptr<const RomImage> image = RomCache::load(romPath);
+
+	if (image == nullptr)
+	{
+		return false;
+	}
+
+	MachineScheduler scheduler(cyclesPerFrame);
+
+	for (size_t i = 0; i < machineCount; i++)
+	{
+		std::unique_ptr<Chip8> machine(new Chip8());
+		machine->loadROM(image);
+		scheduler.add(std::move(machine));
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned long long frame = 0; frame < frames; frame++)
+	{
+		scheduler.runFrame();
+	}
+
+	double elapsedMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	const MachineScheduler::Stats& stats = scheduler.getStats();
+
+	char line[192];
+	snprintf(line, sizeof(line), "Scheduled %zu machines for %llu frames in %.2f ms, %.2f us per frame",
+		machineCount, frames, elapsedMS, frames > 0 ? elapsedMS * 1000.0 / frames : 0.0);
+	LOG_I(line);
+
+	snprintf(line, sizeof(line), "Cycles run: %llu, skipped while idle: %llu, parks: %llu, wakes: %llu, parked at the end: %zu",
+		stats.cyclesRun, stats.cyclesSkipped, stats.parks, stats.wakes, scheduler.getParkedCount());
+	LOG_I(line);
+
+	return true;
+}
+
+bool runHeadless(const std::string& romPath, unsigned long long maxCycles, uint16_t keypad)
+{
+	std::unique_ptr<Chip8> machine(new Chip8());
+
+	if (!machine->loadROM(romPath))
+	{
+		return false;
+	}
+
+	machine->setKeypad(keypad);
+	machine->setStateHashing(true);
+
+	HangDetector hangDetector;
+	hangDetector.record(machine->getStateHash());
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (machine->getCycleCount() < maxCycles)
+	{
+		machine->runCycles(1);
+
+		if (hangDetector.record(machine->getStateHash()))
+			break;
 	}
 
-	if (InputManager::wasKeyReleased(SDLK_ESCAPE))
+	double elapsedMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	char line[192];
+
+	if (hangDetector.isHung())
+	{
+		snprintf(line, sizeof(line), "Stopped after %llu of %llu cycles in %.2f ms, the ROM is repeating a cycle of %llu states",
+			machine->getCycleCount(), maxCycles, elapsedMS, (unsigned long long)hangDetector.getCycleLength());
+	}
+	else
+	{
+		snprintf(line, sizeof(line), "Ran %llu cycles in %.2f ms without repeating a state",
+			machine->getCycleCount(), elapsedMS);
+	}
+
+	LOG_I(line);
+
+	snprintf(line, sizeof(line), "Final state hash: %016llx", (unsigned long long)machine->getStateHash());
+	LOG_I(line);
+
+	return true;
+}
+
+bool parseNumber(const char* text, long long minimum, long long maximum, long long& value, int base)
+{
+	char* end = nullptr;
+	errno = 0;
+
+	long long parsed = strtoll(text, &end, base);
+
+	if (end == text || *end != '\0' || errno == ERANGE || parsed < minimum || parsed > maximum)
 	{
 		return false;
 	}
 
+	value = parsed;
 	return true;
 }
 
-void passThroughInput()
+template <typename T>
+bool parseOptionValue(const std::string& option, const char* text, T& value, long long minimum, long long maximum)
 {
-	for (int i = 0; i < 16; i++)
+	long long parsed;
+
+	if (!parseNumber(text, minimum, maximum, parsed))
 	{
-		c8.setKeyState(i, InputManager::isKeyHeld(keyboardLayout[i]));
+		LOG_W("Ignoring malformed " + option + " value: " + text + ", keeping " + std::to_string(value));
+		return false;
 	}
+
+	value = (T)parsed;
+	return true;
 }
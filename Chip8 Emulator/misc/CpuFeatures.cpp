@@ -0,0 +1,119 @@
+#include "CpuFeatures.h"
+
+#include <SDL.h>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPUID_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPUID_X86 1
+#endif
+
+bool CpuFeatures::resolved = false;
+uint32_t CpuFeatures::features = 0;
+
+namespace
+{
+	const char* featureNames[CpuFeatures::FeatureCount] = {
+		"MMX", "3DNow", "RDTSC", "AltiVec", "SSE", "SSE2", "SSE3", "SSSE3",
+		"SSE41", "SSE42", "AVX", "AVX2", "AVX512F", "AVX512BW"
+	};
+
+	///Registers eax, ebx, ecx, edx of a cpuid leaf, all zero if the leaf doesn't exist
+	void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+	{
+		registers[0] = registers[1] = registers[2] = registers[3] = 0;
+
+#if defined(_MSC_VER) && defined(CPUID_X86)
+		int values[4];
+		__cpuid(values, 0);
+
+		if ((unsigned int)values[0] < leaf)
+			return;
+
+		__cpuidex(values, (int)leaf, (int)subleaf);
+
+		for (int i = 0; i < 4; i++)
+		{
+			registers[i] = (unsigned int)values[i];
+		}
+#elif defined(CPUID_X86)
+		__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]);
+#else
+		(void)leaf;
+		(void)subleaf;
+#endif
+	}
+}
+
+CpuFeatures::CpuFeatures()
+{
+
+}
+
+void CpuFeatures::resolve()
+{
+	if (resolved)
+		return;
+
+	uint32_t detected = 0;
+
+	//SDL covers most extensions, including checking the OS saves the AVX registers
+	const SDL_bool sdlFeatures[] = {
+		SDL_HasMMX(), SDL_Has3DNow(), SDL_HasRDTSC(), SDL_HasAltiVec(), SDL_HasSSE(), SDL_HasSSE2(),
+		SDL_HasSSE3(), SDL_FALSE, SDL_HasSSE41(), SDL_HasSSE42(), SDL_HasAVX(), SDL_HasAVX2(),
+		SDL_HasAVX512F(), SDL_FALSE
+	};
+
+	static_assert(sizeof(sdlFeatures) / sizeof(sdlFeatures[0]) == FeatureCount, "sdlFeatures needs an entry per feature");
+
+	for (int feature = 0; feature < FeatureCount; feature++)
+	{
+		if (sdlFeatures[feature] == SDL_TRUE)
+			detected |= 1u << feature;
+	}
+
+	//SDL doesn't report SSSE3 or AVX-512BW, they are read from cpuid directly
+	unsigned int registers[4];
+
+	cpuid(1, 0, registers);
+	if (registers[2] & (1u << 9))
+		detected |= 1u << SSSE3;
+
+	//The zmm state check is already part of SDL's AVX512F test
+	cpuid(7, 0, registers);
+	if ((detected & (1u << AVX512F)) && (registers[1] & (1u << 30)))
+		detected |= 1u << AVX512BW;
+
+	features = detected;
+	resolved = true;
+}
+
+uint32_t CpuFeatures::getFeatures()
+{
+	resolve();
+	return features;
+}
+
+const char* CpuFeatures::getName(Feature feature)
+{
+	if (feature < 0 || feature >= FeatureCount)
+		return "Unknown";
+
+	return featureNames[feature];
+}
+
+bool CpuFeatures::fromName(const std::string& name, Feature& feature)
+{
+	for (int i = 0; i < FeatureCount; i++)
+	{
+		if (name == featureNames[i])
+		{
+			feature = (Feature)i;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+@brief The host CPU's instruction set extensions, detected once and kept as a bitset.
+
+Hot code asks for features by enum, which is a single bit test, instead of going through
+the string keyed lookup Platform offers for logging and configuration.
+*/
+class CpuFeatures
+{
+public:
+	/** @brief Detectable extensions, each one is a bit in the feature set. */
+	enum Feature
+	{
+		MMX,
+		ThreeDNow,
+		RDTSC,
+		AltiVec,
+		SSE,
+		SSE2,
+		SSE3,
+		SSSE3,
+		SSE41,
+		SSE42,
+		AVX,
+		AVX2,
+		AVX512F,
+		AVX512BW,
+
+		FeatureCount
+	};
+
+	/** @brief Detect the host's features, only the first call does any work. */
+	static void resolve();
+
+	/** @brief Is a feature supported, resolving the feature set if needed. */
+	static bool has(Feature feature)
+	{
+		if (!resolved)
+			resolve();
+
+		return (features >> feature) & 1;
+	}
+
+	/** @brief The bitset of supported features, indexed by Feature. */
+	static uint32_t getFeatures();
+
+	/** @brief The name a feature is known by in logs and config, such as "AVX2". */
+	static const char* getName(Feature feature);
+
+	/**
+	@brief Find a feature from its name.
+
+	@param name    The name, as returned by getName.
+	@param [out] feature Receives the feature.
+
+	@return false if the name is unknown.
+	*/
+	static bool fromName(const std::string& name, Feature& feature);
+
+private:
+	CpuFeatures();
+
+	static bool resolved;
+	static uint32_t features;
+
+	static_assert(FeatureCount <= 32, "features needs a bit per feature");
+};
@@ -0,0 +1,147 @@
+#include "EventTrace.h"
+
+#include <chrono>
+#include <fstream>
+
+#include "Log.h"
+
+std::atomic<bool> EventTrace::enabled(false);
+size_t EventTrace::eventsPerThread = 1 << 16;
+std::vector<std::unique_ptr<EventTrace::ThreadBuffer>> EventTrace::buffers;
+std::mutex EventTrace::buffersMutex;
+thread_local EventTrace::ThreadBuffer* EventTrace::threadBuffer = nullptr;
+thread_local const char* EventTrace::threadName = nullptr;
+
+namespace
+{
+	const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+}
+
+void EventTrace::enable(size_t newEventsPerThread)
+{
+	size_t rounded = 1;
+	while (rounded < newEventsPerThread)
+		rounded <<= 1;
+
+	eventsPerThread = rounded;
+	enabled = true;
+}
+
+void EventTrace::setThreadName(const char* name)
+{
+	threadName = name;
+
+	if (threadBuffer != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		threadBuffer->name = name;
+	}
+}
+
+uint64_t EventTrace::now()
+{
+	//Offset by one so a valid timestamp is never 0
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - traceStart).count() + 1;
+}
+
+void EventTrace::complete(const char* name, const char* category, uint64_t start, uint64_t end,
+	const char* argName, uint64_t argValue)
+{
+	if (!isEnabled())
+		return;
+
+	Event event = { name, category, argName, argValue, start, end - start, 'X' };
+	record(event);
+}
+
+void EventTrace::instant(const char* name, const char* category, const char* argName, uint64_t argValue)
+{
+	if (!isEnabled())
+		return;
+
+	Event event = { name, category, argName, argValue, now(), 0, 'i' };
+	record(event);
+}
+
+EventTrace::ThreadBuffer* EventTrace::getThreadBuffer()
+{
+	if (threadBuffer == nullptr)
+	{
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+		buffer->events.reset(new Event[eventsPerThread]);
+		buffer->mask = eventsPerThread - 1;
+		buffer->writeIndex = 0;
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		buffer->threadID = (uint32_t)buffers.size() + 1;
+		buffer->name = (threadName != nullptr ? threadName : "Thread " + std::to_string(buffer->threadID));
+		threadBuffer = buffer.get();
+		buffers.push_back(std::move(buffer));
+	}
+
+	return threadBuffer;
+}
+
+void EventTrace::record(const Event& event)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+	buffer->events[(size_t)(index & buffer->mask)] = event;
+	buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool EventTrace::writeJSON(const std::string& path)
+{
+	std::ofstream file(path);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not open event trace file: " + path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+
+	size_t eventCount = 0;
+	bool first = true;
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	for (auto& buffer : buffers)
+	{
+		file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< buffer->threadID << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+		first = false;
+
+		uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+		uint64_t begin = (end > buffer->mask ? end - buffer->mask - 1 : 0);
+
+		for (uint64_t i = begin; i < end; i++)
+		{
+			const Event& event = buffer->events[(size_t)(i & buffer->mask)];
+
+			//Trace Event timestamps are in microseconds
+			file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+				<< "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << buffer->threadID
+				<< ",\"ts\":" << event.timestamp / 1000 << "." << (event.timestamp % 1000) / 100;
+
+			if (event.phase == 'X')
+				file << ",\"dur\":" << event.duration / 1000 << "." << (event.duration % 1000) / 100;
+			else
+				file << ",\"s\":\"t\"";
+
+			if (event.argName != nullptr)
+				file << ",\"args\":{\"" << event.argName << "\":" << event.argValue << "}";
+
+			file << "}";
+			eventCount++;
+		}
+	}
+
+	file << "\n]}\n";
+
+	LOG_I("Event trace of " + std::to_string(eventCount) + " events written to: " + path);
+	return true;
+}
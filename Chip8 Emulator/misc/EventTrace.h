@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+@brief Records timeline events and exports them in the Chrome Trace Event JSON format.
+
+Open the exported file in Perfetto (ui.perfetto.dev) or chrome://tracing. Every thread writes
+into its own preallocated ring buffer, so recording takes no locks and never allocates after
+a thread's first event. While disabled, recording is a single relaxed atomic load.
+*/
+class EventTrace
+{
+public:
+	/** @brief Enable recording, keeping up to eventsPerThread of the most recent events for each thread. */
+	static void enable(size_t eventsPerThread = 1 << 16);
+
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	/** @brief Name the calling thread in the exported trace, string literals only. Can be called before enable(). */
+	static void setThreadName(const char* name);
+
+	/** @brief Current trace timestamp in nanoseconds. */
+	static uint64_t now();
+
+	/**
+	@brief Record an event that has already finished.
+
+	Names, categories and argument names must be string literals, only the pointers are stored.
+
+	@param name     The event name.
+	@param category The event category.
+	@param start    Start timestamp from now().
+	@param end      End timestamp from now().
+	@param argName  Optional numeric argument name, nullptr for none.
+	@param argValue Value of the argument.
+	*/
+	static void complete(const char* name, const char* category, uint64_t start, uint64_t end,
+		const char* argName = nullptr, uint64_t argValue = 0);
+
+	/** @brief Record a point in time event. See complete() for the parameters. */
+	static void instant(const char* name, const char* category,
+		const char* argName = nullptr, uint64_t argValue = 0);
+
+	/**
+	@brief Write every recorded event to a Chrome Trace Event JSON file.
+
+	@param path The file to write.
+
+	@return bool - Was successful.
+	*/
+	static bool writeJSON(const std::string& path);
+
+	/** @brief Records a complete event covering its own lifetime. */
+	class Scope
+	{
+	public:
+		Scope(const char* name, const char* category, const char* argName = nullptr, uint64_t argValue = 0)
+			: name(name), category(category), argName(argName), argValue(argValue),
+			start(isEnabled() ? now() : 0)
+		{
+		}
+
+		~Scope()
+		{
+			if (start != 0)
+				complete(name, category, start, now(), argName, argValue);
+		}
+
+	private:
+		const char* name;
+		const char* category;
+		const char* argName;
+		uint64_t argValue;
+		uint64_t start;
+	};
+
+private:
+
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		const char* argName;
+		uint64_t argValue;
+		uint64_t timestamp;
+		uint64_t duration;
+		char phase; ///< 'X' complete or 'i' instant
+	};
+
+	/** @brief Events from a single thread, only ever written by that thread. */
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> events;
+		size_t mask;
+		std::atomic<uint64_t> writeIndex;
+		uint32_t threadID;
+		std::string name;
+	};
+
+	static std::atomic<bool> enabled;
+
+	static size_t eventsPerThread;
+
+	/** @brief Every thread's buffer, kept after the thread exits so its events can still be exported. */
+	static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+	static std::mutex buffersMutex;
+
+	static thread_local ThreadBuffer* threadBuffer;
+
+	/** @brief Kept even while disabled, so threads started before tracing is enabled still get named. */
+	static thread_local const char* threadName;
+
+	/** @brief Gets the calling thread's buffer, creating it on first use. */
+	static ThreadBuffer* getThreadBuffer();
+
+	static void record(const Event& event);
+};
+
+#define EVENT_TRACE_CONCAT_INNER(a, b) a##b
+#define EVENT_TRACE_CONCAT(a, b) EVENT_TRACE_CONCAT_INNER(a, b)
+
+///Trace the rest of the enclosing block as a complete event
+#define TRACE_SCOPE(...) EventTrace::Scope EVENT_TRACE_CONCAT(eventTraceScope, __LINE__)(__VA_ARGS__)
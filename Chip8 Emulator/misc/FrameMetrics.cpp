@@ -0,0 +1,322 @@
+#include "FrameMetrics.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+#include "EventTrace.h"
+#include "Log.h"
+
+namespace
+{
+	const char* phaseNames[FrameMetrics::PhaseCount] =
+	{
+		"eventHandler",
+		"passThroughInput",
+		"inputUpdate",
+		"emulation",
+		"render",
+		"audio",
+		"sleep",
+		"frame"
+	};
+}
+
+FrameMetrics::FrameMetrics()
+	: totalFrames(0), exportToSocket(false), exportIntervalMS(0), listenSocket(-1), snapshotPending(false), exportRunning(false)
+{
+	frameStart = phaseStart = windowStart = Clock::now();
+}
+
+FrameMetrics::~FrameMetrics()
+{
+	stopExportThread();
+	closeSocket();
+}
+
+bool FrameMetrics::setExportTarget(const std::string& target, unsigned int intervalMS)
+{
+	//The export thread reads the target, so it can only change while the thread is stopped
+	stopExportThread();
+	closeSocket();
+
+	exportIntervalMS = intervalMS;
+	exportToSocket = (target.compare(0, 5, "unix:") == 0);
+	exportPath = (exportToSocket ? target.substr(5) : target);
+
+	if (exportToSocket && !openSocket(exportPath))
+	{
+		exportPath.clear();
+		return false;
+	}
+
+	exportRunning = true;
+	exportThread = std::thread(&FrameMetrics::exportLoop, this);
+	return true;
+}
+
+void FrameMetrics::beginFrame()
+{
+	frameStart = phaseStart = Clock::now();
+}
+
+void FrameMetrics::endPhase(Phase phase)
+{
+	Clock::time_point now = Clock::now();
+	histograms[phase].record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - phaseStart).count());
+	phaseStart = now;
+}
+
+void FrameMetrics::endFrame()
+{
+	Clock::time_point now = Clock::now();
+	histograms[Frame].record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - frameStart).count());
+	totalFrames++;
+
+	if (exportPath.empty())
+		return;
+
+	if (std::chrono::duration_cast<std::chrono::milliseconds>(now - windowStart).count() >= exportIntervalMS)
+	{
+		//Only the copy happens here. A window the export thread hasn't picked up yet is replaced, so a
+		//stalled export drops windows rather than stalling the frame.
+		{
+			std::lock_guard<std::mutex> lock(exportMutex);
+			takeSnapshot(pendingSnapshot);
+			snapshotPending = true;
+		}
+
+		exportWake.notify_one();
+
+		for (auto& histogram : histograms)
+			histogram.reset();
+
+		windowStart = now;
+	}
+}
+
+std::string FrameMetrics::generateJSON()
+{
+	Snapshot snapshot;
+	takeSnapshot(snapshot);
+
+	return formatJSON(snapshot);
+}
+
+void FrameMetrics::takeSnapshot(Snapshot& snapshot) const
+{
+	for (int i = 0; i < PhaseCount; i++)
+		snapshot.histograms[i] = histograms[i];
+
+	snapshot.totalFrames = totalFrames;
+	snapshot.timestampMS = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	snapshot.windowMS = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - windowStart).count();
+}
+
+std::string FrameMetrics::formatJSON(const Snapshot& snapshot)
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+
+	ss << "{" << std::endl;
+	ss << "  \"timestampMS\": " << snapshot.timestampMS << "," << std::endl;
+	ss << "  \"windowMS\": " << snapshot.windowMS << "," << std::endl;
+	ss << "  \"totalFrames\": " << snapshot.totalFrames << "," << std::endl;
+	ss << "  \"phases\": {";
+
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		const Histogram& histogram = snapshot.histograms[i];
+
+		//Reported in microseconds, recorded in nanoseconds
+		ss << (i == 0 ? "" : ",") << std::endl << "    \"" << phaseNames[i] << "\": {"
+			<< " \"count\": " << histogram.getCount()
+			<< ", \"meanUS\": " << histogram.getMean() / 1000.0
+			<< ", \"p50US\": " << histogram.getPercentile(50) / 1000.0
+			<< ", \"p99US\": " << histogram.getPercentile(99) / 1000.0
+			<< ", \"maxUS\": " << histogram.getMax() / 1000.0 << " }";
+	}
+
+	ss << std::endl << "  }" << std::endl << "}" << std::endl;
+
+	return ss.str();
+}
+
+const char* FrameMetrics::getPhaseName(Phase phase)
+{
+	return phaseNames[phase];
+}
+
+void FrameMetrics::exportLoop()
+{
+	EventTrace::setThreadName("Metrics Export");
+
+	Snapshot snapshot;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(exportMutex);
+			exportWake.wait(lock, [this]() { return snapshotPending || !exportRunning; });
+
+			//Stopping, and the last window has already been exported
+			if (!snapshotPending)
+				break;
+
+			snapshot = pendingSnapshot;
+			snapshotPending = false;
+		}
+
+		exportMetrics(formatJSON(snapshot));
+	}
+}
+
+void FrameMetrics::stopExportThread()
+{
+	if (!exportThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(exportMutex);
+		exportRunning = false;
+	}
+
+	exportWake.notify_one();
+	exportThread.join();
+}
+
+void FrameMetrics::exportMetrics(const std::string& json)
+{
+	if (exportToSocket)
+		serveSocket(json);
+	else
+		writeFile(json);
+}
+
+void FrameMetrics::writeFile(const std::string& json)
+{
+	std::string tempPath = exportPath + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			LOG_W_LIMITED("Could not write metrics file: " + tempPath);
+			return;
+		}
+
+		file << json;
+	}
+
+	//rename won't replace an existing file on Windows
+#ifdef _WIN32
+	remove(exportPath.c_str());
+#endif
+
+	if (rename(tempPath.c_str(), exportPath.c_str()) != 0)
+	{
+		LOG_W_LIMITED("Could not replace metrics file: " + exportPath);
+	}
+}
+
+#ifndef _WIN32
+
+bool FrameMetrics::openSocket(const std::string& path)
+{
+	sockaddr_un address;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		LOG_E("Metrics socket path is too long: " + path);
+		return false;
+	}
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+	{
+		LOG_E("Could not create metrics socket: " + std::string(strerror(errno)));
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+	//Clear out a socket left behind by a previous run
+	unlink(path.c_str());
+
+	if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 8) != 0)
+	{
+		LOG_E("Could not listen on metrics socket " + path + ": " + strerror(errno));
+		closeSocket();
+		return false;
+	}
+
+	//Never block the frame waiting on the monitoring agent
+	fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK);
+
+	LOG_I("Serving frame metrics on: " + path);
+	return true;
+}
+
+void FrameMetrics::serveSocket(const std::string& json)
+{
+	if (listenSocket < 0)
+		return;
+
+#ifdef MSG_NOSIGNAL
+	const int sendFlags = MSG_NOSIGNAL;
+#else
+	const int sendFlags = 0;
+#endif
+
+	for (;;)
+	{
+		int client = accept(listenSocket, nullptr, nullptr);
+		if (client < 0)
+			break;
+
+		//Small enough to fit in the socket buffer, a slow reader just gets a truncated copy
+		fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+		send(client, json.data(), json.size(), sendFlags);
+		close(client);
+	}
+}
+
+void FrameMetrics::closeSocket()
+{
+	if (listenSocket >= 0)
+	{
+		close(listenSocket);
+		unlink(exportPath.c_str());
+		listenSocket = -1;
+	}
+}
+
+#else
+
+bool FrameMetrics::openSocket(const std::string&)
+{
+	LOG_E("Unix domain socket metrics export is not supported on this platform");
+	return false;
+}
+
+void FrameMetrics::serveSocket(const std::string&)
+{
+}
+
+void FrameMetrics::closeSocket()
+{
+}
+
+#endif // _WIN32
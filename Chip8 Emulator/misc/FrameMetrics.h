@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Histogram.h"
+
+/**
+@brief Times each phase of the host loop and periodically exports the results as JSON.
+
+Call beginFrame() at the top of the loop, endPhase() after each phase and endFrame() at the
+bottom. Every export interval the p50/p99/max of each phase are written to a file, or served
+to anything that connects to a Unix domain socket, and the histograms start over. The frame
+thread only copies the histograms, formatting and IO happen on a background export thread.
+*/
+class FrameMetrics
+{
+public:
+	/** @brief The timed phases of the host loop. */
+	enum Phase
+	{
+		EventHandler,
+		PassThroughInput,
+		InputUpdate,
+		Emulation,
+		Render,
+		Audio,
+		Sleep,
+		Frame, ///< The whole frame, recorded by endFrame()
+
+		PhaseCount
+	};
+
+	FrameMetrics();
+
+	~FrameMetrics();
+
+	/**
+	@brief Set where metrics are exported to.
+
+	@param target     A file path, or "unix:<path>" to serve them on a Unix domain socket.
+	@param intervalMS How often the metrics are exported.
+
+	@return bool - Was successful.
+	*/
+	bool setExportTarget(const std::string& target, unsigned int intervalMS);
+
+	/** @brief Start timing a frame. */
+	void beginFrame();
+
+	/** @brief Record the time since the previous phase (or the frame start) against a phase. */
+	void endPhase(Phase phase);
+
+	/** @brief Record the whole frame time, exporting if the interval has passed. */
+	void endFrame();
+
+	/** @brief The current window's metrics as JSON. */
+	std::string generateJSON();
+
+	static const char* getPhaseName(Phase phase);
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	/** @brief One export window's metrics, handed from the frame thread to the export thread. */
+	struct Snapshot
+	{
+		Histogram histograms[PhaseCount];
+		unsigned long long totalFrames;
+		long long timestampMS;
+		long long windowMS;
+	};
+
+	Clock::time_point frameStart;
+	Clock::time_point phaseStart;
+	Clock::time_point windowStart;
+
+	/** @brief Phase durations in nanoseconds. */
+	Histogram histograms[PhaseCount];
+
+	unsigned long long totalFrames;
+
+	std::string exportPath;
+	bool exportToSocket;
+	unsigned int exportIntervalMS;
+
+	/** @brief Listening socket when serving over a Unix domain socket, -1 otherwise. */
+	int listenSocket;
+
+	std::thread exportThread;
+	std::mutex exportMutex;
+	std::condition_variable exportWake;
+
+	/** @brief The latest window waiting to be exported, guarded by exportMutex. */
+	Snapshot pendingSnapshot;
+	bool snapshotPending;
+	bool exportRunning;
+
+	void takeSnapshot(Snapshot& snapshot) const;
+
+	static std::string formatJSON(const Snapshot& snapshot);
+
+	/** @brief Export thread, writes each snapshot as it arrives. */
+	void exportLoop();
+
+	/** @brief Export anything pending and stop the export thread. */
+	void stopExportThread();
+
+	void exportMetrics(const std::string& json);
+
+	/** @brief Replace the export file, via a rename so readers never see a partial file. */
+	void writeFile(const std::string& json);
+
+	/** @brief Send the JSON to every connection waiting on the socket. */
+	void serveSocket(const std::string& json);
+
+	bool openSocket(const std::string& path);
+
+	void closeSocket();
+};
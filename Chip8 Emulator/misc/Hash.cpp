@@ -0,0 +1,111 @@
+#include "Hash.h"
+
+#include <cstring>
+
+namespace
+{
+	const uint64_t PRIME1 = 11400714785074694791ULL;
+	const uint64_t PRIME2 = 14029467366897019727ULL;
+	const uint64_t PRIME3 = 1609587929392839161ULL;
+	const uint64_t PRIME4 = 9650029242287828579ULL;
+	const uint64_t PRIME5 = 2870177450012600261ULL;
+
+	inline uint64_t rotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	//Unaligned little endian reads, memcpy compiles down to a single load
+	inline uint64_t read64(const unsigned char* bytes)
+	{
+		uint64_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t read32(const unsigned char* bytes)
+	{
+		uint32_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * PRIME2;
+		accumulator = rotateLeft(accumulator, 31);
+		return accumulator * PRIME1;
+	}
+
+	inline uint64_t mergeRound(uint64_t accumulator, uint64_t value)
+	{
+		accumulator ^= round(0, value);
+		return accumulator * PRIME1 + PRIME4;
+	}
+}
+
+uint64_t Hash::xxh64(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned char* end = bytes + size;
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		const unsigned char* limit = end - 32;
+
+		uint64_t v1 = seed + PRIME1 + PRIME2;
+		uint64_t v2 = seed + PRIME2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME1;
+
+		do
+		{
+			v1 = round(v1, read64(bytes));
+			v2 = round(v2, read64(bytes + 8));
+			v3 = round(v3, read64(bytes + 16));
+			v4 = round(v4, read64(bytes + 24));
+			bytes += 32;
+		} while (bytes <= limit);
+
+		hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+		hash = mergeRound(hash, v1);
+		hash = mergeRound(hash, v2);
+		hash = mergeRound(hash, v3);
+		hash = mergeRound(hash, v4);
+	}
+	else
+	{
+		hash = seed + PRIME5;
+	}
+
+	hash += (uint64_t)size;
+
+	for (; bytes + 8 <= end; bytes += 8)
+	{
+		hash ^= round(0, read64(bytes));
+		hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+	}
+
+	if (bytes + 4 <= end)
+	{
+		hash ^= (uint64_t)read32(bytes) * PRIME1;
+		hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+		bytes += 4;
+	}
+
+	for (; bytes < end; bytes++)
+	{
+		hash ^= (*bytes) * PRIME5;
+		hash = rotateLeft(hash, 11) * PRIME1;
+	}
+
+	//Avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hash
+{
+	///64 bit XXH64 hash of a block of memory, used to identify content such as ROM images
+	uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0);
+
+	///Zobrist key for a value held at a location in some larger state, hashes of the whole state are the XOR
+	///of the keys of every location. Keys are mixed on the fly rather than stored in tables, and a value of 0
+	///has a key of 0 so zeroed state hashes to 0.
+	inline uint64_t zobrist(uint32_t location, uint32_t value)
+	{
+		if (value == 0)
+			return 0;
+
+		//SplitMix64 finaliser
+		uint64_t key = ((uint64_t)location << 32 | value) + 0x9E3779B97F4A7C15ULL;
+		key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+		return key ^ (key >> 31);
+	}
+}
@@ -0,0 +1,85 @@
+#include "Histogram.h"
+
+#include <algorithm>
+
+#include "Utility.h"
+
+const int Histogram::EXACT_BUCKETS;
+const int Histogram::SUB_BUCKET_BITS;
+const int Histogram::SUB_BUCKETS;
+const int Histogram::BUCKET_COUNT;
+
+Histogram::Histogram()
+{
+	reset();
+}
+
+void Histogram::reset()
+{
+	std::fill(buckets, buckets + BUCKET_COUNT, 0ULL);
+	count = sum = max = 0;
+	min = UINT64_MAX;
+}
+
+void Histogram::record(uint64_t value)
+{
+	buckets[getBucketIndex(value)]++;
+	count++;
+	sum += value;
+	min = std::min(min, value);
+	max = std::max(max, value);
+}
+
+void Histogram::merge(const Histogram& other)
+{
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		buckets[i] += other.buckets[i];
+
+	count += other.count;
+	sum += other.sum;
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+}
+
+uint64_t Histogram::getPercentile(double percentile) const
+{
+	if (count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)((percentile / 100.0) * count + 0.5);
+	target = std::max<uint64_t>(target, 1);
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += buckets[i];
+		if (seen >= target)
+			return std::min(getBucketUpperBound(i), max);
+	}
+
+	return max;
+}
+
+int Histogram::getBucketIndex(uint64_t value)
+{
+	if (value < EXACT_BUCKETS)
+		return (int)value;
+
+	//Top bit picks the power of two, the next 3 bits pick the bucket within it
+	int exponent = Utility::highestSetBit(value);
+	int subBucket = (int)(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+
+	return EXACT_BUCKETS + (exponent - 4) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t Histogram::getBucketUpperBound(int index)
+{
+	if (index < EXACT_BUCKETS)
+		return (uint64_t)index;
+
+	int exponent = (index - EXACT_BUCKETS) / SUB_BUCKETS + 4;
+	uint64_t subBucket = (uint64_t)((index - EXACT_BUCKETS) % SUB_BUCKETS);
+	uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+
+	return (SUB_BUCKETS + subBucket) * width + (width - 1);
+}
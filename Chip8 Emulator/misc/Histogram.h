@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+@brief Fixed size log-linear histogram for timings and other positive integers.
+
+Values below 16 are counted exactly, above that each power of two is split into 8 buckets,
+so percentiles are within 12.5% of the true value. Recording is a few integer ops into a
+fixed array and never allocates.
+*/
+class Histogram
+{
+public:
+	Histogram();
+
+	/** @brief Clear all recorded values. */
+	void reset();
+
+	/** @brief Record a value. */
+	void record(uint64_t value);
+
+	/** @brief Merge another histogram's values into this one. */
+	void merge(const Histogram& other);
+
+	/**
+	@brief Gets the value at the requested percentile.
+
+	@param percentile Between 0 and 100.
+
+	@return The upper bound of the bucket holding the percentile, capped at the max recorded. 0 if empty.
+	*/
+	uint64_t getPercentile(double percentile) const;
+
+	uint64_t getCount() const { return count; }
+
+	uint64_t getMax() const { return max; }
+
+	uint64_t getMin() const { return (count > 0 ? min : 0); }
+
+	double getMean() const { return (count > 0 ? (double)sum / count : 0.0); }
+
+private:
+
+	static const int EXACT_BUCKETS = 16;
+	static const int SUB_BUCKET_BITS = 3;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int BUCKET_COUNT = EXACT_BUCKETS + (64 - 4) * SUB_BUCKETS;
+
+	uint64_t buckets[BUCKET_COUNT];
+
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+
+	static int getBucketIndex(uint64_t value);
+
+	static uint64_t getBucketUpperBound(int index);
+};
@@ -0,0 +1,331 @@
+#include "Kernels.h"
+
+#include <cstring>
+
+#include "CpuFeatures.h"
+#include "Log.h"
+#include "Utility.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+//GCC and Clang only allow intrinsics for extensions a function is compiled for
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_TARGET(extensions) __attribute__((target(extensions)))
+#else
+#define KERNEL_TARGET(extensions)
+#endif
+
+namespace
+{
+	void expandFramebufferScalar(const unsigned char* pixels, unsigned char* rgba, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned char pixel = pixels[i] * 255;
+
+			rgba[i * 4] = pixel;
+			rgba[i * 4 + 1] = pixel;
+			rgba[i * 4 + 2] = pixel;
+			rgba[i * 4 + 3] = 0;
+		}
+	}
+
+	bool xorSpriteRowScalar(unsigned char* pixels, uint8_t bits)
+	{
+		bool collision = false;
+
+		for (int i = 0; i < 8; i++)
+		{
+			unsigned char bit = (bits >> (7 - i)) & 1;
+
+			collision |= (pixels[i] & bit) != 0;
+			pixels[i] ^= bit;
+		}
+
+		return collision;
+	}
+
+	size_t findDifferenceScalar(const unsigned char* a, const unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+
+		//Compare a word at a time, then find the byte within the word that differs
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t wordA, wordB;
+			memcpy(&wordA, a + i, 8);
+			memcpy(&wordB, b + i, 8);
+
+			if (wordA != wordB)
+				break;
+		}
+
+		for (; i < size; i++)
+		{
+			if (a[i] != b[i])
+				return i;
+		}
+
+		return size;
+	}
+
+#ifdef KERNELS_X86
+	//Only whole vectors are handled by the SIMD variants, they finish any remainder with the scalar kernel
+
+	KERNEL_TARGET("sse2")
+	void expandFramebufferSSE2(const unsigned char* pixels, unsigned char* rgba, size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+		size_t i = 0;
+
+		for (; i + 16 <= count; i += 16)
+		{
+			//0 - 1 gives 0xFF, then widen each byte to 4 by unpacking it with itself twice
+			__m128i lit = _mm_sub_epi8(zero, _mm_loadu_si128((const __m128i*)(pixels + i)));
+			__m128i low = _mm_unpacklo_epi8(lit, lit);
+			__m128i high = _mm_unpackhi_epi8(lit, lit);
+
+			__m128i* out = (__m128i*)(rgba + i * 4);
+			_mm_storeu_si128(out, _mm_and_si128(_mm_unpacklo_epi16(low, low), rgbMask));
+			_mm_storeu_si128(out + 1, _mm_and_si128(_mm_unpackhi_epi16(low, low), rgbMask));
+			_mm_storeu_si128(out + 2, _mm_and_si128(_mm_unpacklo_epi16(high, high), rgbMask));
+			_mm_storeu_si128(out + 3, _mm_and_si128(_mm_unpackhi_epi16(high, high), rgbMask));
+		}
+
+		expandFramebufferScalar(pixels + i, rgba + i * 4, count - i);
+	}
+
+	KERNEL_TARGET("ssse3")
+	void expandFramebufferSSSE3(const unsigned char* pixels, unsigned char* rgba, size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		//Each output dword takes its RGB from one input byte, a -1 index writes zero for alpha
+		const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+		const __m128i shuffle1 = _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+		const __m128i shuffle2 = _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1);
+		const __m128i shuffle3 = _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+
+		size_t i = 0;
+
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i lit = _mm_sub_epi8(zero, _mm_loadu_si128((const __m128i*)(pixels + i)));
+
+			__m128i* out = (__m128i*)(rgba + i * 4);
+			_mm_storeu_si128(out, _mm_shuffle_epi8(lit, shuffle0));
+			_mm_storeu_si128(out + 1, _mm_shuffle_epi8(lit, shuffle1));
+			_mm_storeu_si128(out + 2, _mm_shuffle_epi8(lit, shuffle2));
+			_mm_storeu_si128(out + 3, _mm_shuffle_epi8(lit, shuffle3));
+		}
+
+		expandFramebufferScalar(pixels + i, rgba + i * 4, count - i);
+	}
+
+	KERNEL_TARGET("avx2")
+	void expandFramebufferAVX2(const unsigned char* pixels, unsigned char* rgba, size_t count)
+	{
+		const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			//Pixels are 0 or 1, so widening to dwords and multiplying gives the colour directly
+			__m256i wide = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pixels + i)));
+			_mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_mullo_epi32(wide, rgb));
+		}
+
+		expandFramebufferScalar(pixels + i, rgba + i * 4, count - i);
+	}
+
+	KERNEL_TARGET("avx512f")
+	void expandFramebufferAVX512(const unsigned char* pixels, unsigned char* rgba, size_t count)
+	{
+		const __m512i rgb = _mm512_set1_epi32(0x00FFFFFF);
+		size_t i = 0;
+
+		for (; i + 16 <= count; i += 16)
+		{
+			__m512i wide = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(pixels + i)));
+			_mm512_storeu_si512((void*)(rgba + i * 4), _mm512_mullo_epi32(wide, rgb));
+		}
+
+		expandFramebufferScalar(pixels + i, rgba + i * 4, count - i);
+	}
+
+	KERNEL_TARGET("sse2")
+	bool xorSpriteRowSSE2(unsigned char* pixels, uint8_t bits)
+	{
+		//Spread the bits across 8 bytes by testing each against its own mask, most significant first
+		const __m128i masks = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0, 0, 0, 0, 0, 0, 0, 0);
+		const __m128i one = _mm_set1_epi8(1);
+
+		__m128i selected = _mm_and_si128(_mm_set1_epi8((char)bits), masks);
+		__m128i sprite = _mm_and_si128(_mm_cmpeq_epi8(selected, masks), one);
+
+		__m128i screen = _mm_loadl_epi64((const __m128i*)pixels);
+		_mm_storel_epi64((__m128i*)pixels, _mm_xor_si128(screen, sprite));
+
+		//The upper 8 bytes are zero in both, so they never count as a collision
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(screen, sprite), _mm_setzero_si128())) != 0xFFFF;
+	}
+
+	KERNEL_TARGET("sse2")
+	size_t findDifferenceSSE2(const unsigned char* a, const unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+			unsigned int differing = ~(unsigned int)_mm_movemask_epi8(equal) & 0xFFFF;
+
+			if (differing != 0)
+				return i + Utility::lowestSetBit(differing);
+		}
+
+		return i + findDifferenceScalar(a + i, b + i, size - i);
+	}
+
+	KERNEL_TARGET("avx2")
+	size_t findDifferenceAVX2(const unsigned char* a, const unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+
+		for (; i + 32 <= size; i += 32)
+		{
+			__m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+			unsigned int differing = ~(unsigned int)_mm256_movemask_epi8(equal);
+
+			if (differing != 0)
+				return i + Utility::lowestSetBit(differing);
+		}
+
+		return i + findDifferenceScalar(a + i, b + i, size - i);
+	}
+
+	KERNEL_TARGET("avx512f,avx512bw")
+	size_t findDifferenceAVX512(const unsigned char* a, const unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+
+		for (; i + 64 <= size; i += 64)
+		{
+			uint64_t differing = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void*)(a + i)), _mm512_loadu_si512((const void*)(b + i)));
+
+			if (differing != 0)
+				return i + Utility::lowestSetBit(differing);
+		}
+
+		return i + findDifferenceScalar(a + i, b + i, size - i);
+	}
+#endif
+
+	//Variant tables, indexed by Kernels::Variant, a null entry means the kernel has no such variant
+#ifdef KERNELS_X86
+	const Kernels::ExpandFunction expandVariants[Kernels::VariantCount] = {
+		expandFramebufferScalar, expandFramebufferSSE2, expandFramebufferSSSE3, expandFramebufferAVX2, expandFramebufferAVX512
+	};
+
+	//8 pixels fit in the low half of an SSE register, wider registers don't help
+	const Kernels::SpriteRowFunction spriteRowVariants[Kernels::VariantCount] = {
+		xorSpriteRowScalar, xorSpriteRowSSE2, nullptr, nullptr, nullptr
+	};
+
+	const Kernels::DiffFunction diffVariants[Kernels::VariantCount] = {
+		findDifferenceScalar, findDifferenceSSE2, nullptr, findDifferenceAVX2, findDifferenceAVX512
+	};
+#else
+	const Kernels::ExpandFunction expandVariants[Kernels::VariantCount] = { expandFramebufferScalar };
+	const Kernels::SpriteRowFunction spriteRowVariants[Kernels::VariantCount] = { xorSpriteRowScalar };
+	const Kernels::DiffFunction diffVariants[Kernels::VariantCount] = { findDifferenceScalar };
+#endif
+
+	///The best supported entry in a variant table
+	template<typename Function>
+	Function selectBest(const Function (&variants)[Kernels::VariantCount], const char* kernel)
+	{
+		for (int variant = Kernels::VariantCount - 1; variant > Kernels::ScalarVariant; variant--)
+		{
+			if (variants[variant] != nullptr && Kernels::isSupported((Kernels::Variant)variant))
+			{
+				LOG_I(std::string(" - ") + kernel + ": " + Kernels::getVariantName((Kernels::Variant)variant));
+				return variants[variant];
+			}
+		}
+
+		LOG_I(std::string(" - ") + kernel + ": " + Kernels::getVariantName(Kernels::ScalarVariant));
+		return variants[Kernels::ScalarVariant];
+	}
+}
+
+Kernels::ExpandFunction Kernels::expandFramebuffer = expandFramebufferScalar;
+Kernels::SpriteRowFunction Kernels::xorSpriteRow = xorSpriteRowScalar;
+Kernels::DiffFunction Kernels::findDifference = findDifferenceScalar;
+
+Kernels::Kernels()
+{
+
+}
+
+void Kernels::resolve()
+{
+	LOG_I("Kernel Variants:");
+
+	expandFramebuffer = selectBest(expandVariants, "Framebuffer expand");
+	xorSpriteRow = selectBest(spriteRowVariants, "Sprite row");
+	findDifference = selectBest(diffVariants, "Buffer difference");
+}
+
+Kernels::ExpandFunction Kernels::getExpandFramebuffer(Variant variant)
+{
+	return isSupported(variant) ? expandVariants[variant] : nullptr;
+}
+
+Kernels::SpriteRowFunction Kernels::getXorSpriteRow(Variant variant)
+{
+	return isSupported(variant) ? spriteRowVariants[variant] : nullptr;
+}
+
+Kernels::DiffFunction Kernels::getFindDifference(Variant variant)
+{
+	return isSupported(variant) ? diffVariants[variant] : nullptr;
+}
+
+bool Kernels::isSupported(Variant variant)
+{
+	switch (variant)
+	{
+	case ScalarVariant:
+		return true;
+
+	case SSE2Variant:
+		return CpuFeatures::has(CpuFeatures::SSE2);
+
+	case SSSE3Variant:
+		return CpuFeatures::has(CpuFeatures::SSSE3);
+
+	case AVX2Variant:
+		return CpuFeatures::has(CpuFeatures::AVX2);
+
+	case AVX512Variant:
+		return CpuFeatures::has(CpuFeatures::AVX512F) && CpuFeatures::has(CpuFeatures::AVX512BW);
+
+	default:
+		return false;
+	}
+}
+
+const char* Kernels::getVariantName(Variant variant)
+{
+	static const char* names[VariantCount] = { "Scalar", "SSE2", "SSSE3", "AVX2", "AVX-512" };
+
+	if (variant < 0 || variant >= VariantCount)
+		return "Unknown";
+
+	return names[variant];
+}
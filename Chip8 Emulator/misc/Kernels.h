@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+@brief Hot pixel loops, each with variants for several instruction sets.
+
+Every kernel is called through a function pointer. The pointers start on the portable scalar
+variant, and resolve() moves each one to the best variant the host supports, so callers pay
+one indirect call and no feature checks. Not every kernel has every variant; a kernel only
+gets a variant when the wider registers actually help it.
+*/
+class Kernels
+{
+public:
+	/** @brief Instruction set variants, from slowest to fastest. */
+	enum Variant
+	{
+		ScalarVariant,
+		SSE2Variant,
+		SSSE3Variant,
+		AVX2Variant,
+		AVX512Variant,
+
+		VariantCount
+	};
+
+	///Expand one byte per pixel (0 or 1) into black or white RGBA32, alpha is left at 0
+	typedef void (*ExpandFunction)(const unsigned char* pixels, unsigned char* rgba, size_t count);
+
+	///XOR 8 sprite bits, most significant first, into 8 pixels. Returns true if a lit pixel was cleared
+	typedef bool (*SpriteRowFunction)(unsigned char* pixels, uint8_t bits);
+
+	///Offset of the first byte that differs between two buffers, or size if they are equal
+	typedef size_t (*DiffFunction)(const unsigned char* a, const unsigned char* b, size_t size);
+
+	static ExpandFunction expandFramebuffer;
+	static SpriteRowFunction xorSpriteRow;
+	static DiffFunction findDifference;
+
+	/** @brief Point every kernel at the best variant the host supports. Safe to call more than once. */
+	static void resolve();
+
+	/**
+	@brief Look up a specific variant, used to compare them against each other.
+
+	@return nullptr if the kernel has no such variant or the host can't run it.
+	*/
+	static ExpandFunction getExpandFramebuffer(Variant variant);
+	static SpriteRowFunction getXorSpriteRow(Variant variant);
+	static DiffFunction getFindDifference(Variant variant);
+
+	/** @brief Can the host run a variant. */
+	static bool isSupported(Variant variant);
+
+	static const char* getVariantName(Variant variant);
+
+private:
+	Kernels();
+};
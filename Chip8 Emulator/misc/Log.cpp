@@ -1,10 +1,27 @@
 #include "Log.h"
 
 #include <time.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 
+#include "EventTrace.h"
+
 bool Log::initialized = false;
 std::ofstream Log::logFile;
+const size_t Log::QUEUE_CAPACITY;
+MPSCQueue<Log::Record> Log::queue(Log::QUEUE_CAPACITY);
+std::thread Log::writerThread;
+std::atomic<bool> Log::writerRunning(false);
+std::atomic<bool> Log::writerSleeping(false);
+std::mutex Log::writerMutex;
+std::condition_variable Log::writerWake;
+std::mutex Log::outputMutex;
+bool Log::writerStopped = true;
+std::atomic<Log::RateLimiter*> Log::RateLimiter::head(nullptr);
+const unsigned int Log::RateLimiter::MAX_PER_WINDOW;
+const long long Log::RateLimiter::WINDOW_MS;
 
 bool Log::init(bool fileOutput, std::string org, std::string app)
 {
@@ -27,25 +44,8 @@ bool Log::init(bool fileOutput, std::string org, std::string app)
 			SDL_free(basePath);
 
 			//Get current time and date
-			time_t currentTime = time(NULL);
-
 			char textTime[20];
-
-	#ifdef _MSC_VER
-			//Because Microsoft like to be different they depreciated the normal localtime(), and most compilers implement localtime_r() not _s
-			tm timeStruct;
-			localtime_s(&timeStruct, &currentTime);
-
-			strftime(textTime, 20, "%Y-%m-%d %H-%M-%S", &timeStruct);
-
-	#else
-
-			tm* timeStruct;
-			timeStruct = localtime(&currentTime);
-
-			strftime(textTime, 20, "%Y-%m-%d %H-%M-%S", timeStruct); //Apparently only Microsoft don't support the %T.
-
-	#endif
+			formatTime(time(NULL), "%Y-%m-%d %H-%M-%S", textTime, sizeof(textTime));
 
 			filename = textTime;
 			filename += " Log.log";
@@ -54,111 +54,360 @@ bool Log::init(bool fileOutput, std::string org, std::string app)
 			logFile.open(path, std::ios::out | std::ios::app);
 
 			if (!logFile.is_open())
-				Log::logW("Log File Could not be opened, console output only.");
+				LOG_W("Log File Could not be opened, console output only.");
 		}
+
+		writerStopped = false;
+		writerRunning = true;
+		writerThread = std::thread(&Log::writerLoop);
+
+		//Makes sure queued messages are written even if the program exits early
+		std::atexit(&Log::cleanup);
 	}
 	else
 	{
-		Log::logW("Log SubSystem already initialized");
+		LOG_W("Log SubSystem already initialized");
 		return true;
 	}
 
 #endif // __ANDROID__
 
-	Log::logI("Log SubSystem Initialised");
+	LOG_I("Log SubSystem Initialised");
 	initialized = true;
 	return true;
 }
 
 void Log::cleanup()
 {
+	RateLimiter::reportAllSuppressed();
+
+	if (writerThread.joinable())
+	{
+		writerRunning = false;
+		writerWake.notify_one();
+		writerThread.join();
+	}
+
+	drainStragglers();
+
+	//Threads still logging from here on only reach the console
+	std::lock_guard<std::mutex> lock(outputMutex);
 	logFile.close();
 }
 
 void Log::log(LogType type, std::string message)
 {
-	//Get current time
-	time_t currentTime = time(NULL);
-
-	char textTime[9];
+	Record record;
+	record.time = time(NULL);
+	record.text = nullptr;
+	record.value = 0;
+	record.hex = false;
 
-#ifdef _MSC_VER
-	//Because Microsoft like to be different they depreciated the normal localtime(), and most compilers implement localtime_r() not _s
-	tm timeStruct;
-	localtime_s(&timeStruct, &currentTime);
-
-	strftime(textTime, 9, "%H:%M:%S", &timeStruct);
+	switch (type)
+	{
+	case D:
+	#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+		record.priority = SDL_LOG_PRIORITY_DEBUG;
+		record.message = std::move(message);
+		break;
+	#else
+		return;
+	#endif
+	case I:
+		record.priority = SDL_LOG_PRIORITY_INFO;
+		record.message = std::move(message);
+		break;
 
-#else
+	case W:
+		record.priority = SDL_LOG_PRIORITY_WARN;
+		record.message = std::move(message);
+		break;
 
-	tm* timeStruct;
-	timeStruct = localtime(&currentTime);
+	case E:
+		record.priority = SDL_LOG_PRIORITY_ERROR;
+		record.message = std::move(message);
+		break;
 
-	strftime(textTime, 9, "%T", timeStruct); //Apparently only Microsoft don't support the %T.
+	default:
+		record.priority = SDL_LOG_PRIORITY_INFO;
+		record.message = "Uncategorised: " + message;
+		break;
+	}
 
-#endif
+	submit(std::move(record));
+}
 
-	std::string finalMsg = textTime;
+void Log::log(LogType type, const char* text, unsigned long long value, bool hex)
+{
+	Record record;
+	record.time = time(NULL);
+	record.text = text;
+	record.value = value;
+	record.hex = hex;
 
 	switch (type)
 	{
 	case D:
-	#ifdef _DEBUG
-		finalMsg += (" " + message);
-		//Have to use category Test as Debug messages are not printed for Application.
-		SDL_LogDebug(SDL_LOG_CATEGORY_TEST, "%s", finalMsg.c_str());
-	#endif // NDEBUG
+	#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+		record.priority = SDL_LOG_PRIORITY_DEBUG;
 		break;
+	#else
+		return;
+	#endif
 	case I:
-		finalMsg += (" " + message);
-		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s", finalMsg.c_str());
+		record.priority = SDL_LOG_PRIORITY_INFO;
 		break;
 
 	case W:
-		finalMsg += (" " + message);
-		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%s", finalMsg.c_str());
+		record.priority = SDL_LOG_PRIORITY_WARN;
 		break;
 
 	case E:
-		finalMsg += (" " + message);
-		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", finalMsg.c_str());
+		record.priority = SDL_LOG_PRIORITY_ERROR;
 		break;
 
 	default:
-		finalMsg += (" Uncategorised: " + message);
-		SDL_Log("%s", finalMsg.c_str());
+		record.priority = SDL_LOG_PRIORITY_INFO;
 		break;
-
 	}
+
+	submit(std::move(record));
 }
 
-void Log::logD(std::string message)
+void Log::LogOutputFunction(void*, int, SDL_LogPriority priority, const char * message)
 {
-	Log::log(Log::D, message);
+	//Only SDL's own messages arrive here now, ours are queued directly
+	Record record;
+	record.priority = priority;
+	record.time = time(NULL);
+	record.message = message;
+	record.text = nullptr;
+	record.value = 0;
+	record.hex = false;
+
+	submit(std::move(record));
 }
 
-void Log::logI(std::string message)
+void Log::submit(Record&& record)
 {
-	Log::log(Log::I, message);
+	if (writerRunning.load(std::memory_order_acquire))
+	{
+		//Only waits if the writer has fallen a whole queue behind
+		while (!queue.tryPush(std::move(record)))
+		{
+			//A writer that stopped meanwhile will never make room
+			if (!writerRunning.load(std::memory_order_acquire))
+				drainStragglers();
+
+			std::this_thread::yield();
+		}
+
+		if (writerSleeping.load(std::memory_order_relaxed))
+			writerWake.notify_one();
+
+		//The writer may have stopped between the check and the push, the record must not be left behind
+		if (!writerRunning.load(std::memory_order_acquire))
+			drainStragglers();
+
+		return;
+	}
+
+	std::string batch;
+	time_t cachedTime = 0;
+	char cachedText[9] = "";
+	formatRecord(record, batch, cachedTime, cachedText);
+
+#ifdef __ANDROID__
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, record.priority, "%s", batch.c_str());
+#else
+	//Stragglers were queued first so they are written first
+	drainStragglers();
+
+	std::lock_guard<std::mutex> lock(outputMutex);
+	writeBatch(batch);
+#endif // __ANDROID__
 }
 
-void Log::logW(std::string message)
+void Log::drainStragglers()
 {
-	Log::log(Log::W, message);
+	std::lock_guard<std::mutex> lock(outputMutex);
+
+	//The writer is still the queue's only consumer, it drains everything before it stops
+	if (!writerStopped)
+		return;
+
+	std::string batch;
+	time_t cachedTime = 0;
+	char cachedText[9] = "";
+	Record record;
+
+	while (queue.tryPop(record))
+	{
+		formatRecord(record, batch, cachedTime, cachedText);
+	}
+
+	if (!batch.empty())
+		writeBatch(batch);
 }
 
-void Log::logE(std::string message)
+void Log::writerLoop()
 {
-	Log::log(Log::E, message);
+	const size_t MAX_BATCH = 256;
+
+	EventTrace::setThreadName("Log Writer");
+
+	std::string batch;
+	time_t cachedTime = 0;
+	char cachedText[9] = "";
+	Record record;
+
+	for (;;)
+	{
+		//Read before draining so nothing queued before cleanup() is missed
+		bool running = writerRunning.load(std::memory_order_acquire);
+
+		batch.clear();
+		size_t count = 0;
+
+		while (count < MAX_BATCH && queue.tryPop(record))
+		{
+			formatRecord(record, batch, cachedTime, cachedText);
+			count++;
+		}
+
+		if (count > 0)
+		{
+			TRACE_SCOPE("writeLogBatch", "log", "messages", count);
+			std::lock_guard<std::mutex> lock(outputMutex);
+			writeBatch(batch);
+			continue;
+		}
+
+		if (!running)
+			break;
+
+		//A missed wake up only delays output until the timeout
+		std::unique_lock<std::mutex> lock(writerMutex);
+		writerSleeping = true;
+		writerWake.wait_for(lock, std::chrono::milliseconds(10));
+		writerSleeping = false;
+	}
+
+	//Hand the queue over. A push that landed after the last pop saw the writer as still alive and
+	//left it here, later pushes see writerStopped and drain themselves.
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		writerStopped = true;
+	}
+
+	drainStragglers();
 }
 
-void Log::LogOutputFunction(void*, int, SDL_LogPriority priority, const char * message)
+void Log::formatRecord(const Record& record, std::string& batch, time_t& cachedTime, char* cachedText)
+{
+	if (record.time != cachedTime || cachedText[0] == '\0')
+	{
+		cachedTime = record.time;
+		formatTime(record.time, "%H:%M:%S", cachedText, 9);
+	}
+
+	batch += convertSDL_LogPriority(record.priority);
+	batch += ": ";
+	batch += cachedText;
+	batch += ' ';
+
+	if (record.text != nullptr)
+	{
+		char number[24];
+		snprintf(number, sizeof(number), (record.hex ? "0x%llx" : "%llu"), record.value);
+
+		batch += record.text;
+		batch += number;
+	}
+	else
+	{
+		batch += record.message;
+	}
+
+	batch += '\n';
+}
+
+void Log::writeBatch(const std::string& batch)
 {
-	std::cout << convertSDL_LogPriority(priority) << ": " << message << std::endl;
+	std::cout.write(batch.data(), batch.size());
+	std::cout.flush();
 
 	if (logFile.is_open())
 	{
-		logFile << convertSDL_LogPriority(priority) << ": " << message << std::endl;
+		logFile.write(batch.data(), batch.size());
+		logFile.flush();
+	}
+}
+
+void Log::formatTime(time_t time, const char* format, char* output, size_t outputSize)
+{
+#ifdef _MSC_VER
+	//Because Microsoft like to be different they depreciated the normal localtime(), and most compilers implement localtime_r() not _s
+	tm timeStruct;
+	localtime_s(&timeStruct, &time);
+
+	strftime(output, outputSize, format, &timeStruct);
+
+#else
+
+	tm timeStruct;
+	localtime_r(&time, &timeStruct);
+
+	strftime(output, outputSize, format, &timeStruct);
+
+#endif
+}
+
+Log::RateLimiter::RateLimiter(const char* file, int line)
+	: file(file), line(line), windowStart(0), windowCount(0), suppressedCount(0)
+{
+	next = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+bool Log::RateLimiter::allow(unsigned long long& suppressed)
+{
+	long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	long long start = windowStart.load(std::memory_order_relaxed);
+	if (now - start >= WINDOW_MS && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+	{
+		windowCount.store(0, std::memory_order_relaxed);
+	}
+
+	if (windowCount.fetch_add(1, std::memory_order_relaxed) < MAX_PER_WINDOW)
+	{
+		suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+		return true;
+	}
+
+	suppressedCount.fetch_add(1, std::memory_order_relaxed);
+	suppressed = 0;
+	return false;
+}
+
+void Log::RateLimiter::logSuppressed(LogType type, unsigned long long suppressed)
+{
+	Log::log(type, "Suppressed " + std::to_string(suppressed) + " messages from " +
+		file + ":" + std::to_string(line));
+}
+
+void Log::RateLimiter::reportAllSuppressed()
+{
+	for (RateLimiter* limiter = head.load(std::memory_order_acquire); limiter != nullptr; limiter = limiter->next)
+	{
+		unsigned long long suppressed = limiter->suppressedCount.exchange(0, std::memory_order_relaxed);
+
+		if (suppressed > 0)
+			limiter->logSuppressed(Log::W, suppressed);
 	}
 }
 
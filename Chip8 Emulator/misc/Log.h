@@ -3,11 +3,21 @@
 #include <SDL.h>
 #include <string>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+
+#include "MPSCQueue.h"
 
 //Ref: Was used in previous assignment
 
 /** 
 @brief	Contains the Engine's logging features.
+
+Messages are queued and written to the console/log file in batches by a background thread,
+so logging never waits on console or disk IO.
 */
 class Log
 {
@@ -25,13 +35,16 @@ public:
 
 	static bool init(bool fileOutput, std::string org, std::string app);
 
+	/** @brief Stops the writer thread after it has written everything queued. Safe to call more than once. */
 	static void cleanup();
 
 	/**
 	@brief Log a message to the console
 
-	Made this one function instead of multiple to reduce clutter. Uses SDL_Log internally to make it
-	function on multiple platforms easily.
+	Made this one function instead of multiple to reduce clutter. The message is queued for the
+	writer thread, before init() or after cleanup() it is written immediately instead.
+	Called through the LOG_* macros, which compile out messages above LOG_LEVEL. Debug messages
+	are also dropped here unless LOG_LEVEL includes them.
 
 	@param type    Type of message E: Error, W: Warning, I: Info, D: Debug.
 	@param message The message to log.
@@ -39,41 +52,182 @@ public:
 	static void log(LogType type, std::string message);
 
 	/**
-	@brief Log a debug message to the console. Only displayed for a debug build.
+	@brief Log a string literal followed by a number, without building a string on the calling thread.
 
-	@param message The message to log.
+	Only the pointer to the text is queued and formatting happens on the writer thread, so this
+	is the one to use from hot paths.
+
+	@param type  Type of message E: Error, W: Warning, I: Info, D: Debug.
+	@param text  The message text, must be a string literal (or otherwise live until written).
+	@param value The number appended to the text.
+	@param hex   Print the number as hex instead of decimal.
 	*/
-	static void logD(std::string message);
+	static void log(LogType type, const char* text, unsigned long long value, bool hex = false);
+
+	static void LogOutputFunction(void* userdata, int category, SDL_LogPriority priority, const char* message);
 
 	/**
-	@brief Log a info message to the console
+	@brief Limits how often a single call site can log. Used through the LOG_*_LIMITED macros.
 
-	@param message The message to log.
+	Each call site gets its own static limiter that lets MAX_PER_WINDOW messages through per
+	WINDOW_MS, counting the rest. The count is logged as a summary with the next message let
+	through, and any still outstanding are reported by Log::cleanup().
 	*/
-	static void logI(std::string message);
+	class RateLimiter
+	{
+	public:
+		RateLimiter(const char* file, int line);
 
-	/**
-	@brief Log a warning message to the console
+		/**
+		@brief Should the call site log this time.
 
-	@param message The message to log.
-	*/
-	static void logW(std::string message);
+		@param [out] suppressed Messages suppressed since the last one let through.
 
-	/**
-	@brief Log a error message to the console
+		@return true if the message should be logged.
+		*/
+		bool allow(unsigned long long& suppressed);
 
-	@param message The message to log.
-	*/
-	static void logE(std::string message);
+		/** @brief Log a summary of suppressed messages for this call site. */
+		void logSuppressed(LogType type, unsigned long long suppressed);
 
+		/** @brief Log summaries for every call site that still has suppressed messages. */
+		static void reportAllSuppressed();
 
-	static void LogOutputFunction(void* userdata, int category, SDL_LogPriority priority, const char* message);
+	private:
+		static const unsigned int MAX_PER_WINDOW = 5;
+		static const long long WINDOW_MS = 1000;
+
+		const char* file;
+		int line;
+
+		std::atomic<long long> windowStart;
+		std::atomic<unsigned int> windowCount;
+		std::atomic<unsigned long long> suppressedCount;
+
+		/** @brief All limiters are kept in a list so cleanup can report them. */
+		RateLimiter* next;
+		static std::atomic<RateLimiter*> head;
+	};
 
 private:
-	
+
+	/** @brief A queued message. Either message or text/value is used. */
+	struct Record
+	{
+		SDL_LogPriority priority;
+		time_t time;
+		std::string message;
+		const char* text;
+		unsigned long long value;
+		bool hex;
+	};
+
+	/** @brief Max number of queued messages before callers have to wait for the writer. */
+	static const size_t QUEUE_CAPACITY = 8192;
+
 	static bool initialized;
 
 	static std::string convertSDL_LogPriority(SDL_LogPriority priority);
 
 	static std::ofstream logFile;
-};
\ No newline at end of file
+
+	static MPSCQueue<Record> queue;
+
+	static std::thread writerThread;
+
+	static std::atomic<bool> writerRunning;
+
+	static std::atomic<bool> writerSleeping;
+
+	static std::mutex writerMutex;
+
+	static std::condition_variable writerWake;
+
+	/** @brief Owns the console and log file, and the queue once the writer thread has stopped. */
+	static std::mutex outputMutex;
+
+	/** @brief Set by the writer thread as it exits, guarded by outputMutex. */
+	static bool writerStopped;
+
+	/** @brief Queue a record, or write it straight away if the writer thread isn't running. */
+	static void submit(Record&& record);
+
+	/**
+	@brief Write anything still queued after the writer thread stopped, e.g. from a thread that
+	checked writerRunning just before cleanup() cleared it. Does nothing while the writer is alive.
+	*/
+	static void drainStragglers();
+
+	/** @brief Writer thread, drains the queue in batches. */
+	static void writerLoop();
+
+	/**
+	@brief Append a formatted record to a batch.
+
+	Timestamps are only reformatted when the second changes, so localtime/strftime are not
+	called for every message.
+	*/
+	static void formatRecord(const Record& record, std::string& batch, time_t& cachedTime, char* cachedText);
+
+	/** @brief Write a batch to the console and log file. The caller must hold outputMutex. */
+	static void writeBatch(const std::string& batch);
+
+	/** @brief Wrapper for the platform specific localtime/strftime. */
+	static void formatTime(time_t time, const char* format, char* output, size_t outputSize);
+};
+
+
+//Compile time log level, messages above it are removed by the preprocessor so their arguments
+//are never evaluated. Defaults to everything in debug builds and up to info otherwise.
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARNING 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+	#ifdef _DEBUG
+		#define LOG_LEVEL LOG_LEVEL_DEBUG
+	#else
+		#define LOG_LEVEL LOG_LEVEL_INFO
+	#endif
+#endif
+
+//Rate limited logging, see Log::RateLimiter
+#define LOG_LIMITED(type, ...) \
+	do { \
+		static Log::RateLimiter logRateLimiter(__FILE__, __LINE__); \
+		unsigned long long logSuppressed; \
+		if (logRateLimiter.allow(logSuppressed)) \
+		{ \
+			if (logSuppressed > 0) \
+				logRateLimiter.logSuppressed(type, logSuppressed); \
+			Log::log(type, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+	#define LOG_D(...) Log::log(Log::D, __VA_ARGS__)
+	#define LOG_D_LIMITED(...) LOG_LIMITED(Log::D, __VA_ARGS__)
+#else
+	#define LOG_D(...) ((void)0)
+	#define LOG_D_LIMITED(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+	#define LOG_I(...) Log::log(Log::I, __VA_ARGS__)
+	#define LOG_I_LIMITED(...) LOG_LIMITED(Log::I, __VA_ARGS__)
+#else
+	#define LOG_I(...) ((void)0)
+	#define LOG_I_LIMITED(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+	#define LOG_W(...) Log::log(Log::W, __VA_ARGS__)
+	#define LOG_W_LIMITED(...) LOG_LIMITED(Log::W, __VA_ARGS__)
+#else
+	#define LOG_W(...) ((void)0)
+	#define LOG_W_LIMITED(...) ((void)0)
+#endif
+
+#define LOG_E(...) Log::log(Log::E, __VA_ARGS__)
+#define LOG_E_LIMITED(...) LOG_LIMITED(Log::E, __VA_ARGS__)
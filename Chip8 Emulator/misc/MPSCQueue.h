@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+@brief Bounded lock-free queue for many producer threads and a single consumer thread.
+
+Based on Dmitry Vyukov's bounded MPMC queue, with the consumer side simplified as only one
+thread ever pops. All storage is allocated up front, pushing and popping never allocate.
+*/
+template <typename T>
+class MPSCQueue
+{
+public:
+	/**
+	@brief Constructor
+
+	@param capacity Max number of queued items, rounded up to a power of two.
+	*/
+	explicit MPSCQueue(size_t capacity)
+		: dequeuePos(0)
+	{
+		size_t roundedCapacity = 2;
+		while (roundedCapacity < capacity)
+			roundedCapacity <<= 1;
+
+		mask = roundedCapacity - 1;
+		cells.reset(new Cell[roundedCapacity]);
+
+		for (size_t i = 0; i < roundedCapacity; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+
+		enqueuePos.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	@brief Push an item, safe to call from any thread.
+
+	@param value The item, moved into the queue on success.
+
+	@return false if the queue is full.
+	*/
+	bool tryPush(T&& value)
+	{
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			Cell& cell = cells[pos & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+
+			if (difference == 0)
+			{
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.data = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	@brief Pop the oldest item. Must only be called from the consumer thread.
+
+	@param [out] value Receives the item.
+
+	@return false if the queue is empty.
+	*/
+	bool tryPop(T& value)
+	{
+		Cell& cell = cells[dequeuePos & mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+		if ((intptr_t)sequence - (intptr_t)(dequeuePos + 1) < 0)
+			return false;
+
+		value = std::move(cell.data);
+		cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+		dequeuePos++;
+		return true;
+	}
+
+private:
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+
+	size_t mask;
+
+	//Kept on separate cache lines so producers and the consumer don't fight over them
+	alignas(64) std::atomic<size_t> enqueuePos;
+
+	alignas(64) size_t dequeuePos;
+};
@@ -0,0 +1,143 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Log.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+	: data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		LOG_E("Could not open file for mapping: " + path);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		LOG_E("Could not get the size of file: " + path);
+		close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+
+	//Empty files can't be mapped, but are still a successful open
+	if (size == 0)
+		return true;
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr)
+		data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (data == nullptr)
+	{
+		LOG_E("Could not map file: " + path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile()
+	: data(nullptr), size(0)
+{
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		LOG_E("Could not open file for mapping: " + path);
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		LOG_E("Could not get the size of file: " + path);
+		::close(file);
+		return false;
+	}
+
+	size = (size_t)status.st_size;
+
+	//Empty files can't be mapped, but are still a successful open
+	if (size != 0)
+	{
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			LOG_E("Could not map file: " + path);
+			::close(file);
+			size = 0;
+			return false;
+		}
+
+		data = (const unsigned char*)mapping;
+	}
+
+	//The mapping keeps its own reference to the file
+	::close(file);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != nullptr)
+		munmap((void*)data, size);
+
+	data = nullptr;
+	size = 0;
+}
+
+#endif // _WIN32
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+@brief A read only memory mapping of a whole file.
+
+The file's pages are mapped straight into the address space, so reading it costs no read
+calls or intermediate buffer. The mapping is released when the object is destroyed.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	@brief Map a file, closing any file already mapped.
+
+	@param path The file to map.
+
+	@return bool - Was successful.
+	*/
+	bool open(const std::string& path);
+
+	void close();
+
+	/** @brief The mapped bytes, nullptr if nothing is mapped or the file is empty. */
+	const unsigned char* getData() const { return data; }
+
+	size_t getSize() const { return size; }
+
+private:
+	const unsigned char* data;
+
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
@@ -2,11 +2,14 @@
 
 #include <string>
 
+#include "CpuFeatures.h"
+#include "Kernels.h"
 #include "Log.h"
 
 
 Platform::Platform()
-	: scale(Vec2(64, 32))
+	: scale(Vec2(64, 32)), audioInitialised(false), fontsInitialised(false), imagesInitialised(false),
+	controllersInitialised(false)
 {
 	window = nullptr;
 	renderer = nullptr;
@@ -14,10 +17,21 @@ Platform::Platform()
 
 Platform::~Platform()
 {
-	IMG_Quit();
-	Mix_CloseAudio();
-	Mix_Quit();
-	TTF_Quit();
+	if (imagesInitialised)
+	{
+		IMG_Quit();
+	}
+
+	if (audioInitialised)
+	{
+		Mix_CloseAudio();
+		Mix_Quit();
+	}
+
+	if (fontsInitialised)
+	{
+		TTF_Quit();
+	}
 
 	if (renderer != nullptr)
 	{
@@ -35,43 +49,16 @@ bool Platform::initSDL()
 
 	windowSize = Vec2(640, 320);
 
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC) < 0)
+	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
 		status = false;
-		Log::logE("SDL Init failed: " + std::string(SDL_GetError()));
+		LOG_E("SDL Init failed: " + std::string(SDL_GetError()));
 	}
 
 	//SDL Version Information for Debug
 	printSDLVersion();
 
 
-	//SDL TTF Initialization
-	if (TTF_Init() < 0)
-	{
-		status = false;
-		Log::logE("SDL_ttf init failed: " + std::string(TTF_GetError()));
-	}
-
-	//SDL Mixer Initialization
-	Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3);
-	//Initialize SDL_Mixer with some standard audio formats/freqs. Also set channels to 2 for stereo sound.
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
-	{
-		status = false;
-		Log::logE("SDL_mixer init failed: " + std::string(Mix_GetError()));
-	}
-
-	//SDL Image Initialization
-	int flags= IMG_INIT_PNG;
-	int result = IMG_Init(flags);
-
-	// If the inputed flags are not returned, an error has occurred
-	if((result & flags) != flags)
-	{
-		Log::logE("Failed to Initialise SDL_Image and png support: "+ std::string(IMG_GetError()));
-	}
-
-
 	window = SDL_CreateWindow(
 		"Chip8 Emulator",
 		SDL_WINDOWPOS_CENTERED,
@@ -85,7 +72,7 @@ bool Platform::initSDL()
 	if (!window)
 	{
 		status = false;
-		Log::logE("Window failed to be created: " +
+		LOG_E("Window failed to be created: " +
 			std::string(SDL_GetError()));
 	}
 
@@ -93,7 +80,7 @@ bool Platform::initSDL()
 
 	if (renderer == nullptr)
 	{
-		Log::logE("SDL Renderer failed to be created: " + std::string(SDL_GetError()));
+		LOG_E("SDL Renderer failed to be created: " + std::string(SDL_GetError()));
 		status = false;
 	}
 
@@ -106,22 +93,108 @@ bool Platform::initSDL()
 	windowSize.x = (float)width;
 	windowSize.y = (float)height;
 
-	Log::logI("Window Dimensions: " + std::to_string(width) +
+	LOG_I("Window Dimensions: " + std::to_string(width) +
 		"x" + std::to_string(height));
 
 	//Feature Detection
 	checkFeatureSupport();
 
 	//Platform Details
-	Log::logI("CPU Cores: " + std::to_string(SDL_GetCPUCount()));
-	Log::logI("CPU L1 Cache: " + std::to_string(SDL_GetCPUCacheLineSize()) + "KB");
-	Log::logI("RAM: " + std::to_string(SDL_GetSystemRAM()) + "MB");
+	LOG_I("CPU Cores: " + std::to_string(SDL_GetCPUCount()));
+	LOG_I("CPU L1 Cache: " + std::to_string(SDL_GetCPUCacheLineSize()) + "KB");
+	LOG_I("RAM: " + std::to_string(SDL_GetSystemRAM()) + "MB");
 
 
 	return status;
 }
 
 
+bool Platform::initControllers()
+{
+	if (controllersInitialised)
+	{
+		return true;
+	}
+
+	//Connected controllers are reported through SDL_CONTROLLERDEVICEADDED events once this returns
+	if (SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC) < 0)
+	{
+		LOG_E("SDL game controller init failed: " + std::string(SDL_GetError()));
+		return false;
+	}
+
+	controllersInitialised = true;
+	return true;
+}
+
+bool Platform::initAudio()
+{
+	if (audioInitialised)
+	{
+		return true;
+	}
+
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+	{
+		LOG_E("SDL audio init failed: " + std::string(SDL_GetError()));
+		return false;
+	}
+
+	//SDL Mixer Initialization
+	Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3);
+	//Initialize SDL_Mixer with some standard audio formats/freqs. Also set channels to 2 for stereo sound.
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+	{
+		LOG_E("SDL_mixer init failed: " + std::string(Mix_GetError()));
+		Mix_Quit();
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+
+	audioInitialised = true;
+	return true;
+}
+
+bool Platform::initFonts()
+{
+	if (fontsInitialised)
+	{
+		return true;
+	}
+
+	//SDL TTF Initialization
+	if (TTF_Init() < 0)
+	{
+		LOG_E("SDL_ttf init failed: " + std::string(TTF_GetError()));
+		return false;
+	}
+
+	fontsInitialised = true;
+	return true;
+}
+
+bool Platform::initImages()
+{
+	if (imagesInitialised)
+	{
+		return true;
+	}
+
+	//SDL Image Initialization
+	int flags = IMG_INIT_PNG;
+	int result = IMG_Init(flags);
+
+	// If the inputed flags are not returned, an error has occurred
+	if ((result & flags) != flags)
+	{
+		LOG_E("Failed to Initialise SDL_Image and png support: " + std::string(IMG_GetError()));
+		return false;
+	}
+
+	imagesInitialised = true;
+	return true;
+}
+
 SDL_Renderer* Platform::getRenderer()
 {
 	if (renderer != nullptr)
@@ -130,7 +203,7 @@ SDL_Renderer* Platform::getRenderer()
 	}
 	else
 	{
-		Log::logE("SDL Renderer requested but it does not exist (Due to either an error or OpenGL being requested instead)");
+		LOG_E("SDL Renderer requested but it does not exist (Due to either an error or OpenGL being requested instead)");
 		return nullptr;
 	}
 }
@@ -143,14 +216,14 @@ void Platform::printSDLVersion()
 	SDL_VERSION(&compiled);
 	SDL_GetVersion(&linked);
 
-	Log::logI("SDL Version:");
+	LOG_I("SDL Version:");
 
-	Log::logI("Compiled: " + 
+	LOG_I("Compiled: " + 
 		std::to_string(compiled.major) + "." + 
 		std::to_string(compiled.minor) + "." + 
 		std::to_string(compiled.patch));
 
-	Log::logI("Linked: " + 
+	LOG_I("Linked: " + 
 		std::to_string(linked.major) + "." + 
 		std::to_string(linked.minor) + "." + 
 		std::to_string(linked.patch));
@@ -158,32 +231,27 @@ void Platform::printSDLVersion()
 
 bool Platform::isFeatureSupported(std::string feature)
 {
-	if (features.count(feature) == 0)
+	CpuFeatures::Feature known;
+
+	if (!CpuFeatures::fromName(feature, known))
 	{
-		Log::logW(feature + " feature is unknown, assuming unsupported.");
+		LOG_W(feature + " feature is unknown, assuming unsupported.");
 		return false;
 	}
 
-	return features[feature];
+	return CpuFeatures::has(known);
 }
 
 void Platform::checkFeatureSupport()
 {
-	features["3DNow"] = SDL_Has3DNow() == SDL_TRUE;
-	features["AVX"] = SDL_HasAVX() == SDL_TRUE;
-	features["AVX2"] = SDL_HasAVX2() == SDL_TRUE;
-	features["AltiVec"] = SDL_HasAltiVec() == SDL_TRUE;
-	features["MMX"] = SDL_HasMMX() == SDL_TRUE;
-	features["RDTSC"] = SDL_HasRDTSC() == SDL_TRUE;
-	features["SSE"] = SDL_HasSSE() == SDL_TRUE;
-	features["SSE2"] = SDL_HasSSE2() == SDL_TRUE;
-	features["SSE3"] = SDL_HasSSE3() == SDL_TRUE;
-	features["SSE41"] = SDL_HasSSE41() == SDL_TRUE;
-	features["SSE42"] = SDL_HasSSE42() == SDL_TRUE;
-
-	Log::logI("Platform Features:");
-	for (auto feature : features)
-	{
-		Log::logI(" - " + feature.first + ": " + (feature.second ? "Yes" : "No"));
+	CpuFeatures::resolve();
+
+	LOG_I("Platform Features:");
+	for (int feature = 0; feature < CpuFeatures::FeatureCount; feature++)
+	{
+		LOG_I(std::string(" - ") + CpuFeatures::getName((CpuFeatures::Feature)feature) + ": " +
+			(CpuFeatures::has((CpuFeatures::Feature)feature) ? "Yes" : "No"));
 	}
+
+	Kernels::resolve();
 }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <unordered_map>
+#include <string>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
@@ -23,12 +23,43 @@ public:
 	~Platform();
 
 	/**
-	@brief Initialises the SDL library and its plugins, for the current platform.
+	@brief Initialises SDL video and events and creates the window and renderer, the minimum needed to
+	present a frame. Everything else is brought up on demand by the functions below.
 	
 	@return bool - Was successful.
 	 */
 	bool initSDL();
 
+	/**
+	@brief Initialise game controller and haptic support, if they haven't been already. Scanning for
+	devices can take a while, so this is left until after the first frame. Must be called from the
+	thread that pumps events.
+
+	@return bool - Was successful.
+	*/
+	bool initControllers();
+
+	/**
+	@brief Initialise the audio subsystem and SDL_mixer, if they haven't been already.
+
+	@return bool - Was successful.
+	*/
+	bool initAudio();
+
+	/**
+	@brief Initialise SDL_ttf, if it hasn't been already.
+
+	@return bool - Was successful.
+	*/
+	bool initFonts();
+
+	/**
+	@brief Initialise SDL_image with png support, if it hasn't been already.
+
+	@return bool - Was successful.
+	*/
+	bool initImages();
+
 	/**
 	 @brief Gets the window.
 	
@@ -59,6 +90,10 @@ public:
 	void printSDLVersion();
 
 
+	/**
+	@brief Is a CPU feature supported, by the name CpuFeatures gives it. Hot code should use
+	CpuFeatures::has directly, which is a bit test rather than a string lookup.
+	*/
 	bool isFeatureSupported(std::string feature);
 	
 private:
@@ -76,9 +111,13 @@ private:
 	const Vec2 scale;
 
 
-	//Platform Feature Support (Wraps SDL CPU feature detection)
-	std::unordered_map<std::string, bool> features;
+	//On demand subsystems
+	bool audioInitialised;
+	bool fontsInitialised;
+	bool imagesInitialised;
+	bool controllersInitialised;
 
+	//Resolves the CPU feature set and selects the kernel variants that use it
 	void checkFeatureSupport();
 
 };
\ No newline at end of file
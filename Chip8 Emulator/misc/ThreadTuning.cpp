@@ -0,0 +1,333 @@
+#include "ThreadTuning.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "Log.h"
+
+namespace
+{
+	///Pages are at least this big everywhere we run, touching once per page is enough to fault it in
+	const size_t PAGE_TOUCH_STRIDE = 4096;
+}
+
+ThreadTuning::ThreadTuning()
+{
+
+}
+
+bool ThreadTuning::parseCoreList(const std::string& text, std::vector<int>& cores)
+{
+	cores.clear();
+
+	std::istringstream stream(text);
+	std::string range;
+
+	while (std::getline(stream, range, ','))
+	{
+		char* end = nullptr;
+		long first = strtol(range.c_str(), &end, 10);
+		long last = first;
+
+		if (end == range.c_str() || first < 0)
+			return false;
+
+		if (*end == '-')
+		{
+			const char* lastText = end + 1;
+			last = strtol(lastText, &end, 10);
+
+			if (end == lastText || last < first)
+				return false;
+		}
+
+		if (*end != '\0')
+			return false;
+
+		for (long core = first; core <= last; core++)
+		{
+			cores.push_back((int)core);
+		}
+	}
+
+	return !cores.empty();
+}
+
+#ifdef _WIN32
+
+bool ThreadTuning::setAffinity(const std::vector<int>& cores)
+{
+	DWORD_PTR mask = 0;
+
+	for (int core : cores)
+	{
+		if (core >= (int)(sizeof(DWORD_PTR) * 8))
+		{
+			LOG_W("Core " + std::to_string(core) + " is outside the affinity mask, only the first processor group is supported");
+			return false;
+		}
+
+		mask |= (DWORD_PTR)1 << core;
+	}
+
+	if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+	{
+		LOG_W("Could not set thread affinity, error: " + std::to_string(GetLastError()));
+		return false;
+	}
+
+	return true;
+}
+
+bool ThreadTuning::setRealtimePriority(int priority)
+{
+	(void)priority;
+
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+	{
+		LOG_W("Could not set a time critical thread priority, error: " + std::to_string(GetLastError()));
+		return false;
+	}
+
+	return true;
+}
+
+bool ThreadTuning::setNice(int nice)
+{
+	int priority = THREAD_PRIORITY_NORMAL;
+
+	if (nice <= -15)
+		priority = THREAD_PRIORITY_HIGHEST;
+	else if (nice < 0)
+		priority = THREAD_PRIORITY_ABOVE_NORMAL;
+	else if (nice >= 15)
+		priority = THREAD_PRIORITY_LOWEST;
+	else if (nice > 0)
+		priority = THREAD_PRIORITY_BELOW_NORMAL;
+
+	if (!SetThreadPriority(GetCurrentThread(), priority))
+	{
+		LOG_W("Could not set thread priority, error: " + std::to_string(GetLastError()));
+		return false;
+	}
+
+	return true;
+}
+
+bool ThreadTuning::lockMemory(size_t stackBytes)
+{
+	prefaultStack(stackBytes);
+
+	//Windows can only lock specific ranges, and only up to the working set minimum
+	LOG_W("Locking the whole working set isn't supported on Windows, only the stack was pre-faulted");
+	return false;
+}
+
+int ThreadTuning::getCurrentCore()
+{
+	return (int)GetCurrentProcessorNumber();
+}
+
+long ThreadTuning::getInvoluntarySwitches()
+{
+	return -1;
+}
+
+std::string ThreadTuning::describe()
+{
+	return "thread priority " + std::to_string(GetThreadPriority(GetCurrentThread()));
+}
+
+#else
+
+bool ThreadTuning::setAffinity(const std::vector<int>& cores)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (int core : cores)
+	{
+		if (core >= CPU_SETSIZE)
+		{
+			LOG_W("Core " + std::to_string(core) + " is outside the affinity mask");
+			return false;
+		}
+
+		CPU_SET(core, &set);
+	}
+
+	int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	if (result != 0)
+	{
+		LOG_W(std::string("Could not set thread affinity: ") + strerror(result));
+		return false;
+	}
+
+	return true;
+#else
+	(void)cores;
+	LOG_W("Thread affinity isn't supported on this platform");
+	return false;
+#endif
+}
+
+bool ThreadTuning::setRealtimePriority(int priority)
+{
+	int minimum = sched_get_priority_min(SCHED_FIFO);
+	int maximum = sched_get_priority_max(SCHED_FIFO);
+
+	if (priority < minimum || priority > maximum)
+	{
+		LOG_W("SCHED_FIFO priority must be between " + std::to_string(minimum) + " and " + std::to_string(maximum));
+		return false;
+	}
+
+	sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = priority;
+
+	int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	if (result != 0)
+	{
+		LOG_W(std::string("Could not switch to SCHED_FIFO: ") + strerror(result));
+		return false;
+	}
+
+	return true;
+}
+
+bool ThreadTuning::setNice(int nice)
+{
+	//Linux keeps a nice value per thread, addressed by its thread id
+#ifdef __linux__
+	id_t target = (id_t)syscall(SYS_gettid);
+#else
+	id_t target = 0;
+#endif
+
+	if (setpriority(PRIO_PROCESS, target, nice) != 0)
+	{
+		LOG_W("Could not set nice " + std::to_string(nice) + ": " + strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool ThreadTuning::lockMemory(size_t stackBytes)
+{
+	prefaultStack(stackBytes);
+
+	//Only what is mapped now, locking future mappings can make later allocations fail
+	if (mlockall(MCL_CURRENT) != 0)
+	{
+		LOG_W(std::string("Could not lock memory: ") + strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+int ThreadTuning::getCurrentCore()
+{
+#ifdef __linux__
+	return sched_getcpu();
+#else
+	return -1;
+#endif
+}
+
+long ThreadTuning::getInvoluntarySwitches()
+{
+#ifdef RUSAGE_THREAD
+	rusage usage;
+
+	if (getrusage(RUSAGE_THREAD, &usage) == 0)
+	{
+		return usage.ru_nivcsw;
+	}
+#endif
+
+	return -1;
+}
+
+std::string ThreadTuning::describe()
+{
+	std::string description;
+
+#ifdef __linux__
+	cpu_set_t set;
+
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+	{
+		description += "cores";
+
+		for (int core = 0; core < CPU_SETSIZE; core++)
+		{
+			if (CPU_ISSET(core, &set))
+				description += " " + std::to_string(core);
+		}
+
+		description += ", ";
+	}
+#endif
+
+	int policy;
+	sched_param param;
+
+	if (pthread_getschedparam(pthread_self(), &policy, &param) == 0)
+	{
+		if (policy == SCHED_FIFO)
+			description += "SCHED_FIFO " + std::to_string(param.sched_priority);
+		else if (policy == SCHED_RR)
+			description += "SCHED_RR " + std::to_string(param.sched_priority);
+		else
+			description += "SCHED_OTHER";
+	}
+
+#ifdef __linux__
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+
+	if (errno == 0)
+		description += ", nice " + std::to_string(nice);
+#endif
+
+	return description;
+}
+
+#endif // _WIN32
+
+void ThreadTuning::prefaultStack(size_t stackBytes)
+{
+	volatile unsigned char page[PAGE_TOUCH_STRIDE];
+	page[0] = 0;
+
+	if (stackBytes > PAGE_TOUCH_STRIDE)
+	{
+		prefaultStack(stackBytes - PAGE_TOUCH_STRIDE);
+	}
+
+	//Used after the call so it can't become a tail call that reuses this frame
+	page[PAGE_TOUCH_STRIDE - 1] = page[0];
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+@brief Controls where and how urgently the calling thread is scheduled.
+
+Used by the emulation loop to keep its frames on time on busy hosts: it can be pinned to a
+set of cores, raised to a real time or higher nice priority, and have its memory locked so
+page faults can't stall a frame. Every call acts on the calling thread and fails with a
+warning, rather than an error, when the host or its permissions don't allow it.
+*/
+class ThreadTuning
+{
+public:
+	/**
+	@brief Restrict the calling thread to a set of cores.
+
+	@param cores Core indices, as numbered by the OS.
+
+	@return bool - Was successful.
+	*/
+	static bool setAffinity(const std::vector<int>& cores);
+
+	/**
+	@brief Parse a core list such as "2,3" or "0-3,6".
+
+	@param text  The list.
+	@param [out] cores Receives the core indices.
+
+	@return false if the list is malformed.
+	*/
+	static bool parseCoreList(const std::string& text, std::vector<int>& cores);
+
+	/**
+	@brief Move the calling thread to the SCHED_FIFO real time policy. Needs CAP_SYS_NICE or an
+	RLIMIT_RTPRIO allowance on Linux. On Windows any priority maps to THREAD_PRIORITY_TIME_CRITICAL.
+
+	@param priority 1 to 99, higher preempts lower.
+
+	@return bool - Was successful.
+	*/
+	static bool setRealtimePriority(int priority);
+
+	/**
+	@brief Set the calling thread's nice value. Raising priority (a negative nice) needs
+	CAP_SYS_NICE or an RLIMIT_NICE allowance.
+
+	@param nice -20 (most favoured) to 19.
+
+	@return bool - Was successful.
+	*/
+	static bool setNice(int nice);
+
+	/**
+	@brief Fault in the stack the thread will use and lock every mapped page into memory.
+	Call once startup has allocated everything, pages mapped later are not locked.
+
+	@param stackBytes How much stack to pre-fault below the caller's frame.
+
+	@return bool - Was successful.
+	*/
+	static bool lockMemory(size_t stackBytes);
+
+	/** @brief The core the calling thread is running on, -1 if it can't be found. */
+	static int getCurrentCore();
+
+	/** @brief Times the calling thread has been preempted, -1 if the host doesn't count them. */
+	static long getInvoluntarySwitches();
+
+	/** @brief The calling thread's affinity and scheduling policy, for reports. */
+	static std::string describe();
+
+private:
+	ThreadTuning();
+
+	/** @brief Touch each page of a stack buffer so it is mapped before it is needed. */
+	static void prefaultStack(size_t stackBytes);
+};
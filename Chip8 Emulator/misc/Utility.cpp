@@ -2,6 +2,10 @@
 
 #include <cstdlib>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 float Utility::normaliseBetweenMinusOneAndOne(float numberToNormalise, float max, float min)
 {
 	//find the new max and min number when shifted to a positive only range and the shifted number to normalise
@@ -30,4 +34,33 @@ float Utility::normaliseFloat(float numberToNormalise, float max, float min)
 
 	//return the normalised number
 	return normalisedNumber;
-}
\ No newline at end of file
+}
+
+int Utility::highestSetBit(uint64_t number)
+{
+#ifdef _MSC_VER
+	//_BitScanReverse64 isn't available for 32 bit builds, so scan each half
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(number >> 32)))
+		return (int)index + 32;
+
+	_BitScanReverse(&index, (unsigned long)number);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(number);
+#endif
+}
+
+int Utility::lowestSetBit(uint64_t number)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)number))
+		return (int)index;
+
+	_BitScanForward(&index, (unsigned long)(number >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(number);
+#endif
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Utility
 {
 	///A function to normalise a number to between 1.0f and -1.0f, using the range that the number already uses
@@ -8,4 +10,11 @@ namespace Utility
 
 	///A function to normalise a number to between 0 and 1, using the range that the number already exists in
 	float normaliseFloat(float numberToNormalise, float max, float min);
+
+
+	///Index of the highest set bit, the number must not be zero
+	int highestSetBit(uint64_t number);
+
+	///Index of the lowest set bit, the number must not be zero
+	int lowestSetBit(uint64_t number);
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "MemoryImage.h"
+
+#include <cstring>
+
+const int MemoryImage::SIZE;
+const unsigned short MemoryImage::LOAD_ADDRESS;
+
+namespace
+{
+	const unsigned char chip8FontSet[80] =
+	{
+		0xF0, 0x90, 0x90, 0x90, 0xF0, //0
+		0x20, 0x60, 0x20, 0x20, 0x70, //1
+		0xF0, 0x10, 0xF0, 0x80, 0xF0, //2
+		0xF0, 0x10, 0xF0, 0x10, 0xF0, //3
+		0x90, 0x90, 0xF0, 0x10, 0x10, //4
+		0xF0, 0x80, 0xF0, 0x10, 0xF0, //5
+		0xF0, 0x80, 0xF0, 0x90, 0xF0, //6
+		0xF0, 0x10, 0x20, 0x40, 0x40, //7
+		0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
+		0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
+		0xF0, 0x90, 0xF0, 0x90, 0x90, //A
+		0xE0, 0x90, 0xE0, 0x90, 0xE0, //B
+		0xF0, 0x80, 0x80, 0x80, 0xF0, //C
+		0xE0, 0x90, 0x90, 0x90, 0xE0, //D
+		0xF0, 0x80, 0xF0, 0x80, 0xF0, //E
+		0xF0, 0x80, 0xF0, 0x80, 0x80  //F
+	};
+}
+
+std::shared_ptr<const MemoryImage> MemoryImage::create(const unsigned char* rom, size_t size)
+{
+	if (size > (size_t)(SIZE - LOAD_ADDRESS))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<MemoryImage> image = std::make_shared<MemoryImage>();
+
+	memset(image->bytes, 0, sizeof(image->bytes));
+	memcpy(image->bytes, chip8FontSet, sizeof(chip8FontSet));
+
+	if (size > 0)
+	{
+		memcpy(image->bytes + LOAD_ADDRESS, rom, size);
+	}
+
+	return image;
+}
+
+std::shared_ptr<const MemoryImage> MemoryImage::getEmpty()
+{
+	static const std::shared_ptr<const MemoryImage> empty = create(nullptr, 0);
+	return empty;
+}
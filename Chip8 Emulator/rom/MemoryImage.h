@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+/**
+@brief The address space a machine starts with: the font at 0x000 and a ROM at 0x200.
+
+Immutable once created, so every machine running the same ROM shares one image and only
+copies the pages it writes to.
+*/
+struct MemoryImage
+{
+	static const int SIZE = 4096;
+	static const unsigned short LOAD_ADDRESS = 0x200;
+
+	unsigned char bytes[SIZE];
+
+	/**
+	@brief Build the image for a ROM.
+
+	@return The image, nullptr if the ROM doesn't fit above LOAD_ADDRESS.
+	*/
+	static std::shared_ptr<const MemoryImage> create(const unsigned char* rom, size_t size);
+
+	/** @brief The image for a machine with no ROM loaded, just the font. */
+	static std::shared_ptr<const MemoryImage> getEmpty();
+};
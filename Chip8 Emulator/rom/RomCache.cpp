@@ -0,0 +1,89 @@
+#include "RomCache.h"
+
+#include <cstring>
+
+#include "../misc/Hash.h"
+#include "../misc/Log.h"
+#include "../misc/MappedFile.h"
+
+std::mutex RomCache::cacheMutex;
+std::unordered_map<uint64_t, std::shared_ptr<const RomImage>> RomCache::images;
+std::unordered_map<std::string, std::shared_ptr<const RomImage>> RomCache::paths;
+
+std::shared_ptr<const RomImage> RomCache::load(const std::string& path)
+{
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		auto cached = paths.find(path);
+		if (cached != paths.end())
+			return cached->second;
+	}
+
+	//Map and hash outside the lock so threads loading different ROMs don't wait on each other
+	MappedFile file;
+	if (!file.open(path))
+		return nullptr;
+
+	uint64_t hash = Hash::xxh64(file.getData(), file.getSize());
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	std::shared_ptr<const RomImage> image = intern(hash, file.getData(), file.getSize());
+	paths[path] = image;
+
+	return image;
+}
+
+std::shared_ptr<const RomImage> RomCache::insert(const unsigned char* data, size_t size)
+{
+	uint64_t hash = Hash::xxh64(data, size);
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return intern(hash, data, size);
+}
+
+std::shared_ptr<const RomImage> RomCache::find(uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	auto cached = images.find(hash);
+	return (cached != images.end() ? cached->second : nullptr);
+}
+
+void RomCache::evict(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	paths.erase(path);
+}
+
+void RomCache::clear()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	paths.clear();
+	images.clear();
+}
+
+std::shared_ptr<const RomImage> RomCache::intern(uint64_t hash, const unsigned char* data, size_t size)
+{
+	auto cached = images.find(hash);
+
+	if (cached != images.end())
+	{
+		const RomImage& existing = *cached->second;
+
+		if (existing.data.size() == size && (size == 0 || memcmp(existing.data.data(), data, size) == 0))
+			return cached->second;
+
+		//A 64 bit collision is vanishingly unlikely, but never hand out the wrong ROM
+		LOG_W("ROM hash collision, the newer image replaces the cached one");
+	}
+
+	std::shared_ptr<RomImage> image = std::make_shared<RomImage>();
+	image->hash = hash;
+	image->data.assign(data, data + size);
+	image->memory = MemoryImage::create(data, size);
+
+	images[hash] = image;
+	return image;
+}
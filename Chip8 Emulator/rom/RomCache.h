@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MemoryImage.h"
+
+/** @brief An immutable ROM image shared by every instance running it. */
+struct RomImage
+{
+	///XXH64 of the ROM's bytes
+	uint64_t hash;
+
+	std::vector<unsigned char> data;
+
+	///The font and ROM as machines start with them, nullptr if the ROM is too big to load
+	std::shared_ptr<const MemoryImage> memory;
+};
+
+/**
+@brief Process wide cache of loaded ROM images, keyed by content hash.
+
+The first load of a path memory maps the file, hashes it and keeps a copy. After that the
+same path, or any other path or buffer with identical contents, returns the cached image
+without touching the filesystem. Safe to use from multiple threads.
+*/
+class RomCache
+{
+public:
+	/**
+	@brief Get the image for a ROM file, loading it on first use.
+
+	@param path The ROM file.
+
+	@return The image, nullptr if the file could not be read.
+	*/
+	static std::shared_ptr<const RomImage> load(const std::string& path);
+
+	/**
+	@brief Get the image for a ROM already in memory, copying it in on first use.
+
+	@param data The ROM's bytes.
+	@param size Number of bytes.
+
+	@return The image.
+	*/
+	static std::shared_ptr<const RomImage> insert(const unsigned char* data, size_t size);
+
+	/** @brief Look up an image by its hash, nullptr if it isn't cached. */
+	static std::shared_ptr<const RomImage> find(uint64_t hash);
+
+	/** @brief Forget a path so its next load reads the file again, for ROMs that changed on disk. */
+	static void evict(const std::string& path);
+
+	/** @brief Drop every cached image, instances still holding one keep it alive. */
+	static void clear();
+
+private:
+	static std::mutex cacheMutex;
+
+	static std::unordered_map<uint64_t, std::shared_ptr<const RomImage>> images;
+
+	static std::unordered_map<std::string, std::shared_ptr<const RomImage>> paths;
+
+	/** @brief Get the cached image with the same hash and contents, or add a new one. Expects cacheMutex held. */
+	static std::shared_ptr<const RomImage> intern(uint64_t hash, const unsigned char* data, size_t size);
+};
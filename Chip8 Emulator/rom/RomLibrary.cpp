@@ -0,0 +1,392 @@
+#include "RomLibrary.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "../misc/Hash.h"
+#include "../misc/Log.h"
+#include "../misc/MappedFile.h"
+
+std::mutex RomLibrary::entriesMutex;
+std::unordered_map<uint64_t, RomLibrary::Entry> RomLibrary::entries;
+
+namespace
+{
+	const char* INDEX_HEADER = "# Chip8 Emulator ROM index v1";
+
+	//Largest ROM worth indexing, XO-CHIP ROMs can fill a 64KB address space
+	const uint64_t MAX_ROM_SIZE = 0x10000;
+
+	//Extensions ROM collections use, plus no extension at all which older packs often have
+	bool isRomFile(const std::string& name)
+	{
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos)
+			return true;
+
+		std::string extension = name.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+		return extension == "ch8" || extension == "c8" || extension == "sc8" || extension == "xo8";
+	}
+
+	//Recursively collect every ROM file under a directory. Links are skipped, one pointing back up
+	//the tree would otherwise be scanned over and over
+	void findRomFiles(const std::string& directory, std::vector<std::string>& files)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+
+		if (find == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			std::string name = findData.cFileName;
+			if (name == "." || name == "..")
+				continue;
+
+			std::string path = directory + "\\" + name;
+
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+				continue;
+
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				findRomFiles(path, files);
+			else if (isRomFile(name))
+				files.push_back(path);
+		} while (FindNextFileA(find, &findData));
+
+		FindClose(find);
+#else
+		DIR* dir = opendir(directory.c_str());
+
+		if (dir == nullptr)
+			return;
+
+		while (dirent* item = readdir(dir))
+		{
+			std::string name = item->d_name;
+			if (name == "." || name == ".." || name[0] == '.')
+				continue;
+
+			std::string path = directory + "/" + name;
+
+			struct stat status;
+			if (lstat(path.c_str(), &status) != 0 || S_ISLNK(status.st_mode))
+				continue;
+
+			if (S_ISDIR(status.st_mode))
+				findRomFiles(path, files);
+			else if (S_ISREG(status.st_mode) && isRomFile(name))
+				files.push_back(path);
+		}
+
+		closedir(dir);
+#endif
+	}
+
+	//Quirks are stored as one character each, '-' when off, so they are easy to edit by hand
+	std::string quirksToString(const Quirks& quirks)
+	{
+		std::string text = "----";
+		if (quirks.shiftVxInPlace) text[0] = 's';
+		if (quirks.loadStoreIncrementsI) text[1] = 'i';
+		if (quirks.wrapSprites) text[2] = 'w';
+		if (quirks.addIndexSetsOverflow) text[3] = 'o';
+		return text;
+	}
+
+	bool quirksFromString(const std::string& text, Quirks& quirks)
+	{
+		if (text.size() != 4)
+			return false;
+
+		quirks.shiftVxInPlace = (text[0] == 's');
+		quirks.loadStoreIncrementsI = (text[1] == 'i');
+		quirks.wrapSprites = (text[2] == 'w');
+		quirks.addIndexSetsOverflow = (text[3] == 'o');
+		return true;
+	}
+
+	bool platformFromString(const std::string& text, Quirks::Platform& platform)
+	{
+		for (int i = 0; i < Quirks::PlatformCount; i++)
+		{
+			if (text == Quirks::getPlatformName((Quirks::Platform)i))
+			{
+				platform = (Quirks::Platform)i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+bool RomLibrary::scan(const std::string& directory, unsigned int threadCount)
+{
+	std::vector<std::string> files;
+	findRomFiles(directory, files);
+
+	if (files.empty())
+	{
+		LOG_W("No ROMs found in: " + directory);
+		return false;
+	}
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	threadCount = std::min<unsigned int>(threadCount, (unsigned int)files.size());
+
+	//Workers pull the next file from a shared counter and fill in their own slot, so they never contend on a lock
+	std::vector<Entry> scanned(files.size());
+	std::vector<char> valid(files.size(), 0);
+	std::atomic<size_t> nextFile(0);
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back([&]()
+		{
+			for (size_t file = nextFile++; file < files.size(); file = nextFile++)
+				valid[file] = indexFile(files[file], scanned[file]);
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	size_t added = 0;
+	{
+		std::lock_guard<std::mutex> lock(entriesMutex);
+
+		for (size_t i = 0; i < scanned.size(); i++)
+		{
+			if (!valid[i])
+				continue;
+
+			auto existing = entries.find(scanned[i].hash);
+
+			if (existing != entries.end())
+			{
+				existing->second.path = scanned[i].path;
+			}
+			else
+			{
+				entries[scanned[i].hash] = scanned[i];
+				added++;
+			}
+		}
+	}
+
+	LOG_I("Scanned " + std::to_string(files.size()) + " ROMs in " + directory + " with "
+		+ std::to_string(threadCount) + " threads, " + std::to_string(added) + " new");
+
+	return true;
+}
+
+bool RomLibrary::indexFile(const std::string& path, Entry& entry)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return false;
+
+	if (file.getSize() == 0 || file.getSize() > MAX_ROM_SIZE)
+		return false;
+
+	entry.hash = Hash::xxh64(file.getData(), file.getSize());
+	entry.size = file.getSize();
+	entry.platform = detectPlatform(file.getData(), file.getSize());
+	entry.quirks = Quirks::forPlatform(entry.platform);
+	entry.path = path;
+
+	return true;
+}
+
+Quirks::Platform RomLibrary::detectPlatform(const unsigned char* data, size_t size)
+{
+	//Only XO-CHIP can address past the 4KB Chip8 memory
+	if (size > 0x1000 - 0x200)
+		return Quirks::XOChipPlatform;
+
+	//Sprite data can look like any opcode, so each platform needs more than one distinct instruction
+	//only it has before the ROM is counted as one
+	bool superChip[9] = {};
+	bool xoChip[5] = {};
+
+	for (size_t i = 0; i + 1 < size; i += 2)
+	{
+		unsigned short opcode = (unsigned short)(data[i] << 8 | data[i + 1]);
+
+		switch (opcode & 0xF000)
+		{
+		case 0x0000:
+			if ((opcode & 0xFFF0) == 0x00C0 && (opcode & 0x000F) != 0) superChip[0] = true; //00CN scroll down
+			else if (opcode == 0x00FB) superChip[1] = true; //Scroll right
+			else if (opcode == 0x00FC) superChip[2] = true; //Scroll left
+			else if (opcode == 0x00FD) superChip[3] = true; //Exit
+			else if (opcode == 0x00FE || opcode == 0x00FF) superChip[4] = true; //Low/high resolution
+			else if ((opcode & 0xFFF0) == 0x00D0 && (opcode & 0x000F) != 0) xoChip[0] = true; //00DN scroll up
+			break;
+
+		case 0x5000:
+			if ((opcode & 0x000F) == 0x0002 || (opcode & 0x000F) == 0x0003) xoChip[1] = true; //5XY2/5XY3 register ranges
+			break;
+
+		case 0xD000:
+			if ((opcode & 0x000F) == 0) superChip[5] = true; //DXY0 16x16 sprite
+			break;
+
+		case 0xF000:
+			if (opcode == 0xF000) xoChip[2] = true; //Long I load
+			else if (opcode == 0xF002) xoChip[3] = true; //Audio pattern
+			else if ((opcode & 0x00FF) == 0x0001) xoChip[4] = true; //FN01 plane select
+			else if ((opcode & 0x00FF) == 0x0030) superChip[6] = true; //FX30 large font
+			else if ((opcode & 0x00FF) == 0x0075) superChip[7] = true; //FX75 store flags
+			else if ((opcode & 0x00FF) == 0x0085) superChip[8] = true; //FX85 load flags
+			break;
+		}
+	}
+
+	int superChipHits = (int)std::count(std::begin(superChip), std::end(superChip), true);
+	int xoChipHits = (int)std::count(std::begin(xoChip), std::end(xoChip), true);
+
+	if (xoChipHits >= 2)
+		return Quirks::XOChipPlatform;
+
+	if (superChipHits >= 2)
+		return Quirks::SuperChipPlatform;
+
+	return Quirks::Chip8Platform;
+}
+
+bool RomLibrary::findQuirks(uint64_t hash, Quirks& quirks)
+{
+	std::lock_guard<std::mutex> lock(entriesMutex);
+
+	auto entry = entries.find(hash);
+	if (entry == entries.end())
+		return false;
+
+	quirks = entry->second.quirks;
+	return true;
+}
+
+size_t RomLibrary::getEntryCount()
+{
+	std::lock_guard<std::mutex> lock(entriesMutex);
+	return entries.size();
+}
+
+bool RomLibrary::loadIndex(const std::string& path)
+{
+	std::ifstream file(path);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not open ROM index: " + path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(entriesMutex);
+
+	std::string line;
+	int lineNumber = 0;
+	size_t loaded = 0;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		//hash size platform quirks path, the path is last as it can contain spaces
+		std::istringstream fields(line);
+		std::string hashText, platformText, quirksText;
+		Entry entry;
+
+		fields >> hashText >> entry.size >> platformText >> quirksText >> std::ws;
+		std::getline(fields, entry.path);
+
+		if (entry.path.empty())
+		{
+			LOG_W("Skipping malformed ROM index line " + std::to_string(lineNumber) + " in " + path);
+			continue;
+		}
+
+		char* hashEnd = nullptr;
+		entry.hash = strtoull(hashText.c_str(), &hashEnd, 16);
+
+		if (hashText.size() != 16 || *hashEnd != '\0')
+		{
+			LOG_W("Skipping ROM index line " + std::to_string(lineNumber) + " with an invalid hash");
+			continue;
+		}
+
+		if (!platformFromString(platformText, entry.platform) || !quirksFromString(quirksText, entry.quirks))
+		{
+			LOG_W("Skipping ROM index line " + std::to_string(lineNumber) + " with an invalid platform or quirks");
+			continue;
+		}
+
+		entries[entry.hash] = entry;
+		loaded++;
+	}
+
+	LOG_I("Loaded " + std::to_string(loaded) + " ROMs from index: " + path);
+	return true;
+}
+
+bool RomLibrary::saveIndex(const std::string& path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		LOG_E("Could not write ROM index: " + path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(entriesMutex);
+
+	//Sorted by path so the file diffs cleanly between scans
+	std::vector<const Entry*> sorted;
+	for (auto& entry : entries)
+		sorted.push_back(&entry.second);
+
+	std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->path < b->path; });
+
+	file << INDEX_HEADER << std::endl;
+	file << "# hash size platform quirks path" << std::endl;
+	file << "# quirks: s = 8XY6/8XYE shift Vx in place, i = FX55/FX65 increment I, w = DXYN wraps, o = FX1E sets VF on overflow" << std::endl;
+
+	char hashText[17];
+	for (const Entry* entry : sorted)
+	{
+		snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)entry->hash);
+
+		file << hashText << " " << entry->size << " " << Quirks::getPlatformName(entry->platform) << " "
+			<< quirksToString(entry->quirks) << " " << entry->path << std::endl;
+	}
+
+	LOG_I("Saved " + std::to_string(sorted.size()) + " ROMs to index: " + path);
+	return true;
+}
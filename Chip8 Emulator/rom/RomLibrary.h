@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Quirks.h"
+
+/**
+@brief An index of every ROM in a directory tree, with the quirk profile each one needs.
+
+Scanning hashes every ROM with the same XXH64 RomCache uses and guesses its platform from the
+opcodes it contains. The index is saved as a plain text file, one ROM per line, so a profile
+can be hand tuned once and kept across rescans. Chip8::loadROM looks ROMs up by hash, so any
+ROM in the index is configured automatically.
+*/
+class RomLibrary
+{
+public:
+	/** @brief One indexed ROM. */
+	struct Entry
+	{
+		uint64_t hash;
+		uint64_t size;
+		Quirks::Platform platform;
+		Quirks quirks;
+		///Where the ROM was last found, informational only as ROMs are matched by hash
+		std::string path;
+	};
+
+	/**
+	@brief Index every ROM under a directory, hashing them across several threads.
+
+	ROMs already in the index keep their quirk profile, so hand tuned entries survive a rescan.
+
+	@param directory   The directory to search recursively.
+	@param threadCount Worker threads to use, 0 for one per hardware thread.
+
+	@return bool - Was successful.
+	*/
+	static bool scan(const std::string& directory, unsigned int threadCount = 0);
+
+	/**
+	@brief Read an index file, merging it into the entries already loaded.
+
+	@param path The index file.
+
+	@return bool - Was successful.
+	*/
+	static bool loadIndex(const std::string& path);
+
+	/**
+	@brief Write every entry to an index file.
+
+	@param path The index file.
+
+	@return bool - Was successful.
+	*/
+	static bool saveIndex(const std::string& path);
+
+	/**
+	@brief Look up the quirk profile for a ROM.
+
+	@param hash   XXH64 of the ROM's contents.
+	@param quirks Set to the ROM's profile if it is indexed.
+
+	@return bool - Is the ROM indexed.
+	*/
+	static bool findQuirks(uint64_t hash, Quirks& quirks);
+
+	/**
+	@brief Guess which platform a ROM was written for from the instructions it uses.
+
+	@param data The ROM's bytes.
+	@param size Number of bytes.
+
+	@return The most likely platform, CHIP-8 if nothing suggests otherwise.
+	*/
+	static Quirks::Platform detectPlatform(const unsigned char* data, size_t size);
+
+	static size_t getEntryCount();
+
+private:
+	static std::mutex entriesMutex;
+
+	static std::unordered_map<uint64_t, Entry> entries;
+
+	/** @brief Hash and classify a single file, false if it couldn't be read. */
+	static bool indexFile(const std::string& path, Entry& entry);
+};
@@ -0,0 +1,232 @@
+#include "MachineScheduler.h"
+
+#include "../Chip8.h"
+#include "../misc/Log.h"
+
+MachineScheduler::MachineScheduler(unsigned long long cyclesPerFrame)
+	: cyclesPerFrame(cyclesPerFrame > 0 ? cyclesPerFrame : 1), frame(0)
+{
+	stats.cyclesRun = 0;
+	stats.cyclesSkipped = 0;
+	stats.parks = 0;
+	stats.wakes = 0;
+}
+
+MachineScheduler::MachineId MachineScheduler::add(std::unique_ptr<Chip8> machine)
+{
+	MachineId id;
+
+	if (!freeSlots.empty())
+	{
+		id = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		id = slots.size();
+		slots.emplace_back();
+	}
+
+	Slot& slot = slots[id];
+	slot.machine = std::move(machine);
+	slot.state = Runnable;
+	slot.parkedFrame = 0;
+	slot.wakeFrame = 0;
+	slot.runIndex = runnable.size();
+
+	runnable.push_back(id);
+	return id;
+}
+
+std::unique_ptr<Chip8> MachineScheduler::remove(MachineId id)
+{
+	if (!isKnown(id, "remove"))
+	{
+		return nullptr;
+	}
+
+	Slot& slot = slots[id];
+
+	if (slot.state == Runnable)
+		removeRunnable(id);
+	else
+		catchUp(slot);
+
+	slot.state = FreeSlot;
+	freeSlots.push_back(id);
+
+	return std::move(slot.machine);
+}
+
+Chip8* MachineScheduler::get(MachineId id)
+{
+	if (!isKnown(id, "get"))
+	{
+		return nullptr;
+	}
+
+	if (slots[id].state != Runnable)
+	{
+		wake(id);
+	}
+
+	return slots[id].machine.get();
+}
+
+bool MachineScheduler::setKeypad(MachineId id, uint16_t keypad)
+{
+	if (!isKnown(id, "set the keypad of"))
+	{
+		return false;
+	}
+
+	Slot& slot = slots[id];
+
+	//The machine must reach this frame with the old keys before the new ones land
+	if (slot.state == ParkedOnKey && keypad != 0)
+	{
+		wake(id);
+	}
+	else if (slot.state != Runnable)
+	{
+		catchUp(slot);
+	}
+
+	slot.machine->setKeypad(keypad);
+	return true;
+}
+
+void MachineScheduler::runFrame()
+{
+	//Machines whose delay timer runs out this frame
+	while (!timerWakes.empty() && timerWakes.top().first <= frame)
+	{
+		TimerWake due = timerWakes.top();
+		timerWakes.pop();
+
+		if (slots[due.second].state == ParkedOnTimer && slots[due.second].wakeFrame == due.first)
+		{
+			wake(due.second);
+		}
+	}
+
+	for (size_t i = 0; i < runnable.size();)
+	{
+		MachineId id = runnable[i];
+		advance(*slots[id].machine, cyclesPerFrame);
+
+		//Parking moves the last machine into this position, so only step on if it stayed
+		if (!parkIfIdle(id))
+		{
+			i++;
+		}
+	}
+
+	frame++;
+}
+
+bool MachineScheduler::isKnown(MachineId id, const char* action)
+{
+	if (id >= slots.size() || slots[id].state == FreeSlot)
+	{
+		LOG_W(std::string("Can't ") + action + " unknown machine " + std::to_string(id));
+		return false;
+	}
+
+	return true;
+}
+
+void MachineScheduler::advance(Chip8& machine, unsigned long long cycles)
+{
+	while (cycles > 0)
+	{
+		unsigned long long skipped = machine.skipIdle(cycles);
+
+		if (skipped > 0)
+		{
+			stats.cyclesSkipped += skipped;
+			cycles -= skipped;
+			continue;
+		}
+
+		//Run in short slices so an idle loop is caught soon after the machine enters it
+		unsigned long long slice = (cycles < IDLE_CHECK_CYCLES ? cycles : IDLE_CHECK_CYCLES);
+		machine.runCycles(slice);
+
+		stats.cyclesRun += slice;
+		cycles -= slice;
+	}
+}
+
+bool MachineScheduler::parkIfIdle(MachineId id)
+{
+	Slot& slot = slots[id];
+	SlotState parkedState;
+
+	switch (slot.machine->getIdleState())
+	{
+	case Chip8::WaitingForKey:
+		parkedState = ParkedOnKey;
+		break;
+
+	case Chip8::Halted:
+		parkedState = ParkedHalted;
+		break;
+
+	case Chip8::WaitingForTimer:
+	{
+		//Only worth parking if the wait covers at least the whole of the next frame
+		unsigned long long idleFrames = slot.machine->getSkippableCycles() / cyclesPerFrame;
+
+		if (idleFrames == 0)
+			return false;
+
+		parkedState = ParkedOnTimer;
+		slot.wakeFrame = frame + 1 + idleFrames;
+		timerWakes.push(TimerWake(slot.wakeFrame, id));
+	}
+	break;
+
+	default:
+		return false;
+	}
+
+	removeRunnable(id);
+	slot.state = parkedState;
+	slot.parkedFrame = frame + 1;
+
+	stats.parks++;
+	return true;
+}
+
+void MachineScheduler::catchUp(Slot& slot)
+{
+	if (slot.parkedFrame < frame)
+	{
+		advance(*slot.machine, (frame - slot.parkedFrame) * cyclesPerFrame);
+		slot.parkedFrame = frame;
+	}
+}
+
+void MachineScheduler::wake(MachineId id)
+{
+	Slot& slot = slots[id];
+
+	catchUp(slot);
+
+	slot.state = Runnable;
+	slot.runIndex = runnable.size();
+	runnable.push_back(id);
+
+	stats.wakes++;
+}
+
+void MachineScheduler::removeRunnable(MachineId id)
+{
+	size_t index = slots[id].runIndex;
+	MachineId last = runnable.back();
+
+	runnable[index] = last;
+	slots[last].runIndex = index;
+	runnable.pop_back();
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+class Chip8;
+
+/**
+@brief Runs many Chip8 machines cooperatively on one thread, a frame at a time.
+
+Each machine is resumed for its frame's cycle budget and gives control back at the end of it,
+so no machine needs a thread or a stack of its own. Machines that settle into an idle loop
+are parked rather than polled every frame:
+ - waiting on FX0A sleeps until setKeypad() presses a key,
+ - polling the delay timer sleeps until the frame the timer runs out,
+ - jumping to itself sleeps until get() wakes it, as no key can move it on. setKeypad() only
+   brings it up to date.
+
+Skipped cycles are owed, not lost. A parked machine is brought up to the current frame with
+Chip8::skipIdle before it is woken or looked at, so its state always matches running every
+cycle in turn.
+*/
+class MachineScheduler
+{
+public:
+	typedef size_t MachineId;
+
+	/** @brief Work done since construction. */
+	struct Stats
+	{
+		///Cycles actually emulated
+		unsigned long long cyclesRun;
+
+		///Cycles advanced through idle loops in constant time, parked machines add theirs once caught up
+		unsigned long long cyclesSkipped;
+
+		unsigned long long parks;
+		unsigned long long wakes;
+	};
+
+	/** @param cyclesPerFrame Cycles every machine runs each frame. */
+	explicit MachineScheduler(unsigned long long cyclesPerFrame);
+
+	/**
+	@brief Add a machine, it runs from the next frame.
+
+	@return Its id, valid until it is removed.
+	*/
+	MachineId add(std::unique_ptr<Chip8> machine);
+
+	/** @brief Take a machine out of the scheduler, brought up to date. @return nullptr if the id is unknown. */
+	std::unique_ptr<Chip8> remove(MachineId id);
+
+	/**
+	@brief A machine, brought up to date. It is woken as the caller may change it, and parks
+	again on the next frame if it is still idle.
+
+	@return nullptr if the id is unknown.
+	*/
+	Chip8* get(MachineId id);
+
+	/**
+	@brief Set a machine's held keys from the next frame, waking it if it waits on a key.
+
+	@return bool - Was the id known.
+	*/
+	bool setKeypad(MachineId id, uint16_t keypad);
+
+	/** @brief Run one frame of every machine that isn't parked. */
+	void runFrame();
+
+	size_t getMachineCount() { return slots.size() - freeSlots.size(); }
+
+	size_t getRunnableCount() { return runnable.size(); }
+
+	size_t getParkedCount() { return getMachineCount() - runnable.size(); }
+
+	/** @brief The next frame to run. */
+	unsigned long long getFrame() { return frame; }
+
+	const Stats& getStats() { return stats; }
+
+private:
+	///How often a running machine is checked for an idle loop
+	static const unsigned long long IDLE_CHECK_CYCLES = 64;
+
+	enum SlotState
+	{
+		FreeSlot,
+		Runnable,
+		ParkedOnKey,
+		ParkedOnTimer,
+		ParkedHalted
+	};
+
+	struct Slot
+	{
+		std::unique_ptr<Chip8> machine;
+		SlotState state;
+
+		///First frame a parked machine hasn't run
+		unsigned long long parkedFrame;
+
+		///Frame a machine parked on the delay timer is due back
+		unsigned long long wakeFrame;
+
+		///Position in runnable while Runnable
+		size_t runIndex;
+	};
+
+	unsigned long long cyclesPerFrame;
+	unsigned long long frame;
+
+	std::vector<Slot> slots;
+	std::vector<MachineId> freeSlots;
+
+	///Machines run each frame, in no particular order
+	std::vector<MachineId> runnable;
+
+	///Timer parked machines by wake frame. Entries are checked against the slot when popped, so
+	///parks that ended early don't need removing
+	typedef std::pair<unsigned long long, MachineId> TimerWake;
+	std::priority_queue<TimerWake, std::vector<TimerWake>, std::greater<TimerWake>> timerWakes;
+
+	Stats stats;
+
+	/** @brief Is the id a machine in the scheduler, logging a warning naming the action if not. */
+	bool isKnown(MachineId id, const char* action);
+
+	/** @brief Emulate a number of cycles, skipping any spent in idle loops. */
+	void advance(Chip8& machine, unsigned long long cycles);
+
+	/** @brief Park a runnable machine if it has gone idle. @return true if it was parked. */
+	bool parkIfIdle(MachineId id);
+
+	/** @brief Run the frames a parked machine has missed, it stays parked. */
+	void catchUp(Slot& slot);
+
+	/** @brief Bring a parked machine up to date and make it runnable. */
+	void wake(MachineId id);
+
+	void removeRunnable(MachineId id);
+};